@@ -42,7 +42,9 @@ MODULE_CFLAGS := \
 
 MODULE_SRC_FILES += \
     src/CoreFoundation/CFAllocator.c \
+    src/CoreFoundation/CFAllocator_Slab.c \
     src/CoreFoundation/CFArray.c \
+    src/CoreFoundation/CFAsyncFile.c \
     src/CoreFoundation/CFBag.c \
     src/CoreFoundation/CFBase.c \
     src/CoreFoundation/CFBoolean.c \
@@ -50,6 +52,7 @@ MODULE_SRC_FILES += \
     src/CoreFoundation/CFData.c \
     src/CoreFoundation/CFDate.c \
     src/CoreFoundation/CFDictionary.c \
+    src/CoreFoundation/CFFileDescriptor.c \
     src/CoreFoundation/CFLog.c \
     src/CoreFoundation/CFNull.c \
     src/CoreFoundation/CFNumber.c \
@@ -58,9 +61,13 @@ MODULE_SRC_FILES += \
     src/CoreFoundation/CFRunLoop.c \
     src/CoreFoundation/CFRunLoop_Observer.c \
     src/CoreFoundation/CFRunLoop_Source.c \
+    src/CoreFoundation/CFRunLoop_Statistics.c \
     src/CoreFoundation/CFRunLoop_Timer.c \
+    src/CoreFoundation/CFRunLoopGroup.c \
     src/CoreFoundation/CFRunLoopPort.c \
     src/CoreFoundation/CFRuntime.c \
+    src/CoreFoundation/CFRuntime_HeapProfile.c \
+    src/CoreFoundation/CFRuntime_Statistics.c \
     src/CoreFoundation/CFSet.c \
     src/CoreFoundation/CFSortFunctions.c \
     src/CoreFoundation/CFStorage.c \
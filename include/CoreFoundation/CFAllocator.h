@@ -139,6 +139,66 @@ CFIndex CFAllocatorGetPreferredSizeForSize(CFAllocatorRef allocator, CFIndex siz
 CF_EXPORT
 void CFAllocatorGetContext(CFAllocatorRef allocator, CFAllocatorContext* context);
 
+/* Arena allocator
+ *
+ * Arena allocates memory by bumping a pointer through large chunks, which
+ * are obtained from 'allocator'. CFAllocatorDeallocate() does nothing; all
+ * memory is reclaimed at once by CFAllocatorArenaReset(), or when the arena
+ * is deallocated. Objects created with an arena don't retain it, and must
+ * not be used after the arena is reset.
+ * 'chunkSize' of 0 selects the default chunk size (64K).
+ */
+CF_EXPORT
+CFAllocatorRef CFAllocatorCreateArena(CFAllocatorRef allocator, CFIndex chunkSize);
+
+CF_EXPORT
+void CFAllocatorArenaReset(CFAllocatorRef arena);
+
+/* Tracking allocator
+ *
+ * Tracking allocator forwards to 'allocator' and counts live bytes and
+ * allocations, and the high-water mark of live bytes. Sizes are as
+ * requested, i.e. don't include underlying allocator's overhead.
+ * If 'limit' is not 0, allocations which would make live bytes exceed it
+ * fail. Before failing, the pressure callback (if any) is called outside
+ * of any locks; if it returns true (e.g. after purging caches), the
+ * allocation is retried once.
+ */
+typedef Boolean (*CFAllocatorPressureCallBack)(CFAllocatorRef allocator, CFIndex size, void* info);
+
+typedef struct {
+    CFIndex limit;
+    CFIndex liveBytes;
+    CFIndex highWaterBytes;
+    CFIndex liveAllocationCount;
+    CFIndex allocationCount; // since creation
+    CFIndex failedAllocationCount; // because of the limit
+} CFAllocatorTrackingStatistics;
+
+CF_EXPORT
+CFAllocatorRef CFAllocatorCreateTracking(CFAllocatorRef allocator, CFIndex limit, CFAllocatorPressureCallBack callback, void* info);
+
+/* 0 removes the limit. Lowering the limit doesn't affect live blocks. */
+CF_EXPORT
+void CFAllocatorSetTrackingLimit(CFAllocatorRef tracking, CFIndex limit);
+
+CF_EXPORT
+void CFAllocatorGetTrackingStatistics(CFAllocatorRef tracking, CFAllocatorTrackingStatistics* statistics);
+
+/* Huge page allocator
+ *
+ * Huge page allocator serves requests of at least 'threshold' bytes from
+ * separate mappings, which are aligned to the huge page size (2 MB) and
+ * backed by huge pages where the platform allows. This reduces TLB misses
+ * when large buffers (CFStorage leaves, CFData bytes, CFDictionary / CFSet
+ * key-value arrays) are scanned. Smaller requests are forwarded to
+ * 'allocator'. Pass the result as the allocator argument of collections
+ * which are expected to grow large.
+ * 'threshold' of 0 selects the default threshold (1 MB).
+ */
+CF_EXPORT
+CFAllocatorRef CFAllocatorCreateHugePage(CFAllocatorRef allocator, CFIndex threshold);
+
 CF_EXTERN_C_END
 
 #endif /* ! __COREFOUNDATION_CFALLOCATOR__ */
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(__COREFOUNDATION_CFASYNCFILE__)
+#define __COREFOUNDATION_CFASYNCFILE__ 1
+
+#include <CoreFoundation/CFData.h>
+#include <CoreFoundation/CFRunLoop.h>
+
+CF_EXTERN_C_BEGIN
+
+/* Asynchronous positioned file I/O.
+ *
+ * Requests are executed by the kernel where the platform supports
+ *  submission rings (io_uring on Linux), and by a small pool of worker
+ *  threads otherwise. Either way the callback is called by the run loop
+ *  of the thread that submitted the request, when it runs in 'mode'
+ *  (or in any common mode, if 'mode' is kCFRunLoopCommonModes).
+ */
+
+/* 'result' is the number of bytes transferred, or a negated error code
+ *  (e.g. -EBADF). 'data' is the data passed to the submitting function.
+ */
+typedef void (*CFAsyncFileCallBack)(CFDataRef data, CFIndex result, void* info);
+
+/* Reads up to 'length' bytes from 'fd' at 'offset', appending them to
+ *  'data'. 'data' is extended by 'length' bytes immediately, and is
+ *  trimmed to the number of bytes actually read before the callback is
+ *  called. 'data' must not be modified until then.
+ * Reads into the same 'data' are serialized: a read starts (and extends
+ *  'data') only when the previous one completes. If a deferred read
+ *  can't be started, the callback gets -EAGAIN.
+ * Returns false if the request can't be submitted.
+ */
+CF_EXPORT
+Boolean CFAsyncFileRead(int fd, SInt64 offset, CFIndex length, CFMutableDataRef data, CFStringRef mode, CFAsyncFileCallBack callback, void* info);
+
+/* Writes contents of 'data' to 'fd' at 'offset'. Mutable 'data' must not
+ *  be modified until the callback is called.
+ * Returns false if the request can't be submitted.
+ */
+CF_EXPORT
+Boolean CFAsyncFileWrite(int fd, SInt64 offset, CFDataRef data, CFStringRef mode, CFAsyncFileCallBack callback, void* info);
+
+CF_EXTERN_C_END
+
+#endif /* !__COREFOUNDATION_CFASYNCFILE__ */
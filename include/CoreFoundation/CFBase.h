@@ -231,6 +231,16 @@ CFIndex CFGetRetainCount(CFTypeRef cf);
 CF_EXPORT
 CFTypeRef CFMakeCollectable(CFTypeRef cf);
 
+/* Makes 'cf' permanently alive, like static objects: CFRetain() and
+ *  CFRelease() don't change it anymore, and it's never deallocated.
+ * Contents of arrays, dictionaries, sets and bags holding CF objects
+ *  are made immortal recursively (objects which are already immortal
+ *  are not traversed). Objects added to a mutable collection later
+ *  are not affected.
+ */
+CF_EXPORT
+void CFMakeImmortal(CFTypeRef cf);
+
 CF_EXPORT
 Boolean CFEqual(CFTypeRef cf1,CFTypeRef cf2);
 
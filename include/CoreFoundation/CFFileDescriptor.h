@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(__COREFOUNDATION_CFFILEDESCRIPTOR__)
+#define __COREFOUNDATION_CFFILEDESCRIPTOR__ 1
+
+#include <CoreFoundation/CFRunLoop.h>
+
+CF_EXTERN_C_BEGIN
+
+typedef int CFFileDescriptorNativeDescriptor;
+
+typedef struct __CFFileDescriptor* CFFileDescriptorRef;
+
+/* Callback types. Unless kCFFileDescriptorEdgeTriggered is also passed
+ *  to CFFileDescriptorEnableCallBacks, callback types are disabled after
+ *  the callback is called, and must be enabled again to get further
+ *  callbacks. Edge-triggered callback types stay enabled, but are called
+ *  only when descriptor becomes ready, so all available data must be
+ *  consumed (until EAGAIN) before the next callback can be expected.
+ */
+enum {
+    kCFFileDescriptorReadCallBack = 1UL << 0,
+    kCFFileDescriptorWriteCallBack = 1UL << 1,
+    kCFFileDescriptorEdgeTriggered = 1UL << 2
+};
+
+/* 'callBackTypes' are the types the descriptor is ready for. */
+typedef void (*CFFileDescriptorCallBack)(CFFileDescriptorRef f, CFOptionFlags callBackTypes, void* info);
+
+typedef struct {
+    CFIndex version;
+    void* info;
+    void* (*retain)(void* info);
+    void (*release)(void* info);
+    CFStringRef (*copyDescription)(void* info);
+} CFFileDescriptorContext;
+
+CF_EXPORT
+CFTypeID CFFileDescriptorGetTypeID(void);
+
+/* Returns NULL if descriptors can't be watched on this platform, or
+ *  if 'fd' is not a valid descriptor or can't be watched (e.g. it's
+ *  a regular file).
+ */
+CF_EXPORT
+CFFileDescriptorRef CFFileDescriptorCreate(CFAllocatorRef allocator, CFFileDescriptorNativeDescriptor fd, Boolean closeOnInvalidate, CFFileDescriptorCallBack callout, const CFFileDescriptorContext* context);
+
+CF_EXPORT
+CFFileDescriptorNativeDescriptor CFFileDescriptorGetNativeDescriptor(CFFileDescriptorRef f);
+
+CF_EXPORT
+void CFFileDescriptorGetContext(CFFileDescriptorRef f, CFFileDescriptorContext* context);
+
+/* Enabled callback types are left unchanged if the descriptor can't
+ *  be watched for the new types (e.g. it was closed).
+ */
+CF_EXPORT
+void CFFileDescriptorEnableCallBacks(CFFileDescriptorRef f, CFOptionFlags callBackTypes);
+CF_EXPORT
+void CFFileDescriptorDisableCallBacks(CFFileDescriptorRef f, CFOptionFlags callBackTypes);
+
+CF_EXPORT
+void CFFileDescriptorInvalidate(CFFileDescriptorRef f);
+CF_EXPORT
+Boolean CFFileDescriptorIsValid(CFFileDescriptorRef f);
+
+CF_EXPORT
+CFRunLoopSourceRef CFFileDescriptorCreateRunLoopSource(CFAllocatorRef allocator, CFFileDescriptorRef f, CFIndex order);
+
+CF_EXTERN_C_END
+
+#endif /* !__COREFOUNDATION_CFFILEDESCRIPTOR__ */
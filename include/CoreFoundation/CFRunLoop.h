@@ -97,6 +97,93 @@ void CFRunLoopWakeUp(CFRunLoopRef rl);
 CF_EXPORT
 void CFRunLoopStop(CFRunLoopRef rl);
 
+typedef void (*CFRunLoopPerformCallBack)(void* context);
+
+/* Schedules 'function' to be called once by the run loop when it runs
+ *  in 'mode' (or in any common mode, if 'mode' is kCFRunLoopCommonModes),
+ *  and wakes the run loop up. Can be called from any thread; functions
+ *  are called in the order they were submitted. Returns false if the
+ *  function can't be queued.
+ */
+CF_EXPORT
+Boolean CFRunLoopPerformFunction(CFRunLoopRef rl, CFStringRef mode, CFRunLoopPerformCallBack function, void* context);
+
+/* Run loop statistics
+ *
+ * When enabled, run loop collects statistics for each mode it runs in.
+ *  CFRunLoopCopyStatistics() returns dictionary which maps mode names
+ *  to dictionaries with kCFRunLoopStatistics* keys.
+ * Histograms are CFArrays of kCFRunLoopStatisticsHistogramSize CFNumbers,
+ *  bucket N counts durations in [2^N, 2^(N+1)) microseconds (the first
+ *  bucket also counts shorter durations, the last one longer).
+ * Callouts are attributed to sources, timers and observers. Their
+ *  statistics in a mode are dropped when they are removed from that mode,
+ *  and callouts that remove or invalidate their own object (e.g. one-shot
+ *  timers) are not attributed. Functions submitted with
+ *  CFRunLoopPerformFunction() are attributed to kCFNull.
+ */
+
+enum {
+    kCFRunLoopWakeUpNone = 0, // polled without sleeping
+    kCFRunLoopWakeUpTimeout = 1,
+    kCFRunLoopWakeUpExplicit = 2, // CFRunLoopWakeUp, source signal or submitted function
+    kCFRunLoopWakeUpTimer = 3,
+    kCFRunLoopWakeUpPort = 4, // version 1 source
+    kCFRunLoopWakeUpCauseCount = 5
+};
+typedef CFIndex CFRunLoopWakeUpCause;
+
+enum {
+    kCFRunLoopStatisticsHistogramSize = 24
+};
+
+/* CFNumber */
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsIterationCountKey;
+/* Histogram of iteration times, excluding time spent asleep */
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsBusyTimeHistogramKey;
+/* CFNumber, total time spent asleep, in seconds */
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsSleepTimeKey;
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsSleepTimeHistogramKey;
+/* CFArray of CFNumbers indexed by CFRunLoopWakeUpCause */
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsWakeUpCountsKey;
+/* Histogram of actual minus scheduled timer fire times */
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsTimerLatenessHistogramKey;
+/* CFArray of dictionaries with kCFRunLoopStatisticsCallout* keys */
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsCalloutsKey;
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsCalloutObjectKey;
+/* CFNumber */
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsCalloutCountKey;
+/* CFNumber, total time, in seconds */
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsCalloutTimeKey;
+/* CFNumber, longest callout time, in seconds */
+CF_EXPORT const CFStringRef kCFRunLoopStatisticsCalloutMaxTimeKey;
+
+typedef struct {
+    CFStringRef mode;
+    CFTimeInterval busyTime;
+    CFTimeInterval sleepTime;
+    CFRunLoopWakeUpCause wakeUpCause;
+    CFIndex calloutCount;
+    CFTimeInterval longestCalloutTime;
+    CFTypeRef longestCalloutObject; // kCFNull for submitted functions, NULL if there were no callouts
+} CFRunLoopIterationStatistics;
+
+/* Called by the run loop (on its thread) after each iteration. */
+typedef void (*CFRunLoopStatisticsCallBack)(CFRunLoopRef rl, const CFRunLoopIterationStatistics* iteration, void* info);
+
+CF_EXPORT
+void CFRunLoopSetStatisticsEnabled(CFRunLoopRef rl, Boolean enabled);
+CF_EXPORT
+Boolean CFRunLoopIsStatisticsEnabled(CFRunLoopRef rl);
+/* Returns NULL if statistics were never enabled. */
+CF_EXPORT
+CFDictionaryRef CFRunLoopCopyStatistics(CFRunLoopRef rl);
+CF_EXPORT
+void CFRunLoopResetStatistics(CFRunLoopRef rl);
+/* Callback is called only while statistics are enabled. */
+CF_EXPORT
+void CFRunLoopSetStatisticsCallBack(CFRunLoopRef rl, CFRunLoopStatisticsCallBack callback, void* info);
+
 CF_EXPORT
 Boolean CFRunLoopContainsSource(CFRunLoopRef rl, CFRunLoopSourceRef source, CFStringRef mode);
 CF_EXPORT
@@ -213,6 +300,14 @@ CFTimeInterval CFRunLoopTimerGetInterval(CFRunLoopTimerRef timer);
 CF_EXPORT
 Boolean CFRunLoopTimerDoesRepeat(CFRunLoopTimerRef timer);
 CF_EXPORT
+CFTimeInterval CFRunLoopTimerGetTolerance(CFRunLoopTimerRef timer);
+/* Allows the timer to fire up to 'tolerance' seconds late, so that
+ *  its wakeup can be combined with wakeups of other timers. Clamped
+ *  to half of the interval for repeating timers. Default is 0.
+ */
+CF_EXPORT
+void CFRunLoopTimerSetTolerance(CFRunLoopTimerRef timer, CFTimeInterval tolerance);
+CF_EXPORT
 CFIndex CFRunLoopTimerGetOrder(CFRunLoopTimerRef timer);
 CF_EXPORT
 void CFRunLoopTimerInvalidate(CFRunLoopTimerRef timer);
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(__COREFOUNDATION_CFRUNLOOPGROUP__)
+#define __COREFOUNDATION_CFRUNLOOPGROUP__ 1
+
+#include <CoreFoundation/CFRunLoop.h>
+
+CF_EXTERN_C_BEGIN
+
+/* Group of threads, each running its own run loop.
+ *
+ * Work which is not tied to a particular run loop is distributed by
+ *  picking the next two run loops in round-robin order and choosing
+ *  the less loaded one. Run loop is considered loaded when it has
+ *  many submitted functions waiting, or spends most of its time
+ *  handling callouts, so a run loop that falls behind stops getting
+ *  new work until it catches up.
+ * Work with a key always goes to the same run loop, so work with the
+ *  same key is performed serially and in order.
+ */
+
+typedef struct __CFRunLoopGroup* CFRunLoopGroupRef;
+
+CF_EXPORT
+CFTypeID CFRunLoopGroupGetTypeID(void);
+
+/* Starts 'count' threads (one per processor if 'count' is 0) running
+ *  their run loops in kCFRunLoopDefaultMode until the group is
+ *  invalidated. When 'pinThreads' is true, thread N is bound to the
+ *  processor N (modulo number of processors).
+ * Stopping member run loop with CFRunLoopStop() ends its thread.
+ * Returns NULL if not all threads can be started (threads which were
+ *  started are stopped).
+ */
+CF_EXPORT
+CFRunLoopGroupRef CFRunLoopGroupCreate(CFAllocatorRef allocator, CFIndex count, Boolean pinThreads);
+
+CF_EXPORT
+CFIndex CFRunLoopGroupGetCount(CFRunLoopGroupRef group);
+
+CF_EXPORT
+CFRunLoopRef CFRunLoopGroupGetRunLoopAtIndex(CFRunLoopGroupRef group, CFIndex index);
+
+CF_EXPORT
+CFRunLoopRef CFRunLoopGroupGetRunLoopForKey(CFRunLoopGroupRef group, CFHashCode key);
+
+/* Add item to the least loaded run loop, and return that run loop.
+ *  Returns NULL if the group is invalidated.
+ */
+CF_EXPORT
+CFRunLoopRef CFRunLoopGroupAddSource(CFRunLoopGroupRef group, CFRunLoopSourceRef source, CFStringRef mode);
+CF_EXPORT
+CFRunLoopRef CFRunLoopGroupAddTimer(CFRunLoopGroupRef group, CFRunLoopTimerRef timer, CFStringRef mode);
+
+/* See CFRunLoopPerformFunction(). Returns false if the group is
+ *  invalidated.
+ */
+CF_EXPORT
+Boolean CFRunLoopGroupPerformFunction(CFRunLoopGroupRef group, CFStringRef mode, CFRunLoopPerformCallBack function, void* context);
+CF_EXPORT
+Boolean CFRunLoopGroupPerformFunctionForKey(CFRunLoopGroupRef group, CFHashCode key, CFStringRef mode, CFRunLoopPerformCallBack function, void* context);
+
+/* Stops run loops and waits for threads to exit (except the calling
+ *  thread, if it belongs to the group). Items added to the run loops
+ *  are not removed.
+ */
+CF_EXPORT
+void CFRunLoopGroupInvalidate(CFRunLoopGroupRef group);
+CF_EXPORT
+Boolean CFRunLoopGroupIsValid(CFRunLoopGroupRef group);
+
+CF_EXTERN_C_END
+
+#endif /* !__COREFOUNDATION_CFRUNLOOPGROUP__ */
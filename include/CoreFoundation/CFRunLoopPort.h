@@ -34,11 +34,83 @@ CFRunLoopPortRef CFRunLoopPortCreate(CFAllocatorRef allocator);
 CF_EXPORT
 Boolean CFRunLoopPortSignal(CFRunLoopPortRef port);
 
+/* Timer port is signalled when TSR (platform's monotonic clock, see
+ *  CFPlatformReadTSR) reaches the value set by CFRunLoopPortArmTimer.
+ *  Zero or LLONG_MAX disarm the timer.
+ * CFRunLoopPortCreateTimer returns NULL if timer ports are not supported.
+ */
+
+CF_EXPORT
+CFRunLoopPortRef CFRunLoopPortCreateTimer(CFAllocatorRef allocator);
+
+CF_EXPORT
+Boolean CFRunLoopPortArmTimer(CFRunLoopPortRef port, SInt64 fireTSR);
+
+/* File descriptor port is signalled when the descriptor becomes ready
+ *  for the events set by CFRunLoopPortSetFileDescriptorEvents (none
+ *  initially). With kCFRunLoopPortEdgeTriggered port is signalled only
+ *  when readiness changes, otherwise it stays signalled while the
+ *  descriptor is ready.
+ * Ready events are collected when the port is reported by a wait, and
+ *  can be retrieved (and cleared) with CFRunLoopPortTakeReadyEvents.
+ *  Errors and hangups are reported as both read and write readiness.
+ * The descriptor is not closed when the port is destroyed.
+ * CFRunLoopPortCreateWithFileDescriptor returns NULL if file descriptor
+ *  ports are not supported, or if the descriptor can't be watched (e.g.
+ *  it's a regular file). CFRunLoopPortSetFileDescriptorEvents returns
+ *  false (and keeps previous events) if the descriptor can't be watched
+ *  for new events in some of the port sets the port is in.
+ */
+
+enum {
+    kCFRunLoopPortReadEvent = (1UL << 0),
+    kCFRunLoopPortWriteEvent = (1UL << 1),
+    kCFRunLoopPortEdgeTriggered = (1UL << 2)
+};
+
+CF_EXPORT
+CFRunLoopPortRef CFRunLoopPortCreateWithFileDescriptor(CFAllocatorRef allocator, int fd);
+
+CF_EXPORT
+Boolean CFRunLoopPortSetFileDescriptorEvents(CFRunLoopPortRef port, CFOptionFlags events);
+
+CF_EXPORT
+CFOptionFlags CFRunLoopPortTakeReadyEvents(CFRunLoopPortRef port);
+
 CF_EXPORT
 Boolean CFRunLoopPortWait(CFArrayRef ports, CFTimeInterval timeout, CFIndex* singnalledIndex);
 
+/* Port set is a persistent collection of ports which can be waited on
+ *  without rebuilding kernel wait object on every wait. Same port can
+ *  be added several times, it is removed from the set when the number
+ *  of removals matches the number of additions.
+ * CFRunLoopPortSetWait stores up to 'capacity' signalled ports (retained,
+ *  caller must release them) to 'signalledPorts' and their number to
+ *  'signalledCount', which is 0 if wait timed out.
+ */
+
+typedef struct _CFRunLoopPortSet* CFRunLoopPortSetRef;
+
+CF_EXPORT
+CFTypeID CFRunLoopPortSetTypeID();
+
+CF_EXPORT
+CFRunLoopPortSetRef CFRunLoopPortSetCreate(CFAllocatorRef allocator);
+
+CF_EXPORT
+Boolean CFRunLoopPortSetAddPort(CFRunLoopPortSetRef set, CFRunLoopPortRef port);
+
+CF_EXPORT
+void CFRunLoopPortSetRemovePort(CFRunLoopPortSetRef set, CFRunLoopPortRef port);
+
+CF_EXPORT
+Boolean CFRunLoopPortSetWait(CFRunLoopPortSetRef set, CFTimeInterval timeout, CFRunLoopPortRef* signalledPorts, CFIndex capacity, CFIndex* signalledCount);
+
 /* Implementation details.
- * CFRunLoopPortSetImpl must be called before CFRunLoop can be used.
+ * CFRunLoopPortSetImpl must be called before CFRunLoop can be used,
+ *  unless platform provides its own implementation (Linux uses
+ *  eventfd-based ports which are waited on with epoll).
+ * Implementation can be replaced only until the first port is created.
  */
 
 typedef struct _CFRunLoopPortImpl {
@@ -52,6 +124,45 @@ typedef struct _CFRunLoopPortImpl {
 CF_EXPORT
 void CFRunLoopPortSetImpl(const CFRunLoopPortImpl* impl);
 
+/* Optional callbacks, installed with CFRunLoopPortSetExtendedImpl after
+ *  CFRunLoopPortSetImpl (which removes previously installed extended
+ *  implementation). They are kept separately from CFRunLoopPortImpl to
+ *  keep its layout stable; 'version' must be 0.
+ */
+
+typedef struct _CFRunLoopPortExtendedImpl {
+    CFIndex version;
+
+    /* Optional, if 'createSet' is NULL port sets are emulated with 'wait'.
+     * 'waitSet' must reset signalled ports the same way 'wait' does,
+     *  can report up to 'capacity' ports at once (not retained), and
+     *  can be called by several threads at once.
+     */
+    CFIndex setDataSize;
+    Boolean (*createSet)(void* setData);
+    void (*destroySet)(void* setData);
+    Boolean (*addToSet)(void* setData, CFRunLoopPortRef port, void* data);
+    void (*removeFromSet)(void* setData, CFRunLoopPortRef port, void* data);
+    Boolean (*waitSet)(void* setData, CFTimeInterval timeout, CFRunLoopPortRef* signalledPorts, CFIndex capacity, CFIndex* signalledCount);
+
+    /* Optional, if 'createTimer' is NULL timer ports are not supported.
+     * Timer ports are destroyed with 'destroy'.
+     */
+    Boolean (*createTimer)(void* data);
+    Boolean (*armTimer)(void* data, SInt64 fireTSR);
+
+    /* Optional, if 'createWithFileDescriptor' is NULL file descriptor
+     *  ports are not supported.
+     * File descriptor ports are destroyed with 'destroy'.
+     */
+    Boolean (*createWithFileDescriptor)(void* data, int fd);
+    Boolean (*setFileDescriptorEvents)(void* data, CFOptionFlags events);
+    CFOptionFlags (*takeReadyEvents)(void* data);
+} CFRunLoopPortExtendedImpl;
+
+CF_EXPORT
+void CFRunLoopPortSetExtendedImpl(const CFRunLoopPortExtendedImpl* impl);
+
 CF_EXPORT
 CFIndex CFRunLoopPortGetImplDataSize();
 
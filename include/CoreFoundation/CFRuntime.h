@@ -28,6 +28,7 @@
 #include <CoreFoundation/CFBase.h>
 #include <CoreFoundation/CFString.h>
 #include <CoreFoundation/CFDictionary.h>
+#include <CoreFoundation/CFDate.h>
 #include <CoreFoundation/CFString.h>
 #include <stddef.h>
 
@@ -260,6 +261,92 @@ void CFReportRuntimeError(CFStringRef errorType, CFStringRef format, ...);
 CF_EXPORT
 void CFReportRuntimeErrorV(CFStringRef errorType, CFStringRef format, va_list arguments);
 
+/* Runtime statistics
+ *
+ * When CFRuntimeStatistics environment variable is set to a non-zero
+ *  value, the runtime counts instances created and destroyed for each
+ *  type, and bytes they occupy. Counters are kept per thread and merged
+ *  when read, so they are cheap enough to leave enabled; for the same
+ *  reason snapshots are approximate while other threads are running.
+ * CFRuntimeCopyStatistics() returns dictionary which maps class names
+ *  to dictionaries with kCFRuntimeStatistics* keys, or NULL if
+ *  statistics are not enabled.
+ */
+
+/* CFNumber */
+CF_EXPORT const CFStringRef kCFRuntimeStatisticsTypeIDKey;
+/* CFNumber, instances created but not yet destroyed */
+CF_EXPORT const CFStringRef kCFRuntimeStatisticsLiveInstancesKey;
+/* CFNumber, bytes occupied by live instances */
+CF_EXPORT const CFStringRef kCFRuntimeStatisticsLiveBytesKey;
+/* CFNumber, instances created since the start */
+CF_EXPORT const CFStringRef kCFRuntimeStatisticsAllocationCountKey;
+/* CFNumber, bytes allocated since the start */
+CF_EXPORT const CFStringRef kCFRuntimeStatisticsAllocatedBytesKey;
+
+/* Called by the run loop on which the callback was set. */
+typedef void (*CFRuntimeStatisticsCallBack)(CFDictionaryRef statistics, void* info);
+
+CF_EXPORT
+Boolean CFRuntimeIsStatisticsEnabled(void);
+
+CF_EXPORT
+CFDictionaryRef CFRuntimeCopyStatistics(void);
+
+/* Schedules 'callback' to be called with statistics snapshot every
+ *  'interval' seconds on the current run loop, in common modes.
+ *  Replaces previously set callback; NULL callback stops snapshots.
+ *  Does nothing if statistics are not enabled.
+ */
+CF_EXPORT
+void CFRuntimeSetStatisticsCallBack(CFRuntimeStatisticsCallBack callback, void* info, CFTimeInterval interval);
+
+/* Lock statistics
+ *
+ * Available only when CoreFoundation is compiled with
+ *  CF_ENABLE_LOCK_PROFILING, otherwise CFRuntimeCopyLockStatistics()
+ *  returns NULL.
+ * Returned dictionary maps lock names (lock expressions at CFLock()
+ *  call sites) to dictionaries with kCFRuntimeLockStatistics* keys.
+ *  Call sites locking the same expression are merged.
+ */
+
+/* CFNumber */
+CF_EXPORT const CFStringRef kCFRuntimeLockStatisticsAcquisitionCountKey;
+/* CFNumber, acquisitions which had to wait */
+CF_EXPORT const CFStringRef kCFRuntimeLockStatisticsContendedCountKey;
+/* CFNumber, total time spent waiting, in seconds */
+CF_EXPORT const CFStringRef kCFRuntimeLockStatisticsWaitTimeKey;
+/* CFNumber, longest time the lock was held, in seconds; measured
+ *  on contended and sampled acquisitions only
+ */
+CF_EXPORT const CFStringRef kCFRuntimeLockStatisticsMaxHoldTimeKey;
+
+CF_EXPORT
+CFDictionaryRef CFRuntimeCopyLockStatistics(void);
+
+/* Heap profiling
+ *
+ * When enabled, roughly one allocation per 'rate' bytes made through
+ *  CFAllocatorAllocate() or _CFRuntimeCreateInstance() is sampled: its
+ *  backtrace is recorded and kept until the allocation is freed.
+ * Initial rate is read from the CFHeapProfileRate environment variable.
+ *  Zero rate stops sampling, but samples which are still alive are kept.
+ */
+CF_EXPORT
+void CFRuntimeSetHeapProfileRate(CFIndex rate);
+
+CF_EXPORT
+CFIndex CFRuntimeGetHeapProfileRate(void);
+
+/* Returns profile in the legacy pprof heap format (heap_v2), followed
+ *  by the memory map. If 'typeID' is not _kCFRuntimeNotATypeID only
+ *  samples of that type's instances are included. Returns NULL if
+ *  profiling was never enabled.
+ */
+CF_EXPORT
+CFDataRef CFRuntimeCopyHeapProfile(CFTypeID typeID);
+
 CF_EXTERN_C_END
 
 #endif /* ! __COREFOUNDATION_CFRUNTIME__ */
@@ -29,6 +29,7 @@
 #include <CoreFoundation/CFArray.h>
 #include <CoreFoundation/CFData.h>
 #include <CoreFoundation/CFDictionary.h>
+#include <CoreFoundation/CFSet.h>
 #include <CoreFoundation/CFCharacterSet.h>
 #include <CoreFoundation/CFLocale.h>
 #include <stdarg.h>
@@ -574,6 +575,24 @@ SInt32 CFStringGetIntValue(CFStringRef str);            /* Skips whitespace; ret
 CF_EXPORT
 double CFStringGetDoubleValue(CFStringRef str);         /* Skips whitespace; returns 0.0 on error */
 
+/*** Lookups in CFString-keyed collections ***/
+
+/* These look up a NULL-terminated C string as if it was a CFString created
+ * with CFStringCreateWithCString(), but without creating one: the key is
+ * hashed and compared in place. They allocate only when the bytes need
+ * conversion, i.e. when they are neither ASCII nor in the default 8-bit
+ * encoding. Collections must use CFString-compatible key callbacks (e.g.
+ * kCFTypeDictionaryKeyCallBacks, kCFCopyStringDictionaryKeyCallBacks).
+ */
+CF_EXPORT
+const void* CFDictionaryGetValueForCString(CFDictionaryRef theDict, const char* cStr, CFStringEncoding encoding);
+
+CF_EXPORT
+Boolean CFDictionaryGetValueIfPresentForCString(CFDictionaryRef theDict, const char* cStr, CFStringEncoding encoding, const void** value);
+
+CF_EXPORT
+Boolean CFSetContainsCString(CFSetRef theSet, const char* cStr, CFStringEncoding encoding);
+
 /*** MutableString functions ***/
 
 /* CFStringAppend("abcdef", "xxxxx") -> "abcdefxxxxx"
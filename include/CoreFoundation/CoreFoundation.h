@@ -59,6 +59,7 @@
 #include <CoreFoundation/CFAllocator.h>
 #include <CoreFoundation/CFStorage.h>
 #include <CoreFoundation/CFArray.h>
+#include <CoreFoundation/CFAsyncFile.h>
 #include <CoreFoundation/CFBag.h>
 #include <CoreFoundation/CFCharacterSet.h>
 #include <CoreFoundation/CFData.h>
@@ -74,12 +75,14 @@
 #include <CoreFoundation/CFDate.h>
 #include <CoreFoundation/CFDateFormatter.h>
 #include <CoreFoundation/CFError.h>
+#include <CoreFoundation/CFFileDescriptor.h>
 #include <CoreFoundation/CFNumber.h>
 #include <CoreFoundation/CFNumberFormatter.h>
 // #include <CoreFoundation/CFPlugIn.h>
 // #include <CoreFoundation/CFPreferences.h>
 // #include <CoreFoundation/CFPropertyList.h>
 #include <CoreFoundation/CFRunLoop.h>
+#include <CoreFoundation/CFRunLoopGroup.h>
 #include <CoreFoundation/CFSet.h>
 // #include <CoreFoundation/CFSocket.h>
 // #include <CoreFoundation/CFStream.h>
@@ -24,6 +24,7 @@
 
 #include "CFInternal.h"
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #undef CF_VALIDATE_ALLOCATOR_ARG
@@ -179,9 +180,22 @@ static void* __CFAllocatorSystemAllocate(CFIndex size, CFOptionFlags hint, void*
     return malloc_zone_malloc((malloc_zone_t*)info, size);
 }
 static void* __CFAllocatorSystemReallocate(void* ptr, CFIndex newsize, CFOptionFlags hint, void* info) {
+    if (_CFSlabContains(ptr)) {
+        // Instance memory, see _CFRuntimeCreateInstance().
+        void* newptr = malloc_zone_malloc((malloc_zone_t*)info, newsize);
+        if (newptr) {
+            memmove(newptr, ptr, _CFMin(newsize, _CFSlabGetSize(ptr)));
+            _CFSlabDeallocate(ptr);
+        }
+        return newptr;
+    }
     return malloc_zone_realloc((malloc_zone_t*)info, ptr, newsize);
 }
 static void __CFAllocatorSystemDeallocate(void* ptr, void* info) {
+    if (_CFSlabContains(ptr)) {
+        _CFSlabDeallocate(ptr);
+        return;
+    }
     malloc_zone_free((malloc_zone_t*)info, ptr);
 }
 static struct __CFAllocator __kCFAllocatorMallocZone = {
@@ -240,6 +254,382 @@ static struct __CFAllocator __kCFAllocatorSystemDefault = {
     }
 };
 
+/* Arena */
+
+typedef struct __CFArenaChunk {
+    struct __CFArenaChunk* next;
+    CFIndex size; // usable size
+} __CFArenaChunk;
+
+typedef struct {
+    CFLock_t lock;
+    CFAllocatorRef allocator; // chunks are allocated from it
+    CFIndex chunkSize;
+    __CFArenaChunk* chunks; // current chunk is the first one
+    uint8_t* cursor;
+    uint8_t* end;
+} __CFArena;
+
+/* Each block is prefixed with its size (for reallocation), both are
+ *  aligned to __kCFArenaAlignment, as is the chunk header.
+ */
+#define __kCFArenaAlignment (2 * sizeof(void*))
+#define __kCFArenaDefaultChunkSize (64 * 1024)
+
+CF_INLINE CFIndex __CFArenaRound(CFIndex size) {
+    return (size + __kCFArenaAlignment - 1) & ~(CFIndex)(__kCFArenaAlignment - 1);
+}
+
+CF_INLINE uint8_t* __CFArenaGetChunkData(__CFArenaChunk* chunk) {
+    return (uint8_t*)chunk + __kCFArenaAlignment;
+}
+
+static __CFArenaChunk* __CFArenaCreateChunk(__CFArena* arena, CFIndex size) {
+    __CFArenaChunk* chunk = (__CFArenaChunk*)CFAllocatorAllocate(
+        arena->allocator, __kCFArenaAlignment + size, 0);
+    if (chunk) {
+        chunk->next = NULL;
+        chunk->size = size;
+    }
+    return chunk;
+}
+
+/* Expects arena to be locked. 'size' includes block header. */
+static uint8_t* __CFArenaAllocateBlock(__CFArena* arena, CFIndex size) {
+    __CFArenaChunk* chunk;
+    uint8_t* block;
+    if (arena->cursor && arena->cursor + size <= arena->end) {
+        block = arena->cursor;
+        arena->cursor += size;
+        return block;
+    }
+    if (size > arena->chunkSize / 4) {
+        // Large block gets its own chunk, and current chunk stays current.
+        chunk = __CFArenaCreateChunk(arena, size);
+        if (!chunk) {
+            return NULL;
+        }
+        if (arena->chunks) {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            arena->chunks = chunk;
+        }
+        return __CFArenaGetChunkData(chunk);
+    }
+    chunk = __CFArenaCreateChunk(arena, arena->chunkSize);
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    block = __CFArenaGetChunkData(chunk);
+    arena->cursor = block + size;
+    arena->end = block + chunk->size;
+    return block;
+}
+
+static void* __CFArenaAllocate(CFIndex size, CFOptionFlags hint, void* info) {
+    __CFArena* arena = (__CFArena*)info;
+    uint8_t* block;
+    CFLock(&arena->lock);
+    block = __CFArenaAllocateBlock(arena, __kCFArenaAlignment + __CFArenaRound(size));
+    CFUnlock(&arena->lock);
+    if (!block) {
+        return NULL;
+    }
+    *(CFIndex*)block = size;
+    return block + __kCFArenaAlignment;
+}
+
+static void* __CFArenaReallocate(void* ptr, CFIndex newsize, CFOptionFlags hint, void* info) {
+    __CFArena* arena = (__CFArena*)info;
+    CFIndex* header = (CFIndex*)((uint8_t*)ptr - __kCFArenaAlignment);
+    CFIndex size = *header;
+    void* newptr;
+    if (__CFArenaRound(newsize) <= __CFArenaRound(size)) {
+        *header = newsize;
+        return ptr;
+    }
+    CFLock(&arena->lock);
+    if ((uint8_t*)ptr + __CFArenaRound(size) == arena->cursor &&
+        (uint8_t*)ptr + __CFArenaRound(newsize) <= arena->end)
+    {
+        // The last block, grow it in place.
+        arena->cursor = (uint8_t*)ptr + __CFArenaRound(newsize);
+        CFUnlock(&arena->lock);
+        *header = newsize;
+        return ptr;
+    }
+    CFUnlock(&arena->lock);
+    newptr = __CFArenaAllocate(newsize, hint, info);
+    if (newptr) {
+        memmove(newptr, ptr, size);
+    }
+    return newptr;
+}
+
+static void __CFArenaFreeChunks(__CFArena* arena, __CFArenaChunk* chunk) {
+    while (chunk) {
+        __CFArenaChunk* next = chunk->next;
+        CFAllocatorDeallocate(arena->allocator, chunk);
+        chunk = next;
+    }
+}
+
+static void __CFArenaRelease(const void* info) {
+    __CFArena* arena = (__CFArena*)info;
+    CFAllocatorRef allocator = arena->allocator;
+    __CFArenaFreeChunks(arena, arena->chunks);
+    CFAllocatorDeallocate(allocator, arena);
+    CFRelease(allocator);
+}
+
+static CFStringRef __CFArenaCopyDescription(const void* info) {
+    __CFArena* arena = (__CFArena*)info;
+    return CFStringCreateWithFormat(
+        kCFAllocatorSystemDefault,
+        NULL, CFSTR("<CFAllocator arena %p>{chunk size = %ld}"),
+        arena, (long)arena->chunkSize);
+}
+
+/* Tracking */
+
+typedef struct {
+    CFLock_t lock;
+    CFAllocatorRef allocator; // blocks are allocated from it
+    CFAllocatorRef self; // not retained, for the callback
+    CFAllocatorPressureCallBack callback;
+    void* info;
+    CFAllocatorTrackingStatistics statistics;
+} __CFTracking;
+
+/* Each block is prefixed with its size, so that it can be accounted
+ *  on deallocation. Header is padded to keep the alignment.
+ */
+#define __kCFTrackingHeaderSize (2 * sizeof(void*))
+
+/* Reserves 'size' bytes (which can be negative), honoring the limit.
+ *  Allocation is counted when 'allocation' is true.
+ */
+static Boolean __CFTrackingReserve(__CFTracking* tracking, CFIndex size, Boolean allocation) {
+    CFAllocatorTrackingStatistics* statistics = &tracking->statistics;
+    Boolean result = true;
+    CFLock(&tracking->lock);
+    if (size > 0 && statistics->limit && statistics->liveBytes + size > statistics->limit) {
+        result = false;
+    } else {
+        statistics->liveBytes += size;
+        if (statistics->liveBytes > statistics->highWaterBytes) {
+            statistics->highWaterBytes = statistics->liveBytes;
+        }
+        if (allocation) {
+            statistics->liveAllocationCount++;
+            statistics->allocationCount++;
+        }
+    }
+    CFUnlock(&tracking->lock);
+    return result;
+}
+
+static void __CFTrackingUnreserve(__CFTracking* tracking, CFIndex size, Boolean deallocation) {
+    CFLock(&tracking->lock);
+    tracking->statistics.liveBytes -= size;
+    if (deallocation) {
+        tracking->statistics.liveAllocationCount--;
+    }
+    CFUnlock(&tracking->lock);
+}
+
+/* Calls pressure callback if reservation fails. */
+static Boolean __CFTrackingReserveUnderPressure(__CFTracking* tracking, CFIndex size, Boolean allocation) {
+    if (__CFTrackingReserve(tracking, size, allocation)) {
+        return true;
+    }
+    if (tracking->callback &&
+        tracking->callback(tracking->self, size, tracking->info) &&
+        __CFTrackingReserve(tracking, size, allocation))
+    {
+        return true;
+    }
+    CFLock(&tracking->lock);
+    tracking->statistics.failedAllocationCount++;
+    CFUnlock(&tracking->lock);
+    return false;
+}
+
+static void* __CFTrackingAllocate(CFIndex size, CFOptionFlags hint, void* info) {
+    __CFTracking* tracking = (__CFTracking*)info;
+    uint8_t* block;
+    if (!__CFTrackingReserveUnderPressure(tracking, size, true)) {
+        return NULL;
+    }
+    block = (uint8_t*)CFAllocatorAllocate(tracking->allocator, __kCFTrackingHeaderSize + size, hint);
+    if (!block) {
+        __CFTrackingUnreserve(tracking, size, true);
+        return NULL;
+    }
+    *(CFIndex*)block = size;
+    return block + __kCFTrackingHeaderSize;
+}
+
+static void* __CFTrackingReallocate(void* ptr, CFIndex newsize, CFOptionFlags hint, void* info) {
+    __CFTracking* tracking = (__CFTracking*)info;
+    uint8_t* block = (uint8_t*)ptr - __kCFTrackingHeaderSize;
+    CFIndex size = *(CFIndex*)block;
+    if (!__CFTrackingReserveUnderPressure(tracking, newsize - size, false)) {
+        return NULL;
+    }
+    block = (uint8_t*)CFAllocatorReallocate(tracking->allocator, block, __kCFTrackingHeaderSize + newsize, hint);
+    if (!block) {
+        __CFTrackingUnreserve(tracking, newsize - size, false);
+        return NULL;
+    }
+    *(CFIndex*)block = newsize;
+    return block + __kCFTrackingHeaderSize;
+}
+
+static void __CFTrackingDeallocate(void* ptr, void* info) {
+    __CFTracking* tracking = (__CFTracking*)info;
+    uint8_t* block = (uint8_t*)ptr - __kCFTrackingHeaderSize;
+    __CFTrackingUnreserve(tracking, *(CFIndex*)block, true);
+    CFAllocatorDeallocate(tracking->allocator, block);
+}
+
+static void __CFTrackingRelease(const void* info) {
+    __CFTracking* tracking = (__CFTracking*)info;
+    CFAllocatorRef allocator = tracking->allocator;
+    CFAllocatorDeallocate(allocator, tracking);
+    CFRelease(allocator);
+}
+
+static CFStringRef __CFTrackingCopyDescription(const void* info) {
+    __CFTracking* tracking = (__CFTracking*)info;
+    return CFStringCreateWithFormat(
+        kCFAllocatorSystemDefault,
+        NULL, CFSTR("<CFAllocator tracking %p>{live bytes = %ld, high-water = %ld, limit = %ld}"),
+        tracking,
+        tracking->statistics.liveBytes,
+        tracking->statistics.highWaterBytes,
+        tracking->statistics.limit);
+}
+
+static Boolean __CFAllocatorIsTracking(CFAllocatorRef allocator) {
+    return !_CFIsMallocZone(allocator) && allocator->_context.allocate == __CFTrackingAllocate;
+}
+
+/* Huge page */
+
+typedef struct {
+    CFAllocatorRef allocator; // small blocks are allocated from it
+    CFIndex threshold;
+} __CFHugePage;
+
+/* Each block is prefixed with its size and the size of its mapping,
+ *  which is 0 for blocks allocated from the underlying allocator.
+ *  Mappings are whole huge pages, so huge blocks can grow in place.
+ */
+typedef struct {
+    CFIndex size;
+    CFIndex mappedSize;
+} __CFHugePageHeader;
+
+#define __kCFHugePageHeaderSize (2 * sizeof(void*))
+#define __kCFHugePageDefaultThreshold (1024 * 1024)
+
+CF_INLINE __CFHugePageHeader* __CFHugePageGetHeader(void* ptr) {
+    return (__CFHugePageHeader*)((uint8_t*)ptr - __kCFHugePageHeaderSize);
+}
+
+CF_INLINE CFIndex __CFHugePageRoundToMapping(CFIndex size) {
+    CFIndex pageSize = CFPlatformGetHugePageSize();
+    return (__kCFHugePageHeaderSize + size + pageSize - 1) & ~(pageSize - 1);
+}
+
+static void* __CFHugePageAllocate(CFIndex size, CFOptionFlags hint, void* info) {
+    __CFHugePage* hugePage = (__CFHugePage*)info;
+    __CFHugePageHeader* header;
+    if (size >= hugePage->threshold) {
+        CFIndex mappedSize = __CFHugePageRoundToMapping(size);
+        header = (__CFHugePageHeader*)CFPlatformAllocateHugePages(mappedSize);
+        if (header) {
+            header->mappedSize = mappedSize;
+        }
+    } else {
+        header = (__CFHugePageHeader*)CFAllocatorAllocate(
+            hugePage->allocator, __kCFHugePageHeaderSize + size, hint);
+        if (header) {
+            header->mappedSize = 0;
+        }
+    }
+    if (!header) {
+        return NULL;
+    }
+    header->size = size;
+    return (uint8_t*)header + __kCFHugePageHeaderSize;
+}
+
+static void __CFHugePageDeallocate(void* ptr, void* info) {
+    __CFHugePage* hugePage = (__CFHugePage*)info;
+    __CFHugePageHeader* header = __CFHugePageGetHeader(ptr);
+    if (header->mappedSize) {
+        CFPlatformFreeHugePages(header, header->mappedSize);
+    } else {
+        CFAllocatorDeallocate(hugePage->allocator, header);
+    }
+}
+
+static void* __CFHugePageReallocate(void* ptr, CFIndex newsize, CFOptionFlags hint, void* info) {
+    __CFHugePage* hugePage = (__CFHugePage*)info;
+    __CFHugePageHeader* header = __CFHugePageGetHeader(ptr);
+    void* newptr;
+    if (header->mappedSize) {
+        if (__kCFHugePageHeaderSize + newsize <= header->mappedSize) {
+            header->size = newsize;
+            return ptr;
+        }
+    } else if (newsize < hugePage->threshold) {
+        header = (__CFHugePageHeader*)CFAllocatorReallocate(
+            hugePage->allocator, header, __kCFHugePageHeaderSize + newsize, hint);
+        if (!header) {
+            return NULL;
+        }
+        header->size = newsize;
+        return (uint8_t*)header + __kCFHugePageHeaderSize;
+    }
+    // Block moves to (or between) mappings.
+    newptr = __CFHugePageAllocate(newsize, hint, info);
+    if (!newptr) {
+        return NULL;
+    }
+    memmove(newptr, ptr, (header->size < newsize) ? header->size : newsize);
+    __CFHugePageDeallocate(ptr, info);
+    return newptr;
+}
+
+static CFIndex __CFHugePagePreferredSize(CFIndex size, CFOptionFlags hint, void* info) {
+    __CFHugePage* hugePage = (__CFHugePage*)info;
+    if (size >= hugePage->threshold) {
+        return __CFHugePageRoundToMapping(size) - __kCFHugePageHeaderSize;
+    }
+    return size;
+}
+
+static void __CFHugePageRelease(const void* info) {
+    __CFHugePage* hugePage = (__CFHugePage*)info;
+    CFAllocatorRef allocator = hugePage->allocator;
+    CFAllocatorDeallocate(allocator, hugePage);
+    CFRelease(allocator);
+}
+
+static CFStringRef __CFHugePageCopyDescription(const void* info) {
+    __CFHugePage* hugePage = (__CFHugePage*)info;
+    return CFStringCreateWithFormat(
+        kCFAllocatorSystemDefault,
+        NULL, CFSTR("<CFAllocator huge page %p>{threshold = %ld}"),
+        hugePage, hugePage->threshold);
+}
+
 /* __kCFAllocatorNull */
 
 static void* __CFAllocatorNullAllocate(CFIndex size, CFOptionFlags hint, void* info) {
@@ -308,8 +698,13 @@ CF_INTERNAL CFAllocatorRef _CFAllocatorGetAllocator(CFTypeRef cf) {
     return (kCFAllocatorUseContext == allocator->_allocator) ? allocator : allocator->_allocator;
 }
 
+CF_INTERNAL Boolean _CFAllocatorIsArena(CFAllocatorRef allocator) {
+    return !_CFIsMallocZone(allocator) && allocator->_context.allocate == __CFArenaAllocate;
+}
+
 CF_INTERNAL void _CFAllocatorInitialize(void) {
     __kCFAllocatorTypeID = _CFRuntimeRegisterClass(&__CFAllocatorClass);
+    _CFSlabInitialize();
 
     _CFRuntimeInitStaticInstance(&__kCFAllocatorSystemDefault, __kCFAllocatorTypeID);
     __kCFAllocatorSystemDefault._allocator = kCFAllocatorSystemDefault;
@@ -341,7 +736,8 @@ CFTypeID CFAllocatorGetTypeID(void) {
 }
 
 CFAllocatorRef CFAllocatorGetDefault(void) {
-    CFAllocatorRef allocator = _CFGetThreadSpecificData()->_allocator;
+    // Set only through CFAllocatorSetDefault(), which registers the block.
+    CFAllocatorRef allocator = _CFThreadData._allocator;
     if (!allocator) {
         allocator = kCFAllocatorSystemDefault;
     }
@@ -439,6 +835,16 @@ void* CFAllocatorAllocate(CFAllocatorRef allocator, CFIndex size, CFOptionFlags
     if (!allocator->_context.allocate) {
         return NULL;
     }
+    if (_CFHeapProfileRate) {
+        void* block;
+        _CFThreadData._heapProfileDepth++;
+        block = allocator->_context.allocate(size, hint, allocator->_context.info);
+        _CFThreadData._heapProfileDepth--;
+        if (block) {
+            _CFHeapProfileRecordAllocation(block, size, _kCFRuntimeNotATypeID);
+        }
+        return block;
+    }
     return allocator->_context.allocate(size, hint, allocator->_context.info);
 }
 
@@ -449,21 +855,10 @@ void* CFAllocatorReallocate(CFAllocatorRef allocator, void* ptr, CFIndex newsize
     }
     
     if (!ptr && newsize > 0) {
-        if (_CFIsMallocZone(allocator)) {
-            return malloc_zone_malloc(__CFAllocatorCastToZone(allocator), newsize);
-        }
-        if (allocator->_context.allocate) {
-            return allocator->_context.allocate(newsize, hint, allocator->_context.info);
-        }
+        return CFAllocatorAllocate(allocator, newsize, hint);
     }
     if (ptr && !newsize) {
-        if (_CFIsMallocZone(allocator)) {
-            malloc_zone_free(__CFAllocatorCastToZone(allocator), ptr);
-            return NULL;
-        }
-        if (allocator->_context.deallocate) {
-            allocator->_context.deallocate(ptr, allocator->_context.info);
-        }
+        CFAllocatorDeallocate(allocator, ptr);
         return NULL;
     }
     if (!ptr && !newsize) {
@@ -475,6 +870,18 @@ void* CFAllocatorReallocate(CFAllocatorRef allocator, void* ptr, CFIndex newsize
     if (!allocator->_context.reallocate) {
         return NULL;
     }
+    // Old block's sample is dropped even if reallocation fails.
+    _CFHeapProfileRecordDeallocation(ptr);
+    if (_CFHeapProfileRate) {
+        void* block;
+        _CFThreadData._heapProfileDepth++;
+        block = allocator->_context.reallocate(ptr, newsize, hint, allocator->_context.info);
+        _CFThreadData._heapProfileDepth--;
+        if (block) {
+            _CFHeapProfileRecordAllocation(block, newsize, _kCFRuntimeNotATypeID);
+        }
+        return block;
+    }
     return allocator->_context.reallocate(ptr, newsize, hint, allocator->_context.info);
 }
 
@@ -487,6 +894,7 @@ void CFAllocatorDeallocate(CFAllocatorRef allocator, void* ptr) {
     CF_VALIDATE_ALLOCATOR_ARG(allocator);
     
     if (ptr && allocator->_context.deallocate) {
+        _CFHeapProfileRecordDeallocation(ptr);
         allocator->_context.deallocate(ptr, allocator->_context.info);
     }
 }
@@ -526,3 +934,140 @@ void CFAllocatorGetContext(CFAllocatorRef allocator, CFAllocatorContext* context
     context->deallocate = allocator->_context.deallocate;
     context->preferredSize = allocator->_context.preferredSize;
 }
+
+CFAllocatorRef CFAllocatorCreateArena(CFAllocatorRef allocator, CFIndex chunkSize) {
+    CFAllocatorContext context = {0};
+    CFAllocatorRef result;
+    __CFArena* arena;
+    CF_VALIDATE_NONNEGATIVE_ARG(chunkSize);
+    allocator = allocator ? allocator : CFAllocatorGetDefault();
+    if (_CFAllocatorIsArena(allocator)) {
+        // Nested arena would be freed by the parent's reset.
+        return NULL;
+    }
+
+    arena = (__CFArena*)CFAllocatorAllocate(allocator, sizeof(__CFArena), 0);
+    if (!arena) {
+        return NULL;
+    }
+    arena->lock = CFLockInit;
+    arena->allocator = (CFAllocatorRef)CFRetain(allocator);
+    arena->chunkSize = __CFArenaRound(chunkSize ? chunkSize : __kCFArenaDefaultChunkSize);
+    arena->chunks = NULL;
+    arena->cursor = NULL;
+    arena->end = NULL;
+
+    context.info = arena;
+    context.release = __CFArenaRelease;
+    context.copyDescription = __CFArenaCopyDescription;
+    context.allocate = __CFArenaAllocate;
+    context.reallocate = __CFArenaReallocate;
+    result = CFAllocatorCreate(allocator, &context);
+    if (!result) {
+        __CFArenaRelease(arena);
+    }
+    return result;
+}
+
+void CFAllocatorArenaReset(CFAllocatorRef arenaAllocator) {
+    __CFArena* arena;
+    __CFArenaChunk* chunks;
+    CF_VALIDATE_ARG(_CFAllocatorIsArena(arenaAllocator), "allocator %p is not an arena", arenaAllocator);
+    arena = (__CFArena*)arenaAllocator->_context.info;
+    CFLock(&arena->lock);
+    chunks = arena->chunks;
+    if (chunks && chunks->size == arena->chunkSize) {
+        // Keep the current chunk, it will be needed again.
+        arena->chunks = chunks;
+        chunks = chunks->next;
+        arena->chunks->next = NULL;
+        arena->cursor = __CFArenaGetChunkData(arena->chunks);
+    } else {
+        arena->chunks = NULL;
+        arena->cursor = NULL;
+        arena->end = NULL;
+    }
+    CFUnlock(&arena->lock);
+    __CFArenaFreeChunks(arena, chunks);
+}
+
+CFAllocatorRef CFAllocatorCreateTracking(CFAllocatorRef allocator, CFIndex limit, CFAllocatorPressureCallBack callback, void* info) {
+    CFAllocatorContext context = {0};
+    CFAllocatorRef result;
+    __CFTracking* tracking;
+    CF_VALIDATE_NONNEGATIVE_ARG(limit);
+    allocator = allocator ? allocator : CFAllocatorGetDefault();
+
+    tracking = (__CFTracking*)CFAllocatorAllocate(allocator, sizeof(__CFTracking), 0);
+    if (!tracking) {
+        return NULL;
+    }
+    memset(tracking, 0, sizeof(__CFTracking));
+    tracking->lock = CFLockInit;
+    tracking->allocator = (CFAllocatorRef)CFRetain(allocator);
+    tracking->callback = callback;
+    tracking->info = info;
+    tracking->statistics.limit = limit;
+
+    context.info = tracking;
+    context.release = __CFTrackingRelease;
+    context.copyDescription = __CFTrackingCopyDescription;
+    context.allocate = __CFTrackingAllocate;
+    context.reallocate = __CFTrackingReallocate;
+    context.deallocate = __CFTrackingDeallocate;
+    result = CFAllocatorCreate(allocator, &context);
+    if (!result) {
+        __CFTrackingRelease(tracking);
+        return NULL;
+    }
+    tracking->self = result;
+    return result;
+}
+
+void CFAllocatorSetTrackingLimit(CFAllocatorRef trackingAllocator, CFIndex limit) {
+    __CFTracking* tracking;
+    CF_VALIDATE_ARG(__CFAllocatorIsTracking(trackingAllocator), "allocator %p is not a tracking allocator", trackingAllocator);
+    CF_VALIDATE_NONNEGATIVE_ARG(limit);
+    tracking = (__CFTracking*)trackingAllocator->_context.info;
+    CFLock(&tracking->lock);
+    tracking->statistics.limit = limit;
+    CFUnlock(&tracking->lock);
+}
+
+void CFAllocatorGetTrackingStatistics(CFAllocatorRef trackingAllocator, CFAllocatorTrackingStatistics* statistics) {
+    __CFTracking* tracking;
+    CF_VALIDATE_ARG(__CFAllocatorIsTracking(trackingAllocator), "allocator %p is not a tracking allocator", trackingAllocator);
+    CF_VALIDATE_PTR_ARG(statistics);
+    tracking = (__CFTracking*)trackingAllocator->_context.info;
+    CFLock(&tracking->lock);
+    *statistics = tracking->statistics;
+    CFUnlock(&tracking->lock);
+}
+
+CFAllocatorRef CFAllocatorCreateHugePage(CFAllocatorRef allocator, CFIndex threshold) {
+    CFAllocatorContext context = {0};
+    CFAllocatorRef result;
+    __CFHugePage* hugePage;
+    CF_VALIDATE_NONNEGATIVE_ARG(threshold);
+    allocator = allocator ? allocator : CFAllocatorGetDefault();
+
+    hugePage = (__CFHugePage*)CFAllocatorAllocate(allocator, sizeof(__CFHugePage), 0);
+    if (!hugePage) {
+        return NULL;
+    }
+    hugePage->allocator = (CFAllocatorRef)CFRetain(allocator);
+    hugePage->threshold = threshold ? threshold : __kCFHugePageDefaultThreshold;
+
+    context.info = hugePage;
+    context.release = __CFHugePageRelease;
+    context.copyDescription = __CFHugePageCopyDescription;
+    context.allocate = __CFHugePageAllocate;
+    context.reallocate = __CFHugePageReallocate;
+    context.deallocate = __CFHugePageDeallocate;
+    context.preferredSize = __CFHugePagePreferredSize;
+    result = CFAllocatorCreate(allocator, &context);
+    if (!result) {
+        __CFHugePageRelease(hugePage);
+    }
+    return result;
+}
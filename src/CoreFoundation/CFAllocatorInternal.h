@@ -25,9 +25,38 @@ CFAllocatorRef _CFAllocatorGetAllocator(CFTypeRef cf);
 CF_EXPORT
 void _CFAllocatorInitialize(void);
 
+CF_EXPORT
+Boolean _CFAllocatorIsArena(CFAllocatorRef allocator);
+
+/* Slab allocator for instances allocated with kCFAllocatorSystemDefault,
+ *  see CFAllocator_Slab.c.
+ */
+
+typedef struct __CFSlabThreadCache __CFSlabThreadCache;
+
+CF_EXPORT
+void _CFSlabInitialize(void);
+
+/* Returns NULL if 'size' is too large, or slab memory is exhausted. */
+CF_EXPORT
+void* _CFSlabAllocate(CFIndex size);
+
+CF_EXPORT
+void _CFSlabDeallocate(void* ptr);
+
+CF_EXPORT
+Boolean _CFSlabContains(const void* ptr);
+
+CF_EXPORT
+CFIndex _CFSlabGetSize(const void* ptr);
+
+CF_EXPORT
+void _CFSlabDestroyThreadCache(__CFSlabThreadCache* cache);
+
 // The only valid objects with NULL _cfisa are malloc_zone_t.
 CF_INLINE Boolean _CFIsMallocZone(CFTypeRef cf) {
-    return CF_BASE(cf)->_cfisa == NULL && CF_TYPEID(cf) == 0;  
+    return !_CFIsTaggedPointer(cf) &&
+        CF_BASE(cf)->_cfisa == NULL && CF_TYPEID(cf) == 0;
 }
 
 CF_EXTERN_C_END
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CFInternal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Slab allocator for CF instances
+ *
+ * Instances allocated with kCFAllocatorSystemDefault are small (most are
+ *  under 64 bytes) and short-lived, so they are allocated from a single
+ *  reserved address range, which is split into 64K slabs. Each slab holds
+ *  objects of one size class; classes are multiples of 16 up to 256 bytes
+ *  (runtime rounds instance sizes to 16). Since all slab memory is in one
+ *  range, any pointer can be checked for being a slab object.
+ *
+ * Each thread has a magazine (free list) per class, so allocation and
+ *  deallocation are lock-free. Objects freed by any thread go to that
+ *  thread's magazine; when it grows past two batches, a batch is returned
+ *  to the class depot. Empty magazine is refilled with a batch from the
+ *  depot, or carved from the class's current slab. Slab memory is never
+ *  returned to the system, it's reused through depots.
+ *
+ * Free objects are linked through their first word; first object of a
+ *  batch in the depot links to the next batch through its second word.
+ * If thread cache can't be allocated, allocation fails (so the caller
+ *  falls back to the backing allocator) and deallocated objects go
+ *  directly to the depot.
+ */
+
+#define __kCFSlabShift 16
+#define __kCFSlabSize (1 << __kCFSlabShift)
+#define __kCFSlabQuantumShift 4
+#define __kCFSlabMaxSize 256
+#define __kCFSlabClassCount (__kCFSlabMaxSize >> __kCFSlabQuantumShift)
+#define __kCFSlabBatchSize 32
+
+#if __LP64__
+    #define __kCFSlabRegionSize ((uintptr_t)4 << 30)
+#else
+    #define __kCFSlabRegionSize ((uintptr_t)64 << 20)
+#endif
+#define __kCFSlabCount (__kCFSlabRegionSize >> __kCFSlabShift)
+
+typedef struct {
+    void* head;
+    CFIndex count;
+} __CFSlabMagazine;
+
+struct __CFSlabThreadCache {
+    __CFSlabMagazine magazines[__kCFSlabClassCount];
+};
+
+typedef struct {
+    CFLock_t lock;
+    void* batches; // full batches
+    void* loose; // objects from partial magazines of exited threads
+    CFIndex looseCount;
+    uint8_t* cursor; // unused part of the current slab
+    uint8_t* end;
+} __CFSlabDepot;
+
+static uint8_t* __CFSlabRegion = NULL;
+static CFLock_t __CFSlabLock = CFLockInit; // guards __CFSlabNext
+static int32_t __CFSlabNext = 0; // index of the first unused slab
+static uint8_t __CFSlabClasses[__kCFSlabCount]; // class of each used slab
+static __CFSlabDepot __CFSlabDepots[__kCFSlabClassCount];
+
+///////////////////////////////////////////////////////////////////// private
+
+CF_INLINE void* __CFSlabGetNext(void* object) {
+    return *(void**)object;
+}
+
+CF_INLINE void __CFSlabSetNext(void* object, void* next) {
+    *(void**)object = next;
+}
+
+CF_INLINE void* __CFSlabGetNextBatch(void* batch) {
+    return ((void**)batch)[1];
+}
+
+CF_INLINE void __CFSlabSetNextBatch(void* batch, void* next) {
+    ((void**)batch)[1] = next;
+}
+
+CF_INLINE CFIndex __CFSlabGetClassSize(CFIndex index) {
+    return (index + 1) << __kCFSlabQuantumShift;
+}
+
+static __CFSlabThreadCache* __CFSlabGetThreadCache(void) {
+    _CFThreadSpecificData* tsd = _CFGetThreadSpecificData();
+    if (!tsd->_slabCache) {
+        tsd->_slabCache = (__CFSlabThreadCache*)calloc(1, sizeof(__CFSlabThreadCache));
+    }
+    return tsd->_slabCache;
+}
+
+/* Expects depot to be locked. Returns false when region is exhausted,
+ *  or slab memory can't be committed.
+ */
+static Boolean __CFSlabAddSlab(__CFSlabDepot* depot, CFIndex index) {
+    int32_t slab;
+    uint8_t* memory;
+    CFLock(&__CFSlabLock);
+    slab = __CFSlabNext;
+    if (slab >= (int32_t)__kCFSlabCount) {
+        CFUnlock(&__CFSlabLock);
+        return false;
+    }
+    memory = __CFSlabRegion + ((uintptr_t)slab << __kCFSlabShift);
+    if (!CFPlatformCommitMemory(memory, __kCFSlabSize)) {
+        // Slab stays unused, so it can be retried later
+        CFUnlock(&__CFSlabLock);
+        return false;
+    }
+    __CFSlabNext = slab + 1;
+    CFUnlock(&__CFSlabLock);
+    __CFSlabClasses[slab] = (uint8_t)index;
+    depot->cursor = memory;
+    depot->end = memory + __kCFSlabSize;
+    return true;
+}
+
+/* Moves up to a batch of objects from depot to empty 'magazine'. */
+static Boolean __CFSlabRefill(CFIndex index, __CFSlabMagazine* magazine) {
+    __CFSlabDepot* depot = &__CFSlabDepots[index];
+    CFIndex size = __CFSlabGetClassSize(index);
+    CFLock(&depot->lock);
+    if (depot->batches) {
+        void* batch = depot->batches;
+        depot->batches = __CFSlabGetNextBatch(batch);
+        magazine->head = batch;
+        magazine->count = __kCFSlabBatchSize;
+    } else if (depot->loose) {
+        magazine->head = depot->loose;
+        magazine->count = depot->looseCount;
+        depot->loose = NULL;
+        depot->looseCount = 0;
+    } else {
+        CFIndex count = 0;
+        void* head = NULL;
+        while (count != __kCFSlabBatchSize) {
+            if ((!depot->cursor || depot->cursor + size > depot->end) &&
+                !__CFSlabAddSlab(depot, index))
+            {
+                break;
+            }
+            __CFSlabSetNext(depot->cursor, head);
+            head = depot->cursor;
+            depot->cursor += size;
+            count++;
+        }
+        magazine->head = head;
+        magazine->count = count;
+    }
+    CFUnlock(&depot->lock);
+    return magazine->head != NULL;
+}
+
+/* Returns a batch from 'magazine' to the depot. */
+static void __CFSlabFlush(CFIndex index, __CFSlabMagazine* magazine) {
+    __CFSlabDepot* depot = &__CFSlabDepots[index];
+    void* batch = magazine->head;
+    void* last = batch;
+    CFIndex i;
+    for (i = 1; i != __kCFSlabBatchSize; ++i) {
+        last = __CFSlabGetNext(last);
+    }
+    magazine->head = __CFSlabGetNext(last);
+    magazine->count -= __kCFSlabBatchSize;
+    __CFSlabSetNext(last, NULL);
+
+    CFLock(&depot->lock);
+    __CFSlabSetNextBatch(batch, depot->batches);
+    depot->batches = batch;
+    CFUnlock(&depot->lock);
+}
+
+///////////////////////////////////////////////////////////////////// internal
+
+CF_INTERNAL void _CFSlabInitialize(void) {
+    __CFSlabRegion = (uint8_t*)CFPlatformReserveMemory(__kCFSlabRegionSize);
+    memset(__CFSlabDepots, 0, sizeof(__CFSlabDepots));
+    {
+        CFIndex i;
+        for (i = 0; i != __kCFSlabClassCount; ++i) {
+            __CFSlabDepots[i].lock = CFLockInit;
+        }
+    }
+}
+
+CF_INTERNAL Boolean _CFSlabContains(const void* ptr) {
+    return __CFSlabRegion &&
+        (const uint8_t*)ptr >= __CFSlabRegion &&
+        (const uint8_t*)ptr < __CFSlabRegion + __kCFSlabRegionSize;
+}
+
+CF_INTERNAL CFIndex _CFSlabGetSize(const void* ptr) {
+    uintptr_t slab = ((const uint8_t*)ptr - __CFSlabRegion) >> __kCFSlabShift;
+    return __CFSlabGetClassSize(__CFSlabClasses[slab]);
+}
+
+CF_INTERNAL void* _CFSlabAllocate(CFIndex size) {
+    __CFSlabThreadCache* cache;
+    __CFSlabMagazine* magazine;
+    CFIndex index;
+    void* object;
+    if (!__CFSlabRegion || size <= 0 || size > __kCFSlabMaxSize) {
+        return NULL;
+    }
+    cache = __CFSlabGetThreadCache();
+    if (!cache) {
+        return NULL;
+    }
+    index = (size - 1) >> __kCFSlabQuantumShift;
+    magazine = &cache->magazines[index];
+    if (!magazine->head && !__CFSlabRefill(index, magazine)) {
+        return NULL;
+    }
+    object = magazine->head;
+    magazine->head = __CFSlabGetNext(object);
+    magazine->count--;
+    return object;
+}
+
+CF_INTERNAL void _CFSlabDeallocate(void* ptr) {
+    uintptr_t slab = ((uint8_t*)ptr - __CFSlabRegion) >> __kCFSlabShift;
+    CFIndex index = __CFSlabClasses[slab];
+    __CFSlabThreadCache* cache = __CFSlabGetThreadCache();
+    __CFSlabMagazine* magazine;
+    if (!cache) {
+        __CFSlabDepot* depot = &__CFSlabDepots[index];
+        CFLock(&depot->lock);
+        __CFSlabSetNext(ptr, depot->loose);
+        depot->loose = ptr;
+        depot->looseCount++;
+        CFUnlock(&depot->lock);
+        return;
+    }
+    magazine = &cache->magazines[index];
+    __CFSlabSetNext(ptr, magazine->head);
+    magazine->head = ptr;
+    magazine->count++;
+    if (magazine->count >= 2 * __kCFSlabBatchSize) {
+        __CFSlabFlush(index, magazine);
+    }
+}
+
+CF_INTERNAL void _CFSlabDestroyThreadCache(__CFSlabThreadCache* cache) {
+    CFIndex index;
+    for (index = 0; index != __kCFSlabClassCount; ++index) {
+        __CFSlabMagazine* magazine = &cache->magazines[index];
+        __CFSlabDepot* depot = &__CFSlabDepots[index];
+        while (magazine->count >= __kCFSlabBatchSize) {
+            __CFSlabFlush(index, magazine);
+        }
+        if (magazine->head) {
+            void* last = magazine->head;
+            while (__CFSlabGetNext(last)) {
+                last = __CFSlabGetNext(last);
+            }
+            CFLock(&depot->lock);
+            __CFSlabSetNext(last, depot->loose);
+            depot->loose = magazine->head;
+            depot->looseCount += magazine->count;
+            CFUnlock(&depot->lock);
+        }
+    }
+    free(cache);
+}
@@ -100,7 +100,7 @@ CF_INLINE CFIndex __CFArrayDequeRoundUpCapacity(CFIndex capacity) {
     if (capacity < 4) {
         return 4;
     }
-    return _CFMin((1 << _CFLastBitSet(capacity)), __CF_MAX_BUCKETS_PER_DEQUE);
+    return _CFMin(((CFIndex)1 << _CFLastBitSet(capacity)), (CFIndex)__CF_MAX_BUCKETS_PER_DEQUE);
 }
 
 CF_INLINE CFIndex __CFArrayGetType(CFArrayRef array) {
@@ -361,7 +361,7 @@ static void __CFArrayRepositionDequeRegions(CFMutableArrayRef array, CFRange ran
     if (wiggle < 4) {
         wiggle = 4;
     }
-    if (deque->_capacity < (uint32_t)futureCnt || (cnt < futureCnt && L + R < wiggle)) {
+    if ((CFIndex)deque->_capacity < futureCnt || (cnt < futureCnt && L + R < wiggle)) {
         // must be inserting or space is tight, reallocate and re-center everything
         CFIndex capacity = __CFArrayDequeRoundUpCapacity(futureCnt + wiggle);
         CFIndex size = sizeof(__CFArrayDeque) + capacity * sizeof(__CFArrayBucket);
@@ -606,6 +606,17 @@ CF_INTERNAL CFArrayRef _CFArrayCreate_ex(CFAllocatorRef allocator, Boolean isMut
     return result;
 }
 
+CF_INTERNAL void _CFArrayApplyToObjects(CFArrayRef array, void (*applier)(CFTypeRef cf)) {
+    CFIndex idx, count;
+    if (__CFArrayGetCallBacks(array)->release != _CFTypeCollectionRelease) {
+        return;
+    }
+    count = __CFArrayGetCount(array);
+    for (idx = 0; idx < count; idx++) {
+        applier(__CFArrayGetBucketAtIndex(array, idx)->_item);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////// public
 
 const CFArrayCallBacks kCFTypeArrayCallBacks = {
@@ -29,6 +29,12 @@ void _CFArrayInitialize(void);
 CF_EXPORT
 CFArrayRef _CFArrayCreate_ex(CFAllocatorRef allocator, Boolean isMutable, const void** values, CFIndex numValues);
 
+/* Calls 'applier' for each value if values are CF objects, i.e. if
+ *  the array was created with CFType callbacks.
+ */
+CF_EXPORT
+void _CFArrayApplyToObjects(CFArrayRef array, void (*applier)(CFTypeRef cf));
+
 CF_EXTERN_C_END
 
 #endif /* !__COREFOUNDATION_CFARRAYINTERNAL__ */
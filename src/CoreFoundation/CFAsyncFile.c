@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <CoreFoundation/CFAsyncFile.h>
+#include "CFInternal.h"
+#include "CFRunLoop_Common.h"
+#include <string.h>
+
+/* Each run loop that submitted requests has a queue, which owns the
+ *  platform I/O ring. Ring's completion eventfd is watched by a file
+ *  descriptor port of a version 1 source, which is added to all modes
+ *  requests were submitted in. Source reaps completions and dispatches
+ *  them with CFRunLoopPerformFunction(), so that callbacks are called
+ *  only in request's mode.
+ * When the ring is not available (or is full) requests are executed
+ *  by a process-wide pool of worker threads, which hand completions
+ *  back to run loops the same way.
+ * Reads into the same data are serialized, because extending the data
+ *  can move the buffer of an in-flight read. Busy data are mapped to
+ *  their last read request; next read is started (in its run loop and
+ *  mode) when the previous one completes.
+ */
+
+typedef struct __CFAsyncFileRequest {
+    struct __CFAsyncFileRequest* next; // worker queue link
+    struct __CFAsyncFileRequest* nextRead; // next read into 'data'
+    CFRunLoopRef runLoop; // retained
+    CFStringRef mode; // retained
+    CFDataRef data; // retained
+    Boolean write;
+    int fd;
+    SInt64 offset;
+    void* buffer;
+    CFIndex length;
+    CFIndex dataLength; // length of 'data' before read
+    CFIndex result;
+    CFAsyncFileCallBack callback;
+    void* info;
+} __CFAsyncFileRequest;
+
+typedef struct {
+    CFPlatformIORingRef ring; // NULL if not available
+    CFRunLoopPortRef port;
+    CFRunLoopSourceRef source;
+    CFMutableSetRef modes; // modes 'source' was added to
+} __CFAsyncFileQueue;
+
+#define __kCFAsyncFileRingEntries 256
+#define __kCFAsyncFileReapBatch 32
+#define __kCFAsyncFileMaxWorkers 4
+
+static pthread_mutex_t __CFAsyncFileWorkLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __CFAsyncFileWorkCondition = PTHREAD_COND_INITIALIZER;
+static __CFAsyncFileRequest* __CFAsyncFileWorkHead = NULL;
+static __CFAsyncFileRequest* __CFAsyncFileWorkTail = NULL;
+static CFIndex __CFAsyncFileWorkerCount = 0;
+static CFIndex __CFAsyncFileIdleWorkerCount = 0;
+
+static CFLock_t __CFAsyncFileReadsLock = CFLockInit;
+static CFMutableDictionaryRef __CFAsyncFileReads = NULL; // data -> last read request
+
+///////////////////////////////////////////////////////////////////// private
+
+static void __CFAsyncFileStartDeferred(void* context);
+
+static void __CFAsyncFileDeallocateRequest(__CFAsyncFileRequest* request) {
+    CFRelease(request->data);
+    CFRelease(request->mode);
+    CFRelease(request->runLoop);
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, request);
+}
+
+/* Adds read request to the chain of reads into its data.
+ * Returns true if the read can be started now.
+ */
+static Boolean __CFAsyncFileBeginRead(__CFAsyncFileRequest* request) {
+    __CFAsyncFileRequest* last;
+    CFLock(&__CFAsyncFileReadsLock);
+    if (!__CFAsyncFileReads) {
+        __CFAsyncFileReads = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, NULL);
+    }
+    last = (__CFAsyncFileRequest*)CFDictionaryGetValue(__CFAsyncFileReads, request->data);
+    if (last) {
+        last->nextRead = request;
+    }
+    CFDictionarySetValue(__CFAsyncFileReads, request->data, request);
+    CFUnlock(&__CFAsyncFileReadsLock);
+    return !last;
+}
+
+/* Removes finished read request from the chain and starts the next one. */
+static void __CFAsyncFileEndRead(__CFAsyncFileRequest* request) {
+    __CFAsyncFileRequest* next;
+    CFLock(&__CFAsyncFileReadsLock);
+    next = request->nextRead;
+    if (!next) {
+        CFDictionaryRemoveValue(__CFAsyncFileReads, request->data);
+    }
+    CFUnlock(&__CFAsyncFileReadsLock);
+    if (next) {
+        CFRunLoopPerformFunction(next->runLoop, next->mode, __CFAsyncFileStartDeferred, next);
+    }
+}
+
+static void __CFAsyncFileComplete(void* context) {
+    __CFAsyncFileRequest* request = (__CFAsyncFileRequest*)context;
+    if (!request->write) {
+        CFIndex transferred = (request->result > 0) ? request->result : 0;
+        if (transferred < request->length) {
+            CFDataSetLength((CFMutableDataRef)request->data, request->dataLength + transferred);
+        }
+    }
+    if (request->callback) {
+        request->callback(request->data, request->result, request->info); /* CALLOUT */
+    }
+    if (!request->write) {
+        __CFAsyncFileEndRead(request);
+    }
+    __CFAsyncFileDeallocateRequest(request);
+}
+
+/* Worker pool */
+
+static void* __CFAsyncFileWorker(void* arg) {
+    pthread_mutex_lock(&__CFAsyncFileWorkLock);
+    while (true) {
+        __CFAsyncFileRequest* request;
+        while (!__CFAsyncFileWorkHead) {
+            __CFAsyncFileIdleWorkerCount++;
+            pthread_cond_wait(&__CFAsyncFileWorkCondition, &__CFAsyncFileWorkLock);
+            __CFAsyncFileIdleWorkerCount--;
+        }
+        request = __CFAsyncFileWorkHead;
+        __CFAsyncFileWorkHead = request->next;
+        if (!__CFAsyncFileWorkHead) {
+            __CFAsyncFileWorkTail = NULL;
+        }
+        pthread_mutex_unlock(&__CFAsyncFileWorkLock);
+
+        request->result = CFPlatformTransferFile(
+            request->write, request->fd, request->offset,
+            request->buffer, request->length);
+        CFRunLoopPerformFunction(request->runLoop, request->mode, __CFAsyncFileComplete, request);
+
+        pthread_mutex_lock(&__CFAsyncFileWorkLock);
+    }
+    return NULL;
+}
+
+static Boolean __CFAsyncFileEnqueueWork(__CFAsyncFileRequest* request) {
+    Boolean result = true;
+    request->next = NULL;
+    pthread_mutex_lock(&__CFAsyncFileWorkLock);
+    if (!__CFAsyncFileIdleWorkerCount && __CFAsyncFileWorkerCount < __kCFAsyncFileMaxWorkers) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (!pthread_create(&thread, &attr, __CFAsyncFileWorker, NULL)) {
+            __CFAsyncFileWorkerCount++;
+        }
+        pthread_attr_destroy(&attr);
+        // Busy workers will get to the request eventually.
+        result = (__CFAsyncFileWorkerCount != 0);
+    }
+    if (result) {
+        if (__CFAsyncFileWorkTail) {
+            __CFAsyncFileWorkTail->next = request;
+        } else {
+            __CFAsyncFileWorkHead = request;
+        }
+        __CFAsyncFileWorkTail = request;
+        pthread_cond_signal(&__CFAsyncFileWorkCondition);
+    }
+    pthread_mutex_unlock(&__CFAsyncFileWorkLock);
+    return result;
+}
+
+/* Ring queue */
+
+static CFRunLoopPortRef __CFAsyncFileQueueGetPort(void* info) {
+    return ((__CFAsyncFileQueue*)info)->port;
+}
+
+static void __CFAsyncFileQueuePerform(void* info) {
+    __CFAsyncFileQueue* queue = (__CFAsyncFileQueue*)info;
+    void* contexts[__kCFAsyncFileReapBatch];
+    CFIndex results[__kCFAsyncFileReapBatch];
+    CFIndex count;
+    do {
+        CFIndex i;
+        count = CFPlatformIORingReap(queue->ring, contexts, results, __kCFAsyncFileReapBatch);
+        for (i = 0; i != count; ++i) {
+            __CFAsyncFileRequest* request = (__CFAsyncFileRequest*)contexts[i];
+            request->result = results[i];
+            CFRunLoopPerformFunction(request->runLoop, request->mode, __CFAsyncFileComplete, request);
+        }
+    } while (count == __kCFAsyncFileReapBatch);
+}
+
+static __CFAsyncFileQueue* __CFAsyncFileGetQueue(CFRunLoopRef rl) {
+    __CFAsyncFileQueue* queue = (__CFAsyncFileQueue*)_CFRunLoopGetAsyncFileQueue(rl);
+    if (queue) {
+        return queue;
+    }
+    queue = (__CFAsyncFileQueue*)CFAllocatorAllocate(
+        kCFAllocatorSystemDefault, sizeof(__CFAsyncFileQueue), 0);
+    if (!queue) {
+        return NULL;
+    }
+    memset(queue, 0, sizeof(__CFAsyncFileQueue));
+    queue->ring = CFPlatformIORingCreate(__kCFAsyncFileRingEntries);
+    if (queue->ring) {
+        queue->port = CFRunLoopPortCreateWithFileDescriptor(
+            kCFAllocatorSystemDefault,
+            CFPlatformIORingGetEventFD(queue->ring));
+        if (queue->port && CFRunLoopPortSetFileDescriptorEvents(queue->port, kCFRunLoopPortReadEvent)) {
+            // Queue is owned by the run loop, so source doesn't retain it.
+            CFRunLoopSourceContext1 context = {
+                1, // version
+                (void*)queue,
+                NULL, // retain
+                NULL, // release
+                NULL, // copyDescription
+                NULL, // equal
+                NULL, // hash
+                __CFAsyncFileQueueGetPort,
+                __CFAsyncFileQueuePerform
+            };
+            queue->source = CFRunLoopSourceCreate(kCFAllocatorSystemDefault, 0, (CFRunLoopSourceContext*)&context);
+            queue->modes = CFSetCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeSetCallBacks);
+        } else {
+            if (queue->port) {
+                CFRelease(queue->port);
+                queue->port = NULL;
+            }
+            CFPlatformIORingDestroy(queue->ring);
+            queue->ring = NULL;
+        }
+    }
+    _CFRunLoopSetAsyncFileQueue(rl, queue);
+    return queue;
+}
+
+static Boolean __CFAsyncFileQueueSubmit(__CFAsyncFileQueue* queue, __CFAsyncFileRequest* request) {
+    if (!queue || !queue->ring) {
+        return false;
+    }
+    if (!CFSetContainsValue(queue->modes, request->mode)) {
+        CFSetAddValue(queue->modes, request->mode);
+        CFRunLoopAddSource(request->runLoop, queue->source, request->mode);
+    }
+    return CFPlatformIORingSubmit(
+        queue->ring,
+        request->write, request->fd, request->offset,
+        request->buffer, request->length,
+        request);
+}
+
+/* Extends data for read, and submits the request to the ring or to
+ *  the workers. Data is restored if the request can't be submitted.
+ */
+static Boolean __CFAsyncFileStart(__CFAsyncFileRequest* request) {
+    CFDataRef data = request->data;
+    request->dataLength = CFDataGetLength(data);
+    if (request->write) {
+        request->buffer = (void*)CFDataGetBytePtr(data);
+    } else {
+        CFDataIncreaseLength((CFMutableDataRef)data, request->length);
+        request->buffer = CFDataGetMutableBytePtr((CFMutableDataRef)data) + request->dataLength;
+    }
+
+    if (__CFAsyncFileQueueSubmit(__CFAsyncFileGetQueue(request->runLoop), request) ||
+        __CFAsyncFileEnqueueWork(request))
+    {
+        return true;
+    }
+
+    if (!request->write) {
+        CFDataSetLength((CFMutableDataRef)data, request->dataLength);
+    }
+    return false;
+}
+
+/* Starts read which waited for the previous read into the same data.
+ * Failure to start is reported through the callback.
+ */
+static void __CFAsyncFileStartDeferred(void* context) {
+    __CFAsyncFileRequest* request = (__CFAsyncFileRequest*)context;
+    if (!__CFAsyncFileStart(request)) {
+        request->result = -EAGAIN;
+        __CFAsyncFileComplete(request);
+    }
+}
+
+static Boolean __CFAsyncFileSubmit(Boolean write, int fd, SInt64 offset, CFIndex length, CFDataRef data, CFStringRef mode, CFAsyncFileCallBack callback, void* info) {
+    CFRunLoopRef rl = CFRunLoopGetCurrent();
+    __CFAsyncFileRequest* request = (__CFAsyncFileRequest*)CFAllocatorAllocate(
+        kCFAllocatorSystemDefault, sizeof(__CFAsyncFileRequest), 0);
+    if (!request) {
+        return false;
+    }
+    request->next = NULL;
+    request->nextRead = NULL;
+    request->runLoop = (CFRunLoopRef)CFRetain(rl);
+    request->mode = (CFStringRef)CFRetain(mode);
+    request->data = (CFDataRef)CFRetain(data);
+    request->write = write;
+    request->fd = fd;
+    request->offset = offset;
+    request->buffer = NULL;
+    request->length = length;
+    request->dataLength = 0;
+    request->result = 0;
+    request->callback = callback;
+    request->info = info;
+
+    if (!write && !__CFAsyncFileBeginRead(request)) {
+        // Started when the previous read completes.
+        return true;
+    }
+    if (__CFAsyncFileStart(request)) {
+        return true;
+    }
+    if (!write) {
+        __CFAsyncFileEndRead(request);
+    }
+    __CFAsyncFileDeallocateRequest(request);
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////// internal
+
+CF_INTERNAL void _CFAsyncFileQueueDestroy(void* queuePtr) {
+    __CFAsyncFileQueue* queue = (__CFAsyncFileQueue*)queuePtr;
+    if (queue->source) {
+        CFRunLoopSourceInvalidate(queue->source);
+        CFRelease(queue->source);
+    }
+    if (queue->modes) {
+        CFRelease(queue->modes);
+    }
+    if (queue->port) {
+        CFRelease(queue->port);
+    }
+    // Requests retain the run loop, so there are none in flight.
+    CFPlatformIORingDestroy(queue->ring);
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, queue);
+}
+
+///////////////////////////////////////////////////////////////////// public
+
+Boolean CFAsyncFileRead(int fd, SInt64 offset, CFIndex length, CFMutableDataRef data, CFStringRef mode, CFAsyncFileCallBack callback, void* info) {
+    CF_VALIDATE_PTR_ARG(data);
+    CF_VALIDATE_PTR_ARG(mode);
+    CF_VALIDATE_LENGTH_ARG(length);
+    return __CFAsyncFileSubmit(false, fd, offset, length, data, mode, callback, info);
+}
+
+Boolean CFAsyncFileWrite(int fd, SInt64 offset, CFDataRef data, CFStringRef mode, CFAsyncFileCallBack callback, void* info) {
+    CF_VALIDATE_PTR_ARG(data);
+    CF_VALIDATE_PTR_ARG(mode);
+    return __CFAsyncFileSubmit(true, fd, offset, CFDataGetLength(data), data, mode, callback, info);
+}
@@ -23,6 +23,448 @@
  */
 
 #include "CFInternal.h"
+#include <CoreFoundation/CFRunLoop.h>
+
+///////////////////////////////////////////////////////////////////// private
+
+/* Biased reference counting
+ *
+ * Most objects are retained and released only by the thread that created
+ *  them, so _rc of objects created by _CFRuntimeCreateInstance() is split
+ *  into two 16-bit halves:
+ *   - local count, changed by the owner thread with plain stores;
+ *   - shared count, changed by other threads with CAS on the whole _rc.
+ * Owner thread is identified by a small index kept in CF_RC_OWNER; zero
+ *  index means that the whole _rc is a shared count (static objects,
+ *  allocators, objects created while all indices are taken).
+ *
+ * Until the object is merged its local count is at least 1. Owner merges
+ *  the object (sets __kCFRCMerged in shared half) instead of dropping local
+ *  count to zero, after that the object is counted by the shared half only.
+ * Shared count never goes negative: another thread releasing unmerged
+ *  object with zero shared count queues the release to the owner. Owner
+ *  applies queued releases when it releases objects, before its run loop
+ *  sleeps, when its run loop wakes up and when it exits. First release
+ *  queued to a sleeping owner wakes its run loop up.
+ * Index of an exited thread is retired until all of its objects are freed;
+ *  with no owner thread around, local count is changed with CAS by anyone.
+ *
+ * Shared count doesn't saturate: before it reaches __kCFRCSharedMax a batch
+ *  of references is moved to the spill table and __kCFRCSpilled is set.
+ *  References are moved back before the shared count could drop below 1.
+ * Shared count of __kCFRCSharedMax marks an immortal object. That's how
+ *  CFMakeImmortal() works for objects with an owner: unlike zeroing _rc it
+ *  can't race with owner's plain stores. Objects are also made immortal
+ *  (leaked) when the spill table or the pending releases list can't grow.
+ */
+
+typedef union {
+    int32_t rc;
+    uint16_t counts[2];
+} __CFRCValue;
+
+#define __kCFRCLocal 0
+#define __kCFRCShared 1
+#define __kCFRCMerged 0x8000
+#define __kCFRCSpilled 0x4000
+#define __kCFRCSharedCountMask 0x3FFF
+#define __kCFRCSharedMax 0x3FFF
+#define __kCFRCSpillBatch 0x2000
+#define __kCFRCLocalMax 0xFFFF
+#define __kCFRCOwnerCount 256
+
+#define __CFRCSharedCount(shared) ((shared) & __kCFRCSharedCountMask)
+
+typedef struct {
+    CFTypeRef* objects;
+    CFIndex count;
+    CFIndex capacity;
+} __CFRCPendingList;
+
+enum {
+    __kCFRCOwnerFree = 0,
+    __kCFRCOwnerAlive,
+    __kCFRCOwnerRetired
+};
+
+/* Live objects of an owner are created - ownerFreed - foreignFreed,
+ *  computed modulo 2^32.
+ * Pending lists are kept when the owner index is freed, so that
+ *  queueing a release allocates only when the list grows.
+ */
+typedef struct {
+    volatile int32_t state;
+    CFLock_t pendingLock;
+    __CFRCPendingList pending;      // guarded by pendingLock
+    __CFRCPendingList draining;     // used by the thread that set isDraining
+    Boolean isDraining;             // guarded by pendingLock
+    CFRunLoopRef sleepingRunLoop;   // guarded by pendingLock
+    uint32_t created;     // changed by owner thread only
+    uint32_t ownerFreed;  // changed by owner thread only
+    volatile int32_t foreignFreed;
+} __CFRCOwner;
+
+static __CFRCOwner __CFRCOwners[__kCFRCOwnerCount];
+static CFLock_t __CFRCOwnersLock = CFLockInit;
+
+typedef struct {
+    CFTypeRef object;
+    uint32_t count;
+} __CFRCSpill;
+
+static __CFRCSpill* __CFRCSpills = NULL;
+static CFIndex __CFRCSpillCount = 0;
+static CFIndex __CFRCSpillCapacity = 0;
+static CFLock_t __CFRCSpillLock = CFLockInit;
+
+static Boolean __CFRCMakeImmortal(CFTypeRef cf);
+
+static uint8_t __CFRCAcquireOwner(void) {
+    uint8_t index = 0;
+    CFIndex i;
+    CFLock(&__CFRCOwnersLock);
+    for (i = 1; i < __kCFRCOwnerCount; ++i) {
+        __CFRCOwner* owner = &__CFRCOwners[i];
+        if (owner->state == __kCFRCOwnerFree) {
+            owner->state = __kCFRCOwnerAlive;
+            owner->created = 0;
+            owner->ownerFreed = 0;
+            owner->foreignFreed = 0;
+            index = (uint8_t)i;
+            break;
+        }
+    }
+    CFUnlock(&__CFRCOwnersLock);
+    return index;
+}
+
+// Returns owner index of the current thread, or 0 if there is none.
+CF_INLINE uint8_t __CFRCGetCurrentOwner(void) {
+    _CFThreadSpecificData* tsd = _CFGetThreadSpecificData();
+    if (!tsd->_rcOwner) {
+        tsd->_rcOwner = 0x100 | __CFRCAcquireOwner();
+    }
+    return (uint8_t)tsd->_rcOwner;
+}
+
+static void __CFRCTryFreeOwner(__CFRCOwner* owner) {
+    CFLock(&__CFRCOwnersLock);
+    if (owner->state == __kCFRCOwnerRetired &&
+        owner->created - owner->ownerFreed - (uint32_t)owner->foreignFreed == 0)
+    {
+        owner->state = __kCFRCOwnerFree;
+    }
+    CFUnlock(&__CFRCOwnersLock);
+}
+
+/* Only one thread drains at a time; releases queued while it drains
+ *  (including ones queued by the releases it applies) are picked up
+ *  by the same thread before it returns.
+ */
+static void __CFRCDrainPending(__CFRCOwner* owner) {
+    CFLock(&owner->pendingLock);
+    if (owner->isDraining) {
+        CFUnlock(&owner->pendingLock);
+        return;
+    }
+    owner->isDraining = true;
+    while (owner->pending.count) {
+        __CFRCPendingList list = owner->draining;
+        CFIndex i;
+        owner->draining = owner->pending;
+        owner->pending = list;
+        CFUnlock(&owner->pendingLock);
+        for (i = 0; i != owner->draining.count; ++i) {
+            CFRelease(owner->draining.objects[i]);
+        }
+        owner->draining.count = 0;
+        CFLock(&owner->pendingLock);
+    }
+    owner->isDraining = false;
+    CFUnlock(&owner->pendingLock);
+}
+
+// Returns false if the release can't be queued.
+static Boolean __CFRCPushPending(__CFRCOwner* owner, CFTypeRef cf) {
+    __CFRCPendingList* pending = &owner->pending;
+    CFRunLoopRef wakeUpRunLoop = NULL;
+    CFLock(&owner->pendingLock);
+    if (pending->count == pending->capacity) {
+        CFIndex capacity = pending->capacity ? 2 * pending->capacity : 16;
+        CFTypeRef* objects = (CFTypeRef*)CFAllocatorReallocate(
+            kCFAllocatorSystemDefault, pending->objects, capacity * sizeof(CFTypeRef), 0);
+        if (!objects) {
+            CFUnlock(&owner->pendingLock);
+            return false;
+        }
+        pending->objects = objects;
+        pending->capacity = capacity;
+    }
+    pending->objects[pending->count++] = cf;
+    if (pending->count == 1 && owner->sleepingRunLoop) {
+        wakeUpRunLoop = (CFRunLoopRef)CFRetain(owner->sleepingRunLoop);
+    }
+    CFUnlock(&owner->pendingLock);
+    if (wakeUpRunLoop) {
+        CFRunLoopWakeUp(wakeUpRunLoop);
+        CFRelease(wakeUpRunLoop);
+    }
+    if (owner->state != __kCFRCOwnerAlive) {
+        // Owner exited after the state was checked, and might
+        //  have missed our release.
+        __CFRCDrainPending(owner);
+    }
+    return true;
+}
+
+static void __CFRCAccountFree(uint8_t ownerIndex, Boolean isOwner) {
+    __CFRCOwner* owner = &__CFRCOwners[ownerIndex];
+    if (isOwner) {
+        owner->ownerFreed++;
+        return;
+    }
+    OSAtomicIncrement32Barrier(&owner->foreignFreed);
+    if (owner->state == __kCFRCOwnerRetired) {
+        __CFRCTryFreeOwner(owner);
+    }
+}
+
+// Called with __CFRCSpillLock held.
+static __CFRCSpill* __CFRCFindSpill(CFTypeRef cf) {
+    CFIndex i;
+    for (i = 0; i != __CFRCSpillCount; ++i) {
+        if (__CFRCSpills[i].object == cf) {
+            return &__CFRCSpills[i];
+        }
+    }
+    return NULL;
+}
+
+/* Moves a batch of references from the shared count to the spill table
+ *  when the shared count is about to reach __kCFRCSharedMax.
+ */
+static void __CFRCSpillShared(CFTypeRef cf) {
+    volatile __CFRCValue* rc = (volatile __CFRCValue*)&CF_BASE(cf)->_rc;
+    __CFRCValue value, newValue;
+    __CFRCSpill* spill;
+    CFLock(&__CFRCSpillLock);
+    spill = __CFRCFindSpill(cf);
+    if (!spill && __CFRCSpillCount == __CFRCSpillCapacity) {
+        CFIndex capacity = __CFRCSpillCapacity ? 2 * __CFRCSpillCapacity : 8;
+        __CFRCSpill* spills = (__CFRCSpill*)CFAllocatorReallocate(
+            kCFAllocatorSystemDefault, __CFRCSpills, capacity * sizeof(__CFRCSpill), 0);
+        if (!spills) {
+            CFUnlock(&__CFRCSpillLock);
+            __CFRCMakeImmortal(cf);
+            return;
+        }
+        __CFRCSpills = spills;
+        __CFRCSpillCapacity = capacity;
+    }
+    do {
+        value.rc = rc->rc;
+        if (__CFRCSharedCount(value.counts[__kCFRCShared]) != __kCFRCSharedMax - 1) {
+            // Changed by other threads, retry the retain.
+            CFUnlock(&__CFRCSpillLock);
+            return;
+        }
+        newValue = value;
+        newValue.counts[__kCFRCShared] =
+            (value.counts[__kCFRCShared] - __kCFRCSpillBatch) | __kCFRCSpilled;
+    } while (!OSAtomicCompareAndSwap32Barrier(value.rc, newValue.rc, &CF_BASE(cf)->_rc));
+    if (!spill) {
+        spill = &__CFRCSpills[__CFRCSpillCount++];
+        spill->object = cf;
+        spill->count = 0;
+    }
+    spill->count += __kCFRCSpillBatch;
+    CFUnlock(&__CFRCSpillLock);
+}
+
+/* Moves references back from the spill table when the shared count of
+ *  a spilled object is about to drop below 1.
+ */
+static void __CFRCUnspillShared(CFTypeRef cf) {
+    volatile __CFRCValue* rc = (volatile __CFRCValue*)&CF_BASE(cf)->_rc;
+    __CFRCValue value, newValue;
+    __CFRCSpill* spill;
+    uint32_t count;
+    CFLock(&__CFRCSpillLock);
+    spill = __CFRCFindSpill(cf);
+    do {
+        uint16_t shared;
+        value.rc = rc->rc;
+        shared = value.counts[__kCFRCShared];
+        if (!(shared & __kCFRCSpilled) || __CFRCSharedCount(shared) > 1) {
+            // Changed by other threads, retry the release.
+            CFUnlock(&__CFRCSpillLock);
+            return;
+        }
+        count = _CFMin(spill->count, __kCFRCSpillBatch);
+        newValue = value;
+        newValue.counts[__kCFRCShared] = shared + count;
+        if (count == spill->count) {
+            newValue.counts[__kCFRCShared] &= ~__kCFRCSpilled;
+        }
+    } while (!OSAtomicCompareAndSwap32Barrier(value.rc, newValue.rc, &CF_BASE(cf)->_rc));
+    spill->count -= count;
+    if (!spill->count) {
+        *spill = __CFRCSpills[--__CFRCSpillCount];
+    }
+    CFUnlock(&__CFRCSpillLock);
+}
+
+static void __CFRCRetain(CFTypeRef cf, uint8_t ownerIndex) {
+    volatile __CFRCValue* rc = (volatile __CFRCValue*)&CF_BASE(cf)->_rc;
+    __CFRCValue value, newValue;
+    value.rc = rc->rc;
+    if (!value.rc) {
+        // Static object.
+        return;
+    }
+    if (__CFRCSharedCount(value.counts[__kCFRCShared]) == __kCFRCSharedMax) {
+        // Immortal.
+        return;
+    }
+    if (ownerIndex == __CFRCGetCurrentOwner() &&
+        !(value.counts[__kCFRCShared] & __kCFRCMerged) &&
+        value.counts[__kCFRCLocal] != __kCFRCLocalMax)
+    {
+        rc->counts[__kCFRCLocal] = value.counts[__kCFRCLocal] + 1;
+        return;
+    }
+    while (true) {
+        uint16_t count;
+        value.rc = rc->rc;
+        count = __CFRCSharedCount(value.counts[__kCFRCShared]);
+        if (count == __kCFRCSharedMax) {
+            // Immortal.
+            return;
+        }
+        if (count == __kCFRCSharedMax - 1) {
+            __CFRCSpillShared(cf);
+            continue;
+        }
+        newValue = value;
+        newValue.counts[__kCFRCShared]++;
+        if (OSAtomicCompareAndSwap32Barrier(value.rc, newValue.rc, &CF_BASE(cf)->_rc)) {
+            return;
+        }
+    }
+}
+
+static void __CFRCRelease(CFTypeRef cf, uint8_t ownerIndex) {
+    volatile __CFRCValue* rc = (volatile __CFRCValue*)&CF_BASE(cf)->_rc;
+    __CFRCOwner* owner = &__CFRCOwners[ownerIndex];
+    Boolean isOwner = (ownerIndex == __CFRCGetCurrentOwner());
+    if (isOwner && owner->pending.count) {
+        __CFRCDrainPending(owner);
+    }
+    while (true) {
+        __CFRCValue value, newValue;
+        uint16_t local, shared;
+        value.rc = rc->rc;
+        if (!value.rc) {
+            // Static object.
+            return;
+        }
+        local = value.counts[__kCFRCLocal];
+        shared = value.counts[__kCFRCShared];
+        newValue = value;
+        if (__CFRCSharedCount(shared) == __kCFRCSharedMax) {
+            // Immortal.
+            return;
+        }
+        if ((shared & __kCFRCSpilled) && __CFRCSharedCount(shared) <= 1) {
+            __CFRCUnspillShared(cf);
+            continue;
+        }
+        if (shared & __kCFRCMerged) {
+            if (shared == (__kCFRCMerged | 1)) {
+                newValue.rc = 0;
+            } else {
+                newValue.counts[__kCFRCShared] = shared - 1;
+            }
+        } else if (isOwner) {
+            if (local > 1) {
+                rc->counts[__kCFRCLocal] = local - 1;
+                return;
+            }
+            if (shared) {
+                newValue.counts[__kCFRCLocal] = 0;
+                newValue.counts[__kCFRCShared] = shared | __kCFRCMerged;
+            } else {
+                newValue.rc = 0;
+            }
+        } else if (shared) {
+            newValue.counts[__kCFRCShared] = shared - 1;
+        } else if (owner->state == __kCFRCOwnerAlive) {
+            // Released reference is counted by the local count.
+            if (!__CFRCPushPending(owner, cf)) {
+                __CFRCMakeImmortal(cf);
+            }
+            return;
+        } else {
+            // Retired owner, nobody changes local count with plain stores.
+            if (local > 1) {
+                newValue.counts[__kCFRCLocal] = local - 1;
+            } else {
+                newValue.rc = 0;
+            }
+        }
+        if (!newValue.rc) {
+            // Finalize before dropping the count, see CFRelease().
+            const CFRuntimeClass* typeClass = _CFRuntimeGetClassWithTypeID(CF_TYPEID(cf));
+            if (typeClass->finalize) {
+                typeClass->finalize(cf);
+            }
+            if (OSAtomicCompareAndSwap32Barrier(value.rc, 0, &CF_BASE(cf)->_rc)) {
+                _CFRuntimeDestroyInstance(cf);
+                __CFRCAccountFree(ownerIndex, isOwner);
+                return;
+            }
+        } else if (OSAtomicCompareAndSwap32Barrier(value.rc, newValue.rc, &CF_BASE(cf)->_rc)) {
+            return;
+        }
+    }
+}
+
+// Returns false if the object is already immortal.
+static Boolean __CFRCMakeImmortal(CFTypeRef cf) {
+    uint8_t ownerIndex = CF_RC_OWNER(cf);
+    __CFRCValue value, newValue;
+    do {
+        value.rc = CF_BASE(cf)->_rc;
+        if (!value.rc) {
+            return false;
+        }
+        if (ownerIndex) {
+            uint16_t shared = value.counts[__kCFRCShared];
+            if (__CFRCSharedCount(shared) == __kCFRCSharedMax) {
+                return false;
+            }
+            newValue = value;
+            newValue.counts[__kCFRCShared] = (shared & __kCFRCMerged) | __kCFRCSharedMax;
+        } else {
+            newValue.rc = 0;
+        }
+    } while (!OSAtomicCompareAndSwap32Barrier(value.rc, newValue.rc, &CF_BASE(cf)->_rc));
+    if (ownerIndex) {
+        if (value.counts[__kCFRCShared] & __kCFRCSpilled) {
+            // Spilled references don't matter anymore.
+            __CFRCSpill* spill;
+            CFLock(&__CFRCSpillLock);
+            spill = __CFRCFindSpill(cf);
+            if (spill) {
+                *spill = __CFRCSpills[--__CFRCSpillCount];
+            }
+            CFUnlock(&__CFRCSpillLock);
+        }
+        // Never freed, so don't keep owner index retired because of it.
+        __CFRCAccountFree(ownerIndex, ownerIndex == __CFRCGetCurrentOwner());
+    }
+    return true;
+}
 
 ///////////////////////////////////////////////////////////////////// internal
 
@@ -36,6 +478,74 @@ CF_INTERNAL void _CFTypeCollectionRelease(CFAllocatorRef allocator, const void*
     CFRelease(cf);
 }
 
+CF_INTERNAL void _CFRCInitInstance(CFTypeRef cf) {
+    uint8_t ownerIndex = __CFRCGetCurrentOwner();
+    __CFRCValue value;
+    if (!ownerIndex || CF_TYPEID(cf) == CFAllocatorGetTypeID()) {
+        return;
+    }
+    value.counts[__kCFRCLocal] = (uint16_t)CF_BASE(cf)->_rc;
+    value.counts[__kCFRCShared] = 0;
+    CF_BASE(cf)->_rc = value.rc;
+    CF_RC_OWNER(cf) = ownerIndex;
+    __CFRCOwners[ownerIndex].created++;
+}
+
+CF_INTERNAL void _CFRCMakeStatic(CFTypeRef cf) {
+    uint8_t ownerIndex = CF_RC_OWNER(cf);
+    if (ownerIndex) {
+        CF_RC_OWNER(cf) = 0;
+        __CFRCAccountFree(ownerIndex, ownerIndex == __CFRCGetCurrentOwner());
+    }
+    CF_BASE(cf)->_rc = 0;
+}
+
+CF_INTERNAL void _CFRCDrainPendingReleases(void) {
+    uint8_t ownerIndex = __CFRCGetCurrentOwner();
+    if (ownerIndex) {
+        __CFRCDrainPending(&__CFRCOwners[ownerIndex]);
+    }
+}
+
+CF_INTERNAL void _CFRCRunLoopWillSleep(CFRunLoopRef rl) {
+    uint8_t ownerIndex = __CFRCGetCurrentOwner();
+    __CFRCOwner* owner = &__CFRCOwners[ownerIndex];
+    if (!ownerIndex) {
+        return;
+    }
+    CFLock(&owner->pendingLock);
+    owner->sleepingRunLoop = rl;
+    CFUnlock(&owner->pendingLock);
+    __CFRCDrainPending(owner);
+}
+
+CF_INTERNAL void _CFRCRunLoopDidWakeUp(void) {
+    uint8_t ownerIndex = __CFRCGetCurrentOwner();
+    __CFRCOwner* owner = &__CFRCOwners[ownerIndex];
+    if (!ownerIndex) {
+        return;
+    }
+    CFLock(&owner->pendingLock);
+    owner->sleepingRunLoop = NULL;
+    CFUnlock(&owner->pendingLock);
+    __CFRCDrainPending(owner);
+}
+
+CF_INTERNAL void _CFRCFinalizeThreadData(_CFThreadSpecificData* tsd) {
+    uint8_t ownerIndex = (uint8_t)tsd->_rcOwner;
+    __CFRCOwner* owner = &__CFRCOwners[ownerIndex];
+    if (!ownerIndex) {
+        return;
+    }
+    tsd->_rcOwner = 0x100;
+    CFLock(&__CFRCOwnersLock);
+    owner->state = __kCFRCOwnerRetired;
+    CFUnlock(&__CFRCOwnersLock);
+    // Retired owner's releases are applied with CAS, see __CFRCRelease().
+    __CFRCDrainPending(owner);
+    __CFRCTryFreeOwner(owner);
+}
+
 ///////////////////////////////////////////////////////////////////// public
 
 CFTypeID CFGetTypeID(CFTypeRef cf) {
@@ -61,11 +571,17 @@ CFStringRef CFCopyTypeIDDescription(CFTypeID typeID) {
 
 CFTypeRef CFRetain(CFTypeRef cf) {
     CF_VALIDATE_PTR_ARG(cf);
-    if (_CFIsMallocZone(cf)) {
+    if (_CFIsTaggedPointer(cf) || _CFIsMallocZone(cf)) {
         return cf;
     }
 
     CF_OBJC_FUNCDISPATCH(CFTypeRef, cf, "retain");
+
+    uint8_t ownerIndex = CF_RC_OWNER(cf);
+    if (ownerIndex) {
+        __CFRCRetain(cf, ownerIndex);
+        return cf;
+    }
     
     int32_t rc;
     do {
@@ -80,12 +596,18 @@ CFTypeRef CFRetain(CFTypeRef cf) {
 
 void CFRelease(CFTypeRef cf) {
     CF_VALIDATE_PTR_ARG(cf);
-    if (_CFIsMallocZone(cf)) {
+    if (_CFIsTaggedPointer(cf) || _CFIsMallocZone(cf)) {
         return;
     }
 
     CF_OBJC_VOID_FUNCDISPATCH(cf, "release");
 
+    uint8_t ownerIndex = CF_RC_OWNER(cf);
+    if (ownerIndex) {
+        __CFRCRelease(cf, ownerIndex);
+        return;
+    }
+
     int32_t rc;
     do {
         rc = CF_BASE(cf)->_rc;
@@ -119,11 +641,21 @@ void CFRelease(CFTypeRef cf) {
 
 CFIndex CFGetRetainCount(CFTypeRef cf) {
     CF_VALIDATE_PTR_ARG(cf);
-    if (_CFIsMallocZone(cf)) {
+    if (_CFIsTaggedPointer(cf) || _CFIsMallocZone(cf)) {
         return (CFIndex)LONG_MAX;
     }
 
     CF_OBJC_FUNCDISPATCH(CFIndex, cf, "retainCount");
+
+    if (CF_RC_OWNER(cf)) {
+        __CFRCValue value;
+        value.rc = CF_BASE(cf)->_rc;
+        if (!value.rc) {
+            return (CFIndex)LONG_MAX;
+        }
+        return (CFIndex)value.counts[__kCFRCLocal] +
+            (value.counts[__kCFRCShared] & ~__kCFRCMerged);
+    }
     
     int32_t rc = CF_BASE(cf)->_rc;
     return rc ? (CFIndex)rc : (CFIndex)LONG_MAX;
@@ -206,7 +738,7 @@ CFStringRef CFCopyFormattingDescription(CFTypeRef cf, CFDictionaryRef formatOpti
 }
 
 CFAllocatorRef CFGetAllocator(CFTypeRef cf) {
-    if (!cf) {
+    if (!cf || _CFIsTaggedPointer(cf)) {
         return kCFAllocatorSystemDefault;
     }
     if (CF_IS_OBJC(cf)) {
@@ -224,3 +756,24 @@ CFAllocatorRef CFGetAllocator(CFTypeRef cf) {
 CFTypeRef CFMakeCollectable(CFTypeRef cf) {
     return cf;
 }
+
+void CFMakeImmortal(CFTypeRef cf) {
+    CFTypeID typeID;
+    CF_VALIDATE_PTR_ARG(cf);
+    if (_CFIsTaggedPointer(cf) || _CFIsMallocZone(cf) || CF_IS_OBJC(cf)) {
+        return;
+    }
+    if (!__CFRCMakeImmortal(cf)) {
+        return;
+    }
+    typeID = CF_TYPEID(cf);
+    if (typeID == CFArrayGetTypeID()) {
+        _CFArrayApplyToObjects((CFArrayRef)cf, CFMakeImmortal);
+    } else if (typeID == CFDictionaryGetTypeID()) {
+        _CFDictionaryApplyToObjects((CFDictionaryRef)cf, CFMakeImmortal);
+    } else if (typeID == CFSetGetTypeID()) {
+        _CFSetApplyToObjects((CFSetRef)cf, CFMakeImmortal);
+    } else if (typeID == CFBagGetTypeID()) {
+        _CFBagApplyToObjects((CFBagRef)cf, CFMakeImmortal);
+    }
+}
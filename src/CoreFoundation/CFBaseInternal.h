@@ -98,8 +98,13 @@
 // CFRuntimeBase manipulation
 #define CF_BASE(cf) CF_CAST(CFRuntimeBase*, cf)
 #define CF_INFO(cf) (CF_BASE(cf)->_cfinfo[CF_INFO_BITS])
-#define CF_TYPEID(cf) ((CF_FULLINFO(cf) >> 8) & 0xFFFF)
+#define CF_TYPEID(cf) \
+    (_CFIsTaggedPointer(cf) ? \
+        _CFTaggedPointerGetTypeID(cf) : \
+        ((CF_FULLINFO(cf) >> 8) & 0xFFFF))
 #define CF_FULLINFO(cf) (*(uint32_t*)(CF_BASE(cf)->_cfinfo))
+// Owner thread index for biased reference counting, see CFBase.c.
+#define CF_RC_OWNER(cf) (CF_BASE(cf)->_cfinfo[3 - CF_INFO_BITS])
 #define CF_MAKE_FULLINFO(typeID, info) ((uint32_t)(((typeID) & 0xFFFF) << 8) | ((info) & 0xFF))
 
 //TODO this thing is broken - find out what type itemsPtr should be
@@ -124,14 +129,151 @@ const void* _CFTypeCollectionRetain(CFAllocatorRef allocator, const void* ptr);
 CF_EXPORT
 void _CFTypeCollectionRelease(CFAllocatorRef allocator, const void* ptr);
 
-//TODO _CFRangeIsValid is not descriptive, rename.
-CF_INLINE Boolean _CFRangeIsValid(CFRange range, CFIndex length) {
-#ifndef __LP64__
-    int64_t maxLocation = (int64_t)(uint32_t)range.location + (uint32_t)range.length;
+/* Makes object created by _CFRuntimeCreateInstance() biased
+ *  towards the current thread, see CFBase.c.
+ */
+CF_EXPORT
+void _CFRCInitInstance(CFTypeRef cf);
+
+/* Makes object static (never deallocated), see CFBase.c.
+ */
+CF_EXPORT
+void _CFRCMakeStatic(CFTypeRef cf);
+
+/* Applies releases queued by other threads for objects owned
+ *  by the current thread.
+ */
+CF_EXPORT
+void _CFRCDrainPendingReleases(void);
+
+/* Called by the run loop of the current thread around sleeping: releases
+ *  queued by other threads are applied, and while rl sleeps the first
+ *  queued release wakes it up.
+ */
+struct __CFRunLoop;
+CF_EXPORT
+void _CFRCRunLoopWillSleep(struct __CFRunLoop* rl);
+CF_EXPORT
+void _CFRCRunLoopDidWakeUp(void);
+
+/* Tagged pointers
+ *
+ * Small immutable objects (CFNumber, CFDate, CFBoolean) created with the
+ *  system default allocator are encoded directly in pointer bits: bit 0 is
+ *  set, bits 1-3 hold the tag, and the remaining bits are tag-specific
+ *  payload. Real objects are at least 2-byte aligned, so they never have
+ *  bit 0 set.
+ * Tagged objects have no memory, so they have no retain count and no
+ *  allocator; runtime functions must check for them before dereferencing.
+ * Tagged pointers are disabled when CF_ENABLE_OBJC_BRIDGE is defined,
+ *  since Objective-C runtime doesn't know tagged classes and would
+ *  dereference them when dispatching bridged calls. _CFIsTaggedPointer
+ *  is then always false, and tagged checks are compiled out.
+ */
+#if !defined(CF_ENABLE_OBJC_BRIDGE)
+    #define CF_ENABLE_TAGGED_POINTERS 1
+#endif
+
+enum {
+    _kCFTaggedNumberInteger = 0,
+    _kCFTaggedNumberFloat = 1,
+    _kCFTaggedDate = 2,
+    _kCFTaggedBoolean = 3,
+    _kCFTaggedPointerTagCount = 8
+};
+
+#define CF_TAGGED_PAYLOAD_BITS (sizeof(uintptr_t) * 8 - 4)
+
+// Constant expression, for static initializers.
+#define CF_TAGGED_POINTER(tag, payload) \
+    (((uintptr_t)(payload) << 4) | ((uintptr_t)(tag) << 1) | 1)
+
+// Type IDs of tagged classes, indexed by tag.
+CF_INTERNAL
+extern CFTypeID _CFTaggedPointerTypeIDs[_kCFTaggedPointerTagCount];
+
+CF_INLINE Boolean _CFIsTaggedPointer(CFTypeRef cf) {
+#if defined(CF_ENABLE_TAGGED_POINTERS)
+    return ((uintptr_t)cf & 1) != 0;
 #else
-    #error Fix _CFRangeIsValid for 64-bit
+    return false;
 #endif
-    return maxLocation <= length;
+}
+
+CF_INLINE uintptr_t _CFTaggedPointerGetTag(CFTypeRef cf) {
+    return ((uintptr_t)cf >> 1) & 0x7;
+}
+
+CF_INLINE uintptr_t _CFTaggedPointerGetPayload(CFTypeRef cf) {
+    return (uintptr_t)cf >> 4;
+}
+
+// Sign-extends the payload.
+CF_INLINE intptr_t _CFTaggedPointerGetSignedPayload(CFTypeRef cf) {
+    return (intptr_t)(uintptr_t)cf >> 4;
+}
+
+CF_INLINE CFTypeRef _CFTaggedPointerMake(uintptr_t tag, uintptr_t payload) {
+    return (CFTypeRef)CF_TAGGED_POINTER(tag, payload);
+}
+
+CF_INLINE CFTypeID _CFTaggedPointerGetTypeID(CFTypeRef cf) {
+    return _CFTaggedPointerTypeIDs[_CFTaggedPointerGetTag(cf)];
+}
+
+/* Packs double into 'bits' bits: sign, 'exponentBits' exponent and
+ *  the rest is mantissa. Returns false if the value can't be packed
+ *  without loss (exponent is out of range, mantissa doesn't fit, or
+ *  value is denormal, infinite or NaN).
+ */
+CF_INLINE Boolean _CFTaggedPointerPackDouble(double value, unsigned bits, unsigned exponentBits, uintptr_t* packed) {
+    union { double d; uint64_t u; } raw;
+    unsigned mantissaBits = bits - 1 - exponentBits;
+    unsigned droppedBits = 52 - mantissaBits;
+    uint64_t mantissa;
+    int64_t exponent;
+    raw.d = value;
+    mantissa = raw.u & 0xFFFFFFFFFFFFFULL;
+    exponent = (int64_t)((raw.u >> 52) & 0x7FF);
+    if (droppedBits && (mantissa & ((1ULL << droppedBits) - 1))) {
+        return false;
+    }
+    if (!exponent) {
+        if (mantissa) {
+            return false;
+        }
+    } else {
+        int64_t bias = (int64_t)1 << (exponentBits - 1);
+        exponent = exponent - 1023 + bias;
+        if (exponent < 1 || exponent >= 2 * bias) {
+            return false;
+        }
+    }
+    *packed = (uintptr_t)(
+        ((raw.u >> 63) << (bits - 1)) |
+        ((uint64_t)exponent << mantissaBits) |
+        (mantissa >> droppedBits));
+    return true;
+}
+
+CF_INLINE double _CFTaggedPointerUnpackDouble(uintptr_t packed, unsigned bits, unsigned exponentBits) {
+    union { double d; uint64_t u; } raw;
+    unsigned mantissaBits = bits - 1 - exponentBits;
+    uint64_t exponent = ((uint64_t)packed >> mantissaBits) & ((1ULL << exponentBits) - 1);
+    if (exponent) {
+        exponent = exponent - ((uint64_t)1 << (exponentBits - 1)) + 1023;
+    }
+    raw.u = ((((uint64_t)packed >> (bits - 1)) & 1) << 63) |
+        (exponent << 52) |
+        (((uint64_t)packed & ((1ULL << mantissaBits) - 1)) << (52 - mantissaBits));
+    return raw.d;
+}
+
+//TODO _CFRangeIsValid is not descriptive, rename.
+// Written so that nothing overflows for any CFIndex width.
+CF_INLINE Boolean _CFRangeIsValid(CFRange range, CFIndex length) {
+    return range.location >= 0 && range.length >= 0 &&
+        range.location <= length && range.length <= length - range.location;
 }
 
 CF_EXTERN_C_END
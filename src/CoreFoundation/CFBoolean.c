@@ -25,12 +25,20 @@
 #include <CoreFoundation/CFNumber.h>
 #include "CFInternal.h"
 
+/* CFBoolean values are tagged pointers (see CFBaseInternal.h),
+ *  with the value as payload. Static instances are used instead
+ *  when tagged pointers are disabled.
+ */
+
+#if !defined(CF_ENABLE_TAGGED_POINTERS)
 struct __CFBoolean {
     CFRuntimeBase _base;
 };
+#endif
 
 ///////////////////////////////////////////////////////////////////// private
 
+#if !defined(CF_ENABLE_TAGGED_POINTERS)
 static struct __CFBoolean __kCFBooleanTrue = {
     INIT_CFRUNTIME_BASE()
 };
@@ -39,6 +47,13 @@ static struct __CFBoolean __kCFBooleanFalse = {
     INIT_CFRUNTIME_BASE()
 };
 
+static void __CFBooleanDeallocate(CFTypeRef cf) {
+    CF_GENERIC_ERROR("CFBoolean objects can't be deallocated");
+}
+#else
+    #define __CFBooleanDeallocate NULL
+#endif
+
 /*** CFBoolean class ***/
 
 static CFStringRef __CFBooleanCopyDescription(CFTypeRef cf) {
@@ -54,10 +69,6 @@ static CFStringRef __CFBooleanCopyFormattingDescription(CFTypeRef cf, CFDictiona
     return (CFStringRef)CFRetain((boolean == kCFBooleanTrue) ? CFSTR("true") : CFSTR("false"));
 }
 
-static void __CFBooleanDeallocate(CFTypeRef cf) {
-    CF_GENERIC_ERROR("CFBoolean objects can't be deallocated");
-}
-
 static CFTypeID __kCFBooleanTypeID = _kCFRuntimeNotATypeID;
 
 static const CFRuntimeClass __CFBooleanClass = {
@@ -76,14 +87,23 @@ static const CFRuntimeClass __CFBooleanClass = {
 
 CF_INTERNAL void _CFBooleanInitialize(void) {
     __kCFBooleanTypeID = _CFRuntimeRegisterClassBridge(&__CFBooleanClass, "NSCFBoolean");
+#if defined(CF_ENABLE_TAGGED_POINTERS)
+    _CFRuntimeRegisterTaggedClass(_kCFTaggedBoolean, __kCFBooleanTypeID);
+#else
     _CFRuntimeInitStaticInstance(&__kCFBooleanTrue, __kCFBooleanTypeID);
     _CFRuntimeInitStaticInstance(&__kCFBooleanFalse, __kCFBooleanTypeID);
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////// public
 
+#if defined(CF_ENABLE_TAGGED_POINTERS)
+const CFBooleanRef kCFBooleanTrue = (CFBooleanRef)CF_TAGGED_POINTER(_kCFTaggedBoolean, 1);
+const CFBooleanRef kCFBooleanFalse = (CFBooleanRef)CF_TAGGED_POINTER(_kCFTaggedBoolean, 0);
+#else
 const CFBooleanRef kCFBooleanTrue = &__kCFBooleanTrue;
 const CFBooleanRef kCFBooleanFalse = &__kCFBooleanFalse;
+#endif
 
 CFTypeID CFBooleanGetTypeID(void) {
     return __kCFBooleanTypeID;
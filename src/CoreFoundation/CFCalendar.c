@@ -30,7 +30,7 @@
 #include <math.h>
 
 #define CF_VALIDATE_CALENDAR_ARG(calendar) \
-    CF_VALIDATE_OBJECT_ARG(CF, calendar, __kCFCalendarTypeID)
+    CF_VALIDATE_OBJECT_ARG(CF, calendar, CFCalendarGetTypeID())
 
 struct __CFCalendar {
     CFRuntimeBase _base;
@@ -313,14 +313,14 @@ static const CFRuntimeClass __CFCalendarClass = {
 
 ///////////////////////////////////////////////////////////////////// internal
 
-CF_INTERNAL void _CFCalendarInitialize(void) {
-    __kCFCalendarTypeID = _CFRuntimeRegisterClass(&__CFCalendarClass);
-}
-
 ///////////////////////////////////////////////////////////////////// public
 
 CFTypeID CFCalendarGetTypeID(void) {
-    return __kCFCalendarTypeID;
+    CFTypeID typeID = _CFRuntimeLoadTypeID(&__kCFCalendarTypeID);
+    if (typeID == _kCFRuntimeNotATypeID) {
+        typeID = _CFRuntimeRegisterClassOnce(&__kCFCalendarTypeID, &__CFCalendarClass, NULL);
+    }
+    return typeID;
 }
 
 CFCalendarRef CFCalendarCopyCurrent(void) {
@@ -177,7 +177,7 @@ CONST_STRING_DECL(__kCFCSetNameStringTypeFormat, "<CFCharacterSet Items(")
  * Note builtin set ID starts with 1 so the array index is ID - 1.
  */
 static CFCharacterSetRef * __CFBuiltinSets = NULL;
-static CFSpinLock_t __CFBuiltinSetsLock = CFSpinLockInit;
+static CFLock_t __CFBuiltinSetsLock = CFLockInit;
 
 static bool __CFCheckForExapendedSet = false;
 
@@ -1646,9 +1646,9 @@ CFCharacterSetRef CFCharacterSetGetPredefined(CFCharacterSetPredefinedSet theSet
 
     CFCSET_VALIDATE_BUILTIN_TYPE(theSetIdentifier);
 
-    CFSpinLock(&__CFBuiltinSetsLock);
+    CFLock(&__CFBuiltinSetsLock);
     cset = (__CFBuiltinSets ? __CFBuiltinSets[theSetIdentifier - 1] : NULL);
-    CFSpinUnlock(&__CFBuiltinSetsLock);
+    CFUnlock(&__CFBuiltinSetsLock);
 
     if (cset) {
         return cset;
@@ -1659,14 +1659,14 @@ CFCharacterSetRef CFCharacterSetGetPredefined(CFCharacterSetPredefinedSet theSet
     }
     __CFCSetPutBuiltinType(CF_CONST_CAST(CFMutableCharacterSetRef, cset), theSetIdentifier);
 
-    CFSpinLock(&__CFBuiltinSetsLock);
+    CFLock(&__CFBuiltinSetsLock);
     if (!__CFBuiltinSets) {
         __CFBuiltinSets = (CFCharacterSetRef*)CFAllocatorAllocate((CFAllocatorRef)CFRetain(CFAllocatorGetDefault()), sizeof(CFCharacterSetRef) * __kCFLastBuiltinSetID, 0);
         memset(__CFBuiltinSets, 0, sizeof(CFCharacterSetRef) * __kCFLastBuiltinSetID);
     }
 
     __CFBuiltinSets[theSetIdentifier - 1] = cset;
-    CFSpinUnlock(&__CFBuiltinSetsLock);
+    CFUnlock(&__CFBuiltinSetsLock);
 
     return cset;
 }
@@ -42,6 +42,11 @@ struct __CFDate {
 
 static CFTypeID __kCFDateTypeID = _kCFRuntimeNotATypeID;
 
+/* Tagged dates store packed CFAbsoluteTime with 7-bit exponent, which
+ *  covers times from 2^-63 to 2^64 seconds without precision loss on LP64.
+ */
+#define __kCFTaggedDateExponentBits 7
+
 static const uint8_t __CFDaysInMonthTable[16] = {
     0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31, 0, 0, 0
 };
@@ -163,12 +168,21 @@ static double __CFAbsoluteFromYMD(int64_t year, int8_t month, int8_t day) {
     return absolute;
 }
 
+CF_INLINE CFAbsoluteTime __CFDateGetTime(CFDateRef date) {
+    if (_CFIsTaggedPointer(date)) {
+        return _CFTaggedPointerUnpackDouble(
+            _CFTaggedPointerGetPayload(date),
+            CF_TAGGED_PAYLOAD_BITS, __kCFTaggedDateExponentBits);
+    }
+    return date->_time;
+}
+
 /*** CFDate class ***/
 
 static Boolean __CFDateEqual(CFTypeRef cf1, CFTypeRef cf2) {
     CFDateRef date1 = (CFDateRef)cf1;
     CFDateRef date2 = (CFDateRef)cf2;
-    if (date1->_time != date2->_time) {
+    if (__CFDateGetTime(date1) != __CFDateGetTime(date2)) {
         return false;
     }
     return true;
@@ -176,7 +190,7 @@ static Boolean __CFDateEqual(CFTypeRef cf1, CFTypeRef cf2) {
 
 static CFHashCode __CFDateHash(CFTypeRef cf) {
     CFDateRef date = (CFDateRef)cf;
-    return (CFHashCode)(float)floor(date->_time);
+    return (CFHashCode)(float)floor(__CFDateGetTime(date));
 }
 
 static CFStringRef __CFDateCopyDescription(CFTypeRef cf) {
@@ -184,7 +198,7 @@ static CFStringRef __CFDateCopyDescription(CFTypeRef cf) {
     return CFStringCreateWithFormat(
         CFGetAllocator(date),
         NULL, CFSTR("<CFDate %p [%p]>{time = %0.09g}"),
-        cf, CFGetAllocator(date), date->_time);
+        cf, CFGetAllocator(date), __CFDateGetTime(date));
 }
 
 static const CFRuntimeClass __CFDateClass = {
@@ -226,6 +240,7 @@ const CFTimeInterval kCFAbsoluteTimeIntervalSince1904 = 3061152000.0L;
 CFTypeID CFDateGetTypeID(void) {
     if (_kCFRuntimeNotATypeID == __kCFDateTypeID) {
         __kCFDateTypeID = _CFRuntimeRegisterClass(&__CFDateClass);
+        _CFRuntimeRegisterTaggedClass(_kCFTaggedDate, __kCFDateTypeID);
     }
     return __kCFDateTypeID;
 }
@@ -233,6 +248,16 @@ CFTypeID CFDateGetTypeID(void) {
 CFDateRef CFDateCreate(CFAllocatorRef allocator, CFAbsoluteTime at) {
     CFDateRef memory;
     uint32_t size;
+#if defined(CF_ENABLE_TAGGED_POINTERS)
+    uintptr_t packed;
+    allocator = allocator ? allocator : CFAllocatorGetDefault();
+    if (allocator == kCFAllocatorSystemDefault &&
+        _CFTaggedPointerPackDouble(at, CF_TAGGED_PAYLOAD_BITS, __kCFTaggedDateExponentBits, &packed))
+    {
+        CFDateGetTypeID(); // registers the tagged class
+        return (CFDateRef)_CFTaggedPointerMake(_kCFTaggedDate, packed);
+    }
+#endif
     size = sizeof(struct __CFDate) - sizeof(CFRuntimeBase);
     memory = (CFDateRef)_CFRuntimeCreateInstance(allocator, CFDateGetTypeID(), size, NULL);
     if (!memory) {
@@ -255,7 +280,7 @@ CFTimeInterval CFDateGetAbsoluteTime(CFDateRef date) {
     //TODO _cfTimeIntervalSinceReferenceDate:result:
     //CF_OBJC_FUNCDISPATCH(CFTimeInterval, date, "timeIntervalSinceReferenceDate");
     CF_VALIDATE_OBJECT_ARG(CF, date, CFDateGetTypeID());
-    return date->_time;
+    return __CFDateGetTime(date);
 }
 
 CFTimeInterval CFDateGetTimeIntervalSinceDate(CFDateRef date, CFDateRef otherDate) {
@@ -263,17 +288,19 @@ CFTimeInterval CFDateGetTimeIntervalSinceDate(CFDateRef date, CFDateRef otherDat
     //CF_OBJC_FUNCDISPATCH(CFTimeInterval, date, "timeIntervalSinceDate:", otherDate);
     CF_VALIDATE_OBJECT_ARG(CF, date, CFDateGetTypeID());
     CF_VALIDATE_OBJECT_ARG(CF, otherDate, CFDateGetTypeID());
-    return date->_time - otherDate->_time;
+    return __CFDateGetTime(date) - __CFDateGetTime(otherDate);
 }
 
 CFComparisonResult CFDateCompare(CFDateRef date, CFDateRef otherDate, void* context) {
     CF_OBJC_FUNCDISPATCH(CFComparisonResult, date, "compare:", otherDate);
     CF_VALIDATE_OBJECT_ARG(CF, date, CFDateGetTypeID());
     CF_VALIDATE_OBJECT_ARG(CF, otherDate, CFDateGetTypeID());
-    if (date->_time < otherDate->_time) {
+    CFAbsoluteTime time = __CFDateGetTime(date);
+    CFAbsoluteTime otherTime = __CFDateGetTime(otherDate);
+    if (time < otherTime) {
         return kCFCompareLessThan;
     }
-    if (date->_time > otherDate->_time) {
+    if (time > otherTime) {
         return kCFCompareGreaterThan;
     }
     return kCFCompareEqualTo;
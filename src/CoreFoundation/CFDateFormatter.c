@@ -209,10 +209,6 @@ static const CFRuntimeClass __CFDateFormatterClass = {
 
 ///////////////////////////////////////////////////////////////////// internal
 
-CF_INTERNAL void _CFDateFormatterInitialize(void) {
-    __kCFDateFormatterTypeID = _CFRuntimeRegisterClass(&__CFDateFormatterClass);
-}
-
 ///////////////////////////////////////////////////////////////////// public
 
 CONST_STRING_DECL(kCFDateFormatterIsLenient, "kCFDateFormatterIsLenient")
@@ -246,7 +242,11 @@ CONST_STRING_DECL(kCFDateFormatterShortStandaloneQuarterSymbols, "kCFDateFormatt
 CONST_STRING_DECL(kCFDateFormatterGregorianStartDate, "kCFDateFormatterGregorianStartDate")
 
 CFTypeID CFDateFormatterGetTypeID(void) {
-    return __kCFDateFormatterTypeID;
+    CFTypeID typeID = _CFRuntimeLoadTypeID(&__kCFDateFormatterTypeID);
+    if (typeID == _kCFRuntimeNotATypeID) {
+        typeID = _CFRuntimeRegisterClassOnce(&__kCFDateFormatterTypeID, &__CFDateFormatterClass, NULL);
+    }
+    return typeID;
 }
 
 CFDateFormatterRef CFDateFormatterCreate(CFAllocatorRef allocator, CFLocaleRef locale, CFDateFormatterStyle dateStyle, CFDateFormatterStyle timeStyle) {
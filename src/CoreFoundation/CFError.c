@@ -41,7 +41,7 @@ static CFTypeID __kCFErrorTypeID = _kCFRuntimeNotATypeID;
  *  and access shared static objects. Should only be around tiny 
  *  snippets of code; no recursion.
  */
-static CFSpinLock_t _CFErrorSpinlock = CFSpinLockInit;
+static CFLock_t _CFErrorSpinlock = CFLockInit;
 
 /* Domain-to-callback mapping dictionary
  */
@@ -63,12 +63,12 @@ static CFDictionaryRef _CFErrorCreateEmptyDictionary(CFAllocatorRef allocator) {
 				allocator,
 				NULL, NULL, 0,
 				&kCFCopyStringDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
-            CFSpinLock(&_CFErrorSpinlock);
+            CFLock(&_CFErrorSpinlock);
             if (emptyErrorDictionary == NULL) {
                 emptyErrorDictionary = tmp;
-                CFSpinUnlock(&_CFErrorSpinlock);
+                CFUnlock(&_CFErrorSpinlock);
             } else {
-                CFSpinUnlock(&_CFErrorSpinlock);
+                CFUnlock(&_CFErrorSpinlock);
                 CFRelease(tmp);
             }
         }
@@ -183,12 +183,12 @@ static void _CFErrorInitializeCallBackTable(void) {
         kCFAllocatorSystemDefault,
         0,
         &kCFCopyStringDictionaryKeyCallBacks, NULL);
-    CFSpinLock(&_CFErrorSpinlock);
+    CFLock(&_CFErrorSpinlock);
     if (!_CFErrorCallBackTable) {
         _CFErrorCallBackTable = table;
-        CFSpinUnlock(&_CFErrorSpinlock);
+        CFUnlock(&_CFErrorSpinlock);
     } else {
-        CFSpinUnlock(&_CFErrorSpinlock);
+        CFUnlock(&_CFErrorSpinlock);
         CFRelease(table);
         // Note, even though the table looks like it was initialized,
         //  we go on to register the items on this thread as well, since 
@@ -433,23 +433,23 @@ void CFErrorSetCallBackForDomain(CFStringRef domainName, CFErrorUserInfoKeyCallB
     if (!_CFErrorCallBackTable) {
         _CFErrorInitializeCallBackTable();
     }
-    CFSpinLock(&_CFErrorSpinlock);
+    CFLock(&_CFErrorSpinlock);
     if (callBack) {
         CFDictionarySetValue(_CFErrorCallBackTable, domainName, callBack);
     } else {
         CFDictionaryRemoveValue(_CFErrorCallBackTable, domainName);
     }
-    CFSpinUnlock(&_CFErrorSpinlock);
+    CFUnlock(&_CFErrorSpinlock);
 }
 
 CFErrorUserInfoKeyCallBack CFErrorGetCallBackForDomain(CFStringRef domainName) {
     if (!_CFErrorCallBackTable) {
         _CFErrorInitializeCallBackTable();
     }
-    CFSpinLock(&_CFErrorSpinlock);
+    CFLock(&_CFErrorSpinlock);
     CFErrorUserInfoKeyCallBack callBack = (CFErrorUserInfoKeyCallBack)
         CFDictionaryGetValue(_CFErrorCallBackTable, domainName);
-    CFSpinUnlock(&_CFErrorSpinlock);
+    CFUnlock(&_CFErrorSpinlock);
     return callBack;
 }
 
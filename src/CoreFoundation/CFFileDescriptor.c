@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <CoreFoundation/CFFileDescriptor.h>
+#include "CFInternal.h"
+#include "CFRunLoop_Common.h"
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define CF_VALIDATE_FILEDESCRIPTOR_ARG(f) \
+    CF_VALIDATE_OBJECT_ARG(CF, f, __kCFFileDescriptorTypeID)
+
+/* File descriptor is watched by a file descriptor CFRunLoopPort, which
+ *  is kept armed for the enabled callback types. The port is the port
+ *  of the version 1 run loop source, so descriptors are waited on
+ *  together with all other ports, in the same kernel wait set.
+ */
+
+struct __CFFileDescriptor {
+    CFRuntimeBase _base;
+    CFLock_t _lock;
+    CFFileDescriptorNativeDescriptor _descriptor; // immutable
+    Boolean _closeOnInvalidate; // immutable
+    CFOptionFlags _callBackTypes; // enabled callback types
+    CFRunLoopPortRef _port;
+    CFRunLoopSourceRef _source;
+    CFFileDescriptorCallBack _callout; // immutable
+    CFFileDescriptorContext _context; // immutable, except invalidation
+};
+
+static CFTypeID __kCFFileDescriptorTypeID = _kCFRuntimeNotATypeID;
+
+///////////////////////////////////////////////////////////////////// private
+
+CF_INLINE void __CFFileDescriptorLock(CFFileDescriptorRef f) {
+    CFLock(&f->_lock);
+}
+
+CF_INLINE void __CFFileDescriptorUnlock(CFFileDescriptorRef f) {
+    CFUnlock(&f->_lock);
+}
+
+/* Expects 'f' to be locked. Returns false if the descriptor can't be
+ *  watched for enabled callback types (e.g. it was closed).
+ */
+static Boolean __CFFileDescriptorUpdatePortEvents(CFFileDescriptorRef f) {
+    CFOptionFlags events = 0;
+    if (f->_callBackTypes & kCFFileDescriptorReadCallBack) {
+        events |= kCFRunLoopPortReadEvent;
+    }
+    if (f->_callBackTypes & kCFFileDescriptorWriteCallBack) {
+        events |= kCFRunLoopPortWriteEvent;
+    }
+    if (f->_callBackTypes & kCFFileDescriptorEdgeTriggered) {
+        events |= kCFRunLoopPortEdgeTriggered;
+    }
+    return CFRunLoopPortSetFileDescriptorEvents(f->_port, events);
+}
+
+/*** Run loop source callbacks ***/
+
+static CFRunLoopPortRef __CFFileDescriptorGetPort(void* info) {
+    CFFileDescriptorRef f = (CFFileDescriptorRef)info;
+    return f->_port;
+}
+
+static void __CFFileDescriptorPerform(void* info) { /* DOES CALLOUT */
+    CFFileDescriptorRef f = (CFFileDescriptorRef)info;
+    CFOptionFlags readyEvents;
+    CFOptionFlags callBackTypes = 0;
+    CFFileDescriptorCallBack callout;
+    void* contextInfo;
+
+    __CFFileDescriptorLock(f);
+    if (!__CFIsValid(f)) {
+        __CFFileDescriptorUnlock(f);
+        return;
+    }
+    readyEvents = CFRunLoopPortTakeReadyEvents(f->_port);
+    if (readyEvents & kCFRunLoopPortReadEvent) {
+        callBackTypes |= kCFFileDescriptorReadCallBack;
+    }
+    if (readyEvents & kCFRunLoopPortWriteEvent) {
+        callBackTypes |= kCFFileDescriptorWriteCallBack;
+    }
+    callBackTypes &= f->_callBackTypes;
+    if (callBackTypes && !(f->_callBackTypes & kCFFileDescriptorEdgeTriggered)) {
+        // Level-triggered callbacks are one-shot.
+        f->_callBackTypes &= ~callBackTypes;
+        __CFFileDescriptorUpdatePortEvents(f);
+    }
+    callout = f->_callout;
+    contextInfo = f->_context.info;
+    __CFFileDescriptorUnlock(f);
+
+    if (callBackTypes && callout) {
+        callout(f, callBackTypes, contextInfo); /* CALLOUT */
+    }
+}
+
+/*** CFFileDescriptor class ***/
+
+static CFStringRef __CFFileDescriptorCopyDescription(CFTypeRef cf) { /* DOES CALLOUT */
+    CFFileDescriptorRef f = (CFFileDescriptorRef)cf;
+    CFStringRef result;
+    CFStringRef contextDesc = NULL;
+    if (f->_context.copyDescription) {
+        contextDesc = f->_context.copyDescription(f->_context.info);
+    }
+    if (!contextDesc) {
+        contextDesc = CFStringCreateWithFormat(
+            CFGetAllocator(f),
+            NULL, CFSTR("<CFFileDescriptor context %p>"),
+            f->_context.info);
+    }
+    result = CFStringCreateWithFormat(
+        CFGetAllocator(f),
+        NULL, CFSTR("<CFFileDescriptor %p [%p]>{valid = %s, fd = %d, callbacks = 0x%x, source = %p, callout = %p, context = %@}"),
+        cf, CFGetAllocator(f),
+        __CFIsValid(f) ? "Yes" : "No",
+        f->_descriptor,
+        (unsigned int)f->_callBackTypes,
+        f->_source,
+        (void*)f->_callout,
+        contextDesc);
+    CFRelease(contextDesc);
+    return result;
+}
+
+static void __CFFileDescriptorDeallocate(CFTypeRef cf) { /* DOES CALLOUT */
+    CFFileDescriptorRef f = (CFFileDescriptorRef)cf;
+    CFFileDescriptorInvalidate(f);
+}
+
+static const CFRuntimeClass __CFFileDescriptorClass = {
+    0,
+    "CFFileDescriptor",
+    NULL, // init
+    NULL, // copy
+    __CFFileDescriptorDeallocate,
+    NULL, // equal
+    NULL, // hash
+    NULL,
+    __CFFileDescriptorCopyDescription
+};
+
+///////////////////////////////////////////////////////////////////// internal
+
+CF_INTERNAL void __CFFileDescriptorInitialize(void) {
+    __kCFFileDescriptorTypeID = _CFRuntimeRegisterClass(&__CFFileDescriptorClass);
+}
+
+///////////////////////////////////////////////////////////////////// public
+
+CFTypeID CFFileDescriptorGetTypeID(void) {
+    return __kCFFileDescriptorTypeID;
+}
+
+CFFileDescriptorRef CFFileDescriptorCreate(CFAllocatorRef allocator, CFFileDescriptorNativeDescriptor fd, Boolean closeOnInvalidate, CFFileDescriptorCallBack callout, const CFFileDescriptorContext* context) {
+    struct __CFFileDescriptor* memory;
+    CFRunLoopPortRef port;
+    if (fd < 0 || fcntl(fd, F_GETFL) == -1) {
+        return NULL;
+    }
+    port = CFRunLoopPortCreateWithFileDescriptor(kCFAllocatorSystemDefault, fd);
+    if (!port) {
+        return NULL;
+    }
+    memory = (struct __CFFileDescriptor*)_CFRuntimeCreateInstance(
+        allocator,
+        __kCFFileDescriptorTypeID,
+        sizeof(struct __CFFileDescriptor) - sizeof(CFRuntimeBase),
+        NULL);
+    if (!memory) {
+        CFRelease(port);
+        return NULL;
+    }
+    __CFSetValid(memory);
+    memory->_lock = CFLockInit;
+    memory->_descriptor = fd;
+    memory->_closeOnInvalidate = closeOnInvalidate;
+    memory->_callBackTypes = 0;
+    memory->_port = port;
+    memory->_source = NULL;
+    memory->_callout = callout;
+    if (context) {
+        memory->_context = *context;
+        if (context->retain) {
+            memory->_context.info = context->retain(context->info);
+        }
+    } else {
+        memset(&memory->_context, 0, sizeof(memory->_context));
+    }
+    return memory;
+}
+
+CFFileDescriptorNativeDescriptor CFFileDescriptorGetNativeDescriptor(CFFileDescriptorRef f) {
+    CF_VALIDATE_FILEDESCRIPTOR_ARG(f);
+    return f->_descriptor;
+}
+
+void CFFileDescriptorGetContext(CFFileDescriptorRef f, CFFileDescriptorContext* context) {
+    CF_VALIDATE_FILEDESCRIPTOR_ARG(f);
+    CF_VALIDATE_ARG(context->version == 0,
+        "context version not initialized to 0");
+
+    *context = f->_context;
+}
+
+void CFFileDescriptorEnableCallBacks(CFFileDescriptorRef f, CFOptionFlags callBackTypes) {
+    CF_VALIDATE_FILEDESCRIPTOR_ARG(f);
+    __CFFileDescriptorLock(f);
+    if (__CFIsValid(f)) {
+        CFOptionFlags oldCallBackTypes = f->_callBackTypes;
+        f->_callBackTypes |= callBackTypes;
+        if (!__CFFileDescriptorUpdatePortEvents(f)) {
+            f->_callBackTypes = oldCallBackTypes;
+        }
+    }
+    __CFFileDescriptorUnlock(f);
+}
+
+void CFFileDescriptorDisableCallBacks(CFFileDescriptorRef f, CFOptionFlags callBackTypes) {
+    CF_VALIDATE_FILEDESCRIPTOR_ARG(f);
+    __CFFileDescriptorLock(f);
+    if (__CFIsValid(f)) {
+        CFOptionFlags oldCallBackTypes = f->_callBackTypes;
+        f->_callBackTypes &= ~callBackTypes;
+        if (!__CFFileDescriptorUpdatePortEvents(f)) {
+            f->_callBackTypes = oldCallBackTypes;
+        }
+    }
+    __CFFileDescriptorUnlock(f);
+}
+
+void CFFileDescriptorInvalidate(CFFileDescriptorRef f) { /* DOES CALLOUT */
+    CFRunLoopSourceRef source;
+    CFRunLoopPortRef port;
+    void* info;
+    CF_VALIDATE_FILEDESCRIPTOR_ARG(f);
+    CFRetain(f);
+    __CFFileDescriptorLock(f);
+    if (!__CFIsValid(f)) {
+        __CFFileDescriptorUnlock(f);
+        CFRelease(f);
+        return;
+    }
+    __CFUnsetValid(f);
+    f->_callBackTypes = 0;
+    CFRunLoopPortSetFileDescriptorEvents(f->_port, 0);
+    source = f->_source;
+    f->_source = NULL;
+    info = f->_context.info;
+    f->_context.info = NULL;
+    __CFFileDescriptorUnlock(f);
+
+    if (source) {
+        CFRunLoopSourceInvalidate(source); /* DOES CALLOUT */
+        CFRelease(source);
+    }
+    // Port is released last, since run loops may still reference it.
+    __CFFileDescriptorLock(f);
+    port = f->_port;
+    f->_port = NULL;
+    __CFFileDescriptorUnlock(f);
+    CFRelease(port);
+    if (f->_closeOnInvalidate) {
+        close(f->_descriptor);
+    }
+    if (f->_context.release) {
+        f->_context.release(info); /* CALLOUT */
+    }
+    CFRelease(f);
+}
+
+Boolean CFFileDescriptorIsValid(CFFileDescriptorRef f) {
+    CF_VALIDATE_FILEDESCRIPTOR_ARG(f);
+    return __CFIsValid(f);
+}
+
+CFRunLoopSourceRef CFFileDescriptorCreateRunLoopSource(CFAllocatorRef allocator, CFFileDescriptorRef f, CFIndex order) {
+    CFRunLoopSourceRef result = NULL;
+    CF_VALIDATE_FILEDESCRIPTOR_ARG(f);
+    __CFFileDescriptorLock(f);
+    if (__CFIsValid(f)) {
+        if (!f->_source) {
+            CFRunLoopSourceContext1 context = {
+                1, // version
+                (void*)f,
+                (const void* (*)(const void*))CFRetain,
+                (void (*)(const void*))CFRelease,
+                (CFStringRef (*)(const void*))CFCopyDescription,
+                NULL, // equal
+                NULL, // hash
+                __CFFileDescriptorGetPort,
+                __CFFileDescriptorPerform
+            };
+            f->_source = CFRunLoopSourceCreate(allocator, order, (CFRunLoopSourceContext*)&context);
+        }
+        if (f->_source) {
+            result = (CFRunLoopSourceRef)CFRetain(f->_source);
+        }
+    }
+    __CFFileDescriptorUnlock(f);
+    return result;
+}
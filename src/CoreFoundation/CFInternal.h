@@ -66,11 +66,7 @@
 #include "CFDateInternal.h"
 #include "CFRunLoopInternal.h"
 #include "CFErrorInternal.h"
-#include "CFTimeZoneInternal.h"
 #include "CFURLInternal.h"
-#include "CFNumberFormatterInternal.h"
-#include "CFDateFormatterInternal.h"
-#include "CFCalendarInternal.h"
 #include "CFLocaleInternal.h"
 
 #include "CFPlatform.h"
@@ -84,24 +80,100 @@ CF_EXPORT void __CFDictionaryInitialize();
 CF_EXPORT void _CFDictionarySetCapacity(CFMutableDictionaryRef bag, CFIndex cap);
 CF_EXPORT void __CFSetInitialize();
 CF_EXPORT void _CFSetSetCapacity(CFMutableSetRef bag, CFIndex cap);
+CF_EXPORT void _CFBagApplyToObjects(CFBagRef bag, void (*applier)(CFTypeRef cf));
+CF_EXPORT void _CFDictionaryApplyToObjects(CFDictionaryRef dict, void (*applier)(CFTypeRef cf));
+CF_EXPORT void _CFSetApplyToObjects(CFSetRef set, void (*applier)(CFTypeRef cf));
 CF_EXPORT void _CFDataInitialize(void);
 
-//TODO move spinlocks to CFUtilities
-/* Spinlock
+/* Lock
  *
- * Spinlocks are wrapped to allow debug checks (TODO).
+ * Adaptive lock: spins for a while, then parks the thread in the kernel
+ *  (CFPlatformWaitOnAddress), so contended locks don't burn processors
+ *  and don't starve lock owners on oversubscribed hosts.
+ * States are: 0 - unlocked, 1 - locked, 2 - locked and there might be
+ *  waiters; only unlocking from state 2 needs to wake anyone up.
+ * Zero-filled memory is an unlocked lock.
  */
 
-typedef OSSpinLock CFSpinLock_t;
+typedef volatile int32_t CFLock_t;
 
-#define CFSpinLockInit OS_SPINLOCK_INIT
+#define CFLockInit 0
 
-CF_INLINE void CFSpinLock(CFSpinLock_t* lock) {
-    OSSpinLockLock(lock);
+CF_EXPORT void _CFLockWait(CFLock_t* lock);
+CF_EXPORT void _CFLockWake(CFLock_t* lock);
+
+CF_INLINE void CFLock(CFLock_t* lock) {
+    if (!OSAtomicCompareAndSwap32Barrier(0, 1, (int32_t*)lock)) {
+        _CFLockWait(lock);
+    }
+}
+
+#if defined(CF_ENABLE_LOCK_PROFILING)
+
+/* Lock profiling
+ *
+ * When compiled with CF_ENABLE_LOCK_PROFILING, each CFLock() call site
+ *  gets a static record named after the lock expression, which is
+ *  registered on the first acquisition. Counters are bumped with plain
+ *  increments after the lock is acquired, so they are approximate (sites
+ *  can lock different instances).
+ * Uncontended acquisitions only bump the counter. Contended acquisitions
+ *  time their wait, and they, along with every _kCFLockHoldSampleInterval-th
+ *  acquisition of a site, are timestamped on a small per-thread stack,
+ *  which CFUnlock() checks to measure the hold time.
+ * See CFRuntimeCopyLockStatistics().
+ */
+
+#define _kCFLockHoldSampleInterval 64 // power of 2
+
+typedef struct _CFLockSite {
+    struct _CFLockSite* next;
+    const char* name;
+    int32_t registered;
+    int64_t acquisitionCount;
+    int64_t contendedCount;
+    int64_t waitTSR;
+    int64_t maxHoldTSR;
+} _CFLockSite;
+
+CF_EXPORT __thread CFIndex _CFLockTimedHoldCount;
+
+CF_EXPORT _CFLockSite* _CFLockGetSites(void);
+CF_EXPORT void _CFLockRegisterSite(_CFLockSite* site);
+CF_EXPORT void _CFLockProfiledAcquired(CFLock_t* lock, _CFLockSite* site);
+CF_EXPORT void _CFLockProfiledWait(CFLock_t* lock, _CFLockSite* site);
+CF_EXPORT void _CFLockProfiledRelease(CFLock_t* lock);
+
+CF_INLINE void _CFLockProfiled(CFLock_t* lock, _CFLockSite* site) {
+    if (!site->registered) {
+        _CFLockRegisterSite(site);
+    }
+    if (OSAtomicCompareAndSwap32Barrier(0, 1, (int32_t*)lock)) {
+        if (!(++site->acquisitionCount & (_kCFLockHoldSampleInterval - 1))) {
+            _CFLockProfiledAcquired(lock, site);
+        }
+    } else {
+        _CFLockProfiledWait(lock, site);
+    }
 }
 
-CF_INLINE void CFSpinUnlock(CFSpinLock_t* lock) {
-    OSSpinLockUnlock(lock);
+#define CFLock(lock) \
+    do { \
+        static _CFLockSite __cfLockSite = {NULL, #lock, 0, 0, 0, 0, 0}; \
+        _CFLockProfiled((lock), &__cfLockSite); \
+    } while (0)
+
+#endif // CF_ENABLE_LOCK_PROFILING
+
+CF_INLINE void CFUnlock(CFLock_t* lock) {
+#if defined(CF_ENABLE_LOCK_PROFILING)
+    if (_CFLockTimedHoldCount) {
+        _CFLockProfiledRelease(lock);
+    }
+#endif
+    if (OSAtomicDecrement32Barrier((int32_t*)lock)) {
+        _CFLockWake(lock);
+    }
 }
 
 CF_EXTERN_C_END
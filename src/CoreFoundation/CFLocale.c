@@ -60,7 +60,7 @@ typedef struct __CFLocale {
     CFMutableDictionaryRef _cache;
     CFMutableDictionaryRef _overrides;
     CFDictionaryRef _prefs;
-    CFSpinLock_t _lock;
+    CFLock_t _lock;
 } __CFLocale;
 static CFTypeID __kCFLocaleTypeID = _kCFRuntimeNotATypeID;
 
@@ -81,7 +81,7 @@ struct __CFLocaleKeyTableEntry {
     CFStringRef context;
 };
 
-static CFSpinLock_t __CFLocaleGlobalLock = CFSpinLockInit;
+static CFLock_t __CFLocaleGlobalLock = CFLockInit;
 static CFLocaleRef __CFLocaleSystem = NULL;
 static CFLocaleRef __CFLocaleCurrent = NULL;
 static CFMutableDictionaryRef __CFLocaleCache = NULL;
@@ -96,17 +96,17 @@ CF_INLINE void __CFLocaleSetType(CFLocaleRef locale, CFIndex type) {
 }
 
 CF_INLINE void __CFLocaleLockGlobal(void) {
-    CFSpinLock(&__CFLocaleGlobalLock);
+    CFLock(&__CFLocaleGlobalLock);
 }
 CF_INLINE void __CFLocaleUnlockGlobal(void) {
-    CFSpinUnlock(&__CFLocaleGlobalLock);
+    CFUnlock(&__CFLocaleGlobalLock);
 }
 
 CF_INLINE void __CFLocaleLock(CFLocaleRef locale) {
-    CFSpinLock(CF_CONST_CAST(CFSpinLock_t*, &locale->_lock));
+    CFLock(CF_CONST_CAST(CFLock_t*, &locale->_lock));
 }
 CF_INLINE void __CFLocaleUnlock(CFLocaleRef locale) {
-    CFSpinUnlock(CF_CONST_CAST(CFSpinLock_t*, &locale->_lock));
+    CFUnlock(CF_CONST_CAST(CFLock_t*, &locale->_lock));
 }
 
 static CFArrayRef __CFLocaleCopyCStringsAsArray(const char* const* p) {
@@ -631,13 +631,8 @@ static const CFRuntimeClass __CFLocaleClass = {
     __CFLocaleCopyDescription
 };
 
-///////////////////////////////////////////////////////////////////// internal
-
-CONST_STRING_DECL(_kCFLocaleCollatorID, "locale:collator id")
-
-CF_INTERNAL void _CFLocaleInitialize(void) {
+static void __CFLocaleInitializeKeyTable(void) {
     CFIndex idx;
-    __kCFLocaleTypeID = _CFRuntimeRegisterClass(&__CFLocaleClass);
     for (idx = 0; idx < __kCFLocaleKeyTableCount; idx++) {
         // table fixup to workaround compiler/language limitations
         __CFLocaleKeyTable[idx].key = *((CFStringRef*)__CFLocaleKeyTable[idx].key);
@@ -647,6 +642,10 @@ CF_INTERNAL void _CFLocaleInitialize(void) {
     }
 }
 
+///////////////////////////////////////////////////////////////////// internal
+
+CONST_STRING_DECL(_kCFLocaleCollatorID, "locale:collator id")
+
 CF_INTERNAL CFDictionaryRef _CFLocaleGetPrefs(CFLocaleRef locale) {
     return locale->_prefs;
 }
@@ -685,7 +684,11 @@ CONST_STRING_DECL(kCFHebrewCalendar, "hebrew")
 CONST_STRING_DECL(kCFChineseCalendar, "chinese")
 
 CFTypeID CFLocaleGetTypeID(void) {
-    return __kCFLocaleTypeID;
+    CFTypeID typeID = _CFRuntimeLoadTypeID(&__kCFLocaleTypeID);
+    if (typeID == _kCFRuntimeNotATypeID) {
+        typeID = _CFRuntimeRegisterClassOnce(&__kCFLocaleTypeID, &__CFLocaleClass, __CFLocaleInitializeKeyTable);
+    }
+    return typeID;
 }
 
 CFLocaleRef CFLocaleGetSystem(void) {
@@ -739,7 +742,7 @@ CFLocaleRef CFLocaleCopyCurrent(void) {
     locale->_cache = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, &kCFTypeDictionaryValueCallBacks);
     locale->_overrides = NULL;
     locale->_prefs = prefs;
-    locale->_lock = CFSpinLockInit;
+    locale->_lock = CFLockInit;
 
     __CFLocaleLockGlobal();
     if (!__CFLocaleCurrent) {
@@ -797,7 +800,7 @@ CFLocaleRef CFLocaleCreate(CFAllocatorRef allocator, CFStringRef identifier) {
     locale->_overrides = NULL;
     locale->_prefs = NULL;
 
-    locale->_lock = CFSpinLockInit;
+    locale->_lock = CFLockInit;
 
     if (canCache) {
         if (!__CFLocaleCache) {
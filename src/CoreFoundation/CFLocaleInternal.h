@@ -22,9 +22,6 @@ CF_EXTERN_C_BEGIN
 CF_EXPORT
 const CFStringRef _kCFLocaleCollatorID;
 
-CF_EXPORT
-void _CFLocaleInitialize(void);
-
 CF_EXPORT
 CFDictionaryRef _CFLocaleGetPrefs(CFLocaleRef locale);
 
@@ -86,9 +86,9 @@ __CFNumberTypeTable[] = {
     /* kCFNumberLongLongType */ {kCFNumberSInt64Type, 0, 0, 3, 0},
     /* kCFNumberFloatType */    {kCFNumberFloat32Type, 1, 0, 2, 0},
     /* kCFNumberDoubleType */   {kCFNumberFloat64Type, 1, 1, 3, 0},
-    /* kCFNumberCFIndexType */  {LP64ENTRY(kCFNumberSInt, int, 0)},
-    /* kCFNumberNSIntegerType */{LP64ENTRY(kCFNumberSInt, int, 0)},
-    /* kCFNumberCGFloatType */  {LP64ENTRY(kCFNumberFloat, int, 1)},
+    /* kCFNumberCFIndexType */  {LP64ENTRY(kCFNumberSInt, CFIndex, 0)},
+    /* kCFNumberNSIntegerType */{LP64ENTRY(kCFNumberSInt, CFLong, 0)},
+    /* kCFNumberCGFloatType */  {LP64ENTRY(kCFNumberFloat, CFLong, 1)}, // CGFloat is as wide as CFLong
 
     /* kCFNumberSInt128Type */  {kCFNumberSInt128Type, 0, 1, 4, 0},
 
@@ -115,23 +115,117 @@ static struct __CFNumber __kCFNumberPositiveInfinity = {
     INIT_CFRUNTIME_BASE(), 0ULL
 };
 
+/* Tagged numbers
+ *
+ * Integer payload: value in upper bits, (canonical type - kCFNumberSInt8Type)
+ *  in lower 2 bits.
+ * Float payload: packed Float64 value in upper bits, storage bit (set for
+ *  kCFNumberFloat64Type) in the lowest bit. Float32 values are packed as
+ *  Float64.
+ */
+#define __kCFTaggedIntegerBits (CF_TAGGED_PAYLOAD_BITS - 2)
+#define __kCFTaggedFloatBits (CF_TAGGED_PAYLOAD_BITS - 1)
+#define __kCFTaggedFloatExponentBits 6
+
+#if !defined(CF_ENABLE_TAGGED_POINTERS)
+/* Without tagged pointers small integers are cached instead. */
 #define MinCachedInt  (-1)
 #define MaxCachedInt  (12)
-#define NotToBeCached (MinCachedInt - 1)
 // Storing CFNumberRefs for range MinCachedInt..MaxCachedInt
 static CFNumberRef __CFNumberCache[MaxCachedInt - MinCachedInt + 1] = {NULL};
+#endif
 
 static CFTypeID __kCFNumberTypeID = _kCFRuntimeNotATypeID;
 
 ///////////////////////////////////////////////////////////////////// private
 
 CF_INLINE CFNumberType __CFNumberGetType(CFNumberRef num) {
+    if (_CFIsTaggedPointer(num)) {
+        uintptr_t payload = _CFTaggedPointerGetPayload(num);
+        if (_CFTaggedPointerGetTag(num) == _kCFTaggedNumberInteger) {
+            return kCFNumberSInt8Type + (CFNumberType)(payload & 0x3);
+        }
+        return (payload & 1) ? kCFNumberFloat64Type : kCFNumberFloat32Type;
+    }
     return _CFBitfieldGetValue(CF_INFO(num), 4, 0);
 }
 CF_INLINE void __CFNumberSetType(CFNumberRef num, CFNumberType type) {
     _CFBitfieldSetValue(CF_INFO(num), 4, 0, (uint8_t)type);
 }
 
+// Returns pointer to the value, decoding tagged numbers into 'buffer'.
+CF_INLINE const void* __CFNumberGetData(CFNumberRef num, uint64_t* buffer) {
+    if (!_CFIsTaggedPointer(num)) {
+        return &(num->_pad);
+    }
+    if (_CFTaggedPointerGetTag(num) == _kCFTaggedNumberInteger) {
+        int64_t value = (int64_t)(_CFTaggedPointerGetSignedPayload(num) >> 2);
+        memmove(buffer, &value, 8);
+    } else {
+        uintptr_t payload = _CFTaggedPointerGetPayload(num);
+        Float64 d = _CFTaggedPointerUnpackDouble(payload >> 1,
+            __kCFTaggedFloatBits, __kCFTaggedFloatExponentBits);
+        if (payload & 1) {
+            memmove(buffer, &d, 8);
+        } else {
+            Float32 f = (Float32)d;
+            memmove(buffer, &f, 4);
+        }
+    }
+    return buffer;
+}
+
+#if defined(CF_ENABLE_TAGGED_POINTERS)
+
+// Returns NULL if the value can't be tagged.
+static CFNumberRef __CFTaggedNumberCreate(CFNumberType type, const void* valuePtr) {
+    CFNumberType canonicalType = __CFNumberTypeTable[type].canonicalType;
+    int64_t value;
+    Float64 d;
+    uintptr_t packed;
+    switch (canonicalType) {
+        case kCFNumberSInt8Type:   value = *(int8_t*)valuePtr; break;
+        case kCFNumberSInt16Type:  value = *(int16_t*)valuePtr; break;
+        case kCFNumberSInt32Type:  value = *(int32_t*)valuePtr; break;
+        case kCFNumberSInt64Type:  memmove(&value, valuePtr, 8); break;
+        case kCFNumberFloat32Type: d = *(Float32*)valuePtr; goto floatVal;
+        case kCFNumberFloat64Type: memmove(&d, valuePtr, 8); goto floatVal;
+        floatVal:
+            if (!_CFTaggedPointerPackDouble(d, __kCFTaggedFloatBits, __kCFTaggedFloatExponentBits, &packed)) {
+                return NULL;
+            }
+            return (CFNumberRef)_CFTaggedPointerMake(_kCFTaggedNumberFloat,
+                (packed << 1) | (canonicalType == kCFNumberFloat64Type ? 1 : 0));
+        default:
+            return NULL;
+    }
+    if (value < -((int64_t)1 << (__kCFTaggedIntegerBits - 1)) ||
+        value >= ((int64_t)1 << (__kCFTaggedIntegerBits - 1)))
+    {
+        return NULL;
+    }
+    return (CFNumberRef)_CFTaggedPointerMake(_kCFTaggedNumberInteger,
+        ((uintptr_t)value << 2) | (uintptr_t)(canonicalType - kCFNumberSInt8Type));
+}
+
+#else
+
+/* Returns true and stores integer value to 'value' if the number
+ *  can be cached.
+ */
+static Boolean __CFNumberIsCacheable(CFNumberType type, const void* valuePtr, int64_t* value) {
+    switch (__CFNumberTypeTable[type].canonicalType) {
+        case kCFNumberSInt8Type:  *value = *(int8_t*)valuePtr; break;
+        case kCFNumberSInt16Type: *value = *(int16_t*)valuePtr; break;
+        case kCFNumberSInt32Type: *value = *(int32_t*)valuePtr; break;
+        case kCFNumberSInt64Type: memmove(value, valuePtr, 8); break;
+        default: return false;
+    }
+    return MinCachedInt <= *value && *value <= MaxCachedInt;
+}
+
+#endif
+
 // Returns false if the output value is not the same as the number's value, which
 //  can occur due to accuracy loss and the value not being within the target range.
 static Boolean __CFNumberGetValue(CFNumberRef number, CFNumberType type, void* valuePtr) {
@@ -169,7 +263,8 @@ static Boolean __CFNumberGetValue(CFNumberRef number, CFNumberType type, void* v
 
     type = __CFNumberTypeTable[type].canonicalType;
     CFNumberType ntype = __CFNumberGetType(number);
-    const void* data = &(number->_pad);
+    uint64_t taggedData[2];
+    const void* data = __CFNumberGetData(number, taggedData);
     switch (type) {
         case kCFNumberSInt8Type:
             if (__CFNumberTypeTable[ntype].floatBit) {
@@ -377,7 +472,8 @@ static Boolean __CFNumberGetValueCompat(CFNumberRef number, CFNumberType type, v
 
     type = __CFNumberTypeTable[type].canonicalType;
     CFNumberType ntype = __CFNumberGetType(number);
-    const void* data = &(number->_pad);
+    uint64_t taggedData[2];
+    const void* data = __CFNumberGetData(number, taggedData);
     switch (type) {
         case kCFNumberSInt8Type:
             if (__CFNumberTypeTable[ntype].floatBit) {
@@ -644,6 +740,8 @@ CF_INTERNAL CFStringRef _CFNumberCopyFormattingDescriptionAsFloat64(CFTypeRef cf
 
 CF_INTERNAL void _CFNumberInitialize(void) {
     __kCFNumberTypeID = _CFRuntimeRegisterClassBridge(&__CFNumberClass, "NSCFNumber");
+    _CFRuntimeRegisterTaggedClass(_kCFTaggedNumberInteger, __kCFNumberTypeID);
+    _CFRuntimeRegisterTaggedClass(_kCFTaggedNumberFloat, __kCFNumberTypeID);
 
     _CFRuntimeInitStaticInstance(&__kCFNumberNaN, __kCFNumberTypeID);
     __CFNumberSetType(&__kCFNumberNaN, kCFNumberFloat64Type);
@@ -676,16 +774,13 @@ CFTypeID CFNumberGetTypeID(void) {
 CFNumberRef CFNumberCreate(CFAllocatorRef allocator, CFNumberType type, const void* valuePtr) {
     CF_VALIDATE_NUMBERTYPE_ARG(type);
 
-    // Look for cases where we can return a cached instance.
-    // We only use cached objects if the allocator is the system
-    // default allocator, except for the special floating point
-    // constant objects, where we return the cached object
-    // regardless of allocator, since that is what has always
-    // been done (and now must for compatibility).
+    // Special floating point constant objects are returned regardless
+    //  of allocator, since that is what has always been done (and now
+    //  must for compatibility). Other values are tagged if possible,
+    //  but only for the system default allocator.
     if (!allocator) {
         allocator = CFAllocatorGetDefault();
     }
-    int64_t valToBeCached = NotToBeCached;
 
     if (__CFNumberTypeTable[type].floatBit) {
         CFNumberRef cached = NULL;
@@ -709,48 +804,25 @@ CFNumberRef CFNumberCreate(CFAllocatorRef allocator, CFNumberType type, const vo
         if (cached) {
             return (CFNumberRef)CFRetain(cached);
         }
-    } else if (kCFAllocatorSystemDefault == allocator) {
-        switch (__CFNumberTypeTable[type].canonicalType) {
-            case kCFNumberSInt8Type:
-            {
-                int8_t val = *(int8_t*)valuePtr;
-                if (MinCachedInt <= val && val <= MaxCachedInt) {
-                    valToBeCached = (int64_t)val;
-                }
-                break;
-            }
-            case kCFNumberSInt16Type:
-            {
-                int16_t val = *(int16_t*)valuePtr;
-                if (MinCachedInt <= val && val <= MaxCachedInt) {
-                    valToBeCached = (int64_t)val;
-                }
-                break;
-            }
-            case kCFNumberSInt32Type:
-            {
-                int32_t val = *(int32_t*)valuePtr;
-                if (MinCachedInt <= val && val <= MaxCachedInt) {
-                    valToBeCached = (int64_t)val;
-                }
-                break;
-            }
-            case kCFNumberSInt64Type:
-            {
-                int64_t val = *(int64_t*)valuePtr;
-                if (MinCachedInt <= val && val <= MaxCachedInt) {
-                    valToBeCached = (int64_t)val;
-                }
-                break;
-            }
+    }
+#if defined(CF_ENABLE_TAGGED_POINTERS)
+    if (kCFAllocatorSystemDefault == allocator) {
+        CFNumberRef tagged = __CFTaggedNumberCreate(type, valuePtr);
+        if (tagged) {
+            return tagged;
         }
-        if (NotToBeCached != valToBeCached) {
-            CFNumberRef cached = __CFNumberCache[valToBeCached - MinCachedInt]; // Atomic to access the value in the cache
-            if (cached) {
-                return (CFNumberRef)CFRetain(cached);
-            }
+    }
+#else
+    int64_t valueToBeCached;
+    Boolean cacheable = (kCFAllocatorSystemDefault == allocator) &&
+        __CFNumberIsCacheable(type, valuePtr, &valueToBeCached);
+    if (cacheable) {
+        CFNumberRef cached = __CFNumberCache[valueToBeCached - MinCachedInt];
+        if (cached) {
+            return (CFNumberRef)CFRetain(cached);
         }
     }
+#endif
 
     CFIndex size = 8 + ((!__CFNumberTypeTable[type].floatBit && __CFNumberTypeTable[type].storageBit) ? 8 : 0);
     CFNumberRef result = (CFNumberRef)_CFRuntimeCreateInstance(allocator, __kCFNumberTypeID, size, NULL);
@@ -759,27 +831,6 @@ CFNumberRef CFNumberCreate(CFAllocatorRef allocator, CFNumberType type, const vo
     }
     __CFNumberSetType(result, __CFNumberTypeTable[type].canonicalType);
 
-    // for a value to be cached, we already have the value handy
-    if (NotToBeCached != valToBeCached) {
-        memmove((void*)&result->_pad, &valToBeCached, 8);
-        // Put this in the cache unless the cache is already filled (by another thread).  If we do put it in the cache, retain it an extra time for the cache.
-        // Note that we don't bother freeing this result and returning the cached value if the cache was filled, since cached CFNumbers are not guaranteed unique.
-        // Barrier assures that the number that is placed in the cache is properly formed.
-        CFNumberType origType = __CFNumberGetType(result);
-        // Force all cached numbers to have the same type, so that the type does not
-        // depend on the order and original type in/with which the numbers are created.
-        // Forcing the type AFTER it was cached would cause a race condition with other
-        // threads pulling the number object out of the cache and using it.
-        __CFNumberSetType(result, kCFNumberSInt32Type);
-        if (OSAtomicCompareAndSwapPtrBarrier(NULL, CF_CONST_CAST(void*, result), (void* volatile*)&__CFNumberCache[valToBeCached - MinCachedInt])) {
-            CFRetain(result);
-        } else {
-            // Did not cache the number object, put original type back.
-            __CFNumberSetType(result, origType);
-        }
-        return result;
-    }
-
     uint64_t value;
     switch (__CFNumberTypeTable[type].canonicalType) {
         case kCFNumberSInt8Type:   value = (uint64_t)(int64_t)*(int8_t*)valuePtr; goto smallVal;
@@ -791,6 +842,21 @@ CFNumberRef CFNumberCreate(CFAllocatorRef allocator, CFNumberType type, const vo
         case kCFNumberFloat32Type: memmove((void*)&result->_pad, valuePtr, 4); break;
         case kCFNumberFloat64Type: memmove((void*)&result->_pad, valuePtr, 8); break;
     }
+#if !defined(CF_ENABLE_TAGGED_POINTERS)
+    if (cacheable) {
+        // All cached numbers have the same type, so that the type doesn't
+        //  depend on which thread filled the cache. The type is forced
+        //  before the number is published, and the barrier makes sure
+        //  other threads see the number fully formed.
+        memmove((void*)&result->_pad, &valueToBeCached, 8);
+        __CFNumberSetType(result, kCFNumberSInt32Type);
+        if (OSAtomicCompareAndSwapPtrBarrier(NULL, CF_CONST_CAST(void*, result), (void* volatile*)&__CFNumberCache[valueToBeCached - MinCachedInt])) {
+            CFRetain(result);
+        } else {
+            __CFNumberSetType(result, __CFNumberTypeTable[type].canonicalType);
+        }
+    }
+#endif
     return result;
 }
 
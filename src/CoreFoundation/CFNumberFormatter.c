@@ -194,10 +194,6 @@ static const CFRuntimeClass __CFNumberFormatterClass = {
 
 ///////////////////////////////////////////////////////////////////// internal
 
-CF_INTERNAL void _CFNumberFormatterInitialize(void) {
-    __kCFNumberFormatterTypeID = _CFRuntimeRegisterClass(&__CFNumberFormatterClass);
-}
-
 ///////////////////////////////////////////////////////////////////// public
 
 CONST_STRING_DECL(kCFNumberFormatterCurrencyCode, "kCFNumberFormatterCurrencyCode")
@@ -242,7 +238,11 @@ CONST_STRING_DECL(kCFNumberFormatterMinSignificantDigits, "kCFNumberFormatterMin
 CONST_STRING_DECL(kCFNumberFormatterMaxSignificantDigits, "kCFNumberFormatterMaxSignificantDigits")
 
 CFTypeID CFNumberFormatterGetTypeID(void) {
-    return __kCFNumberFormatterTypeID;
+    CFTypeID typeID = _CFRuntimeLoadTypeID(&__kCFNumberFormatterTypeID);
+    if (typeID == _kCFRuntimeNotATypeID) {
+        typeID = _CFRuntimeRegisterClassOnce(&__kCFNumberFormatterTypeID, &__CFNumberFormatterClass, NULL);
+    }
+    return typeID;
 }
 
 CFNumberFormatterRef CFNumberFormatterCreate(CFAllocatorRef allocator,
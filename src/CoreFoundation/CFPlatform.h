@@ -21,6 +21,7 @@
 #include <CoreFoundation/CFURL.h>
 #include <CoreFoundation/CFString.h>
 #include <CoreFoundation/CFTimeZone.h>
+#include <CoreFoundation/CFRunLoopPort.h>
 #include <pthread.h>
 
 CF_EXTERN_C_BEGIN
@@ -33,6 +34,57 @@ CFStringEncoding CFPlatformGetSystemEncoding(void);
 CF_EXPORT
 CFStringEncoding CFPlatformGetFileSystemEncoding(void);
 
+/* CFAllocator related */
+
+/* Reserves 'size' bytes of address space, which is inaccessible until
+ *  committed. Returns NULL on failure.
+ */
+CF_EXPORT
+void* CFPlatformReserveMemory(CFIndex size);
+
+/* Makes reserved range readable and writable. */
+CF_EXPORT
+Boolean CFPlatformCommitMemory(void* address, CFIndex size);
+
+/* Returns default size of huge pages on the system (e.g. 2 MB). */
+CF_EXPORT
+CFIndex CFPlatformGetHugePageSize(void);
+
+/* Maps 'size' bytes (multiple of the huge page size) of readable and
+ *  writable memory, aligned to the huge page size and backed by huge
+ *  pages where possible. Returns NULL on failure.
+ */
+CF_EXPORT
+void* CFPlatformAllocateHugePages(CFIndex size);
+
+CF_EXPORT
+void CFPlatformFreeHugePages(void* address, CFIndex size);
+
+/* CFLock related */
+
+/* Blocks while '*address' equals 'value'. Can return spuriously. */
+CF_EXPORT
+void CFPlatformWaitOnAddress(volatile int32_t* address, int32_t value);
+
+/* Wakes one thread blocked on 'address'. */
+CF_EXPORT
+void CFPlatformWakeAddress(volatile int32_t* address);
+
+/* CFRuntime related */
+
+/* Fills 'frames' with return addresses of the calling thread, innermost
+ *  first, skipping 'skip' frames. Returns number of frames stored, which
+ *  is 0 if platform can't unwind the stack.
+ */
+CF_EXPORT
+CFIndex CFPlatformGetBacktrace(void** frames, CFIndex capacity, CFIndex skip);
+
+/* Returns text describing mapped libraries in /proc/self/maps format,
+ *  or NULL if it's not available.
+ */
+CF_EXPORT
+CFDataRef CFPlatformCopyMemoryMap(void);
+
 /* CFLog related */
 
 CF_EXPORT
@@ -52,6 +104,70 @@ double CFPlatformGetTSRRatePerSecond(void);
 CF_EXPORT
 uintptr_t CFPlatformGetThreadID(pthread_t thread);
 
+/* Returns CFRunLoopPortImpl which is installed during initialization,
+ *  or NULL if platform doesn't provide one (in which case user must
+ *  call CFRunLoopPortSetImpl).
+ */
+CF_EXPORT
+const CFRunLoopPortImpl* CFPlatformGetRunLoopPortImpl(void);
+
+/* Returns CFRunLoopPortExtendedImpl which is installed together with
+ *  the one returned by CFPlatformGetRunLoopPortImpl, or NULL.
+ */
+CF_EXPORT
+const CFRunLoopPortExtendedImpl* CFPlatformGetRunLoopPortExtendedImpl(void);
+
+/* Returns number of online processors (at least 1). */
+CF_EXPORT
+CFIndex CFPlatformGetProcessorCount(void);
+
+/* Restricts 'thread' to run on the processor 'index'. Returns false
+ *  if that is not supported.
+ */
+CF_EXPORT
+Boolean CFPlatformSetThreadAffinity(pthread_t thread, CFIndex index);
+
+/* CFAsyncFile related */
+
+typedef struct _CFPlatformIORing* CFPlatformIORingRef;
+
+/* Creates kernel submission/completion ring with at least 'entries'
+ *  submission slots. Returns NULL if platform has no such facility,
+ *  in which case CFAsyncFile falls back to CFPlatformTransferFile
+ *  called on worker threads.
+ */
+CF_EXPORT
+CFPlatformIORingRef CFPlatformIORingCreate(CFIndex entries);
+
+CF_EXPORT
+void CFPlatformIORingDestroy(CFPlatformIORingRef ring);
+
+/* Returns descriptor which becomes readable when completions are
+ *  available. CFPlatformIORingReap() resets it.
+ */
+CF_EXPORT
+int CFPlatformIORingGetEventFD(CFPlatformIORingRef ring);
+
+/* Queues read (or write) of 'length' bytes at 'offset' and submits
+ *  it to the kernel. Returns false if the ring is full, 'length' is
+ *  too large for the ring, or submission failed. 'context' is returned
+ *  by CFPlatformIORingReap().
+ */
+CF_EXPORT
+Boolean CFPlatformIORingSubmit(CFPlatformIORingRef ring, Boolean write, int fd, SInt64 offset, void* buffer, CFIndex length, void* context);
+
+/* Copies up to 'capacity' completions, returns number of completions
+ *  copied. Results are byte counts, or negated error codes.
+ */
+CF_EXPORT
+CFIndex CFPlatformIORingReap(CFPlatformIORingRef ring, void** contexts, CFIndex* results, CFIndex capacity);
+
+/* Blocking positioned read (or write). Returns byte count, or negated
+ *  error code.
+ */
+CF_EXPORT
+CFIndex CFPlatformTransferFile(Boolean write, int fd, SInt64 offset, void* buffer, CFIndex length);
+
 /* CFURL related */
 
 CF_EXPORT
@@ -14,8 +14,482 @@
  * limitations under the License.
  */
 
+#if !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE // for pthread_setaffinity_np
+#endif
+
 #include "CFInternal.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unwind.h>
+#include <sched.h>
+#if defined(__NR_io_uring_setup)
+    #include <linux/io_uring.h>
+#endif
+#include <linux/futex.h>
+
+///////////////////////////////////////////////////////////////////// private
+
+/* CFRunLoopPort implementation
+ *
+ * Each port wraps an eventfd. Signalling a port increments eventfd's
+ *  counter, waiting on a port set (or on an array of ports, in which
+ *  case a temporary epoll set is created) resets the counter of the
+ *  port that was reported.
+ * Timer ports wrap timerfd on CLOCK_MONOTONIC, which is also TSR clock,
+ *  so fire TSR is used as an absolute expiration time as is.
+ * File descriptor ports register the descriptor itself in the epoll
+ *  sets they are added to, so a mode's set is woken up directly by the
+ *  descriptors and reports all of them in one epoll_wait. The port keeps
+ *  the list of sets it is in, and changing events updates registrations
+ *  in all of them. Descriptor is registered only while some events are
+ *  requested, since errors and hangups are always reported. Waiting
+ *  collects ready events from the reported epoll events.
+ * Since epoll registers descriptors, not ports, a descriptor can only
+ *  be watched by one port in a set.
+ */
+
+typedef struct {
+    int eventFD; // eventfd or timerfd, -1 for file descriptor ports
+    int fd; // -1 unless this is a file descriptor port
+
+    /* File descriptor ports only. 'setFDs' are epoll sets the port
+     *  was added to, 'self' is the port itself, registered as epoll
+     *  data. Everything is protected by 'lock'.
+     */
+    CFLock_t lock;
+    CFOptionFlags events;
+    CFOptionFlags readyEvents;
+    CFRunLoopPortRef self;
+    int* setFDs;
+    CFIndex setCount;
+    CFIndex setCapacity;
+} __CFRunLoopPortData;
+
+static void __CFRunLoopPortInitData(__CFRunLoopPortData* port) {
+    port->eventFD = -1;
+    port->fd = -1;
+    port->lock = CFLockInit;
+    port->events = 0;
+    port->readyEvents = 0;
+    port->self = NULL;
+    port->setFDs = NULL;
+    port->setCount = 0;
+    port->setCapacity = 0;
+}
+
+static Boolean __CFRunLoopPortCreate(void* data) {
+    __CFRunLoopPortData* port = (__CFRunLoopPortData*)data;
+    __CFRunLoopPortInitData(port);
+    port->eventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return port->eventFD != -1;
+}
+
+static void __CFRunLoopPortDestroy(void* data) {
+    __CFRunLoopPortData* port = (__CFRunLoopPortData*)data;
+    if (port->eventFD != -1) {
+        close(port->eventFD);
+        port->eventFD = -1;
+    }
+    if (port->setFDs) {
+        CFAllocatorDeallocate(kCFAllocatorSystemDefault, port->setFDs);
+        port->setFDs = NULL;
+    }
+}
+
+static Boolean __CFRunLoopPortSignal(void* data) {
+    __CFRunLoopPortData* port = (__CFRunLoopPortData*)data;
+    uint64_t value = 1;
+    ssize_t result;
+    do {
+        result = write(port->eventFD, &value, sizeof(value));
+    } while (result == -1 && errno == EINTR);
+    // EAGAIN means counter is saturated, i.e. port is already signalled.
+    return result == sizeof(value) || errno == EAGAIN;
+}
+
+static Boolean __CFRunLoopPortCreateTimer(void* data) {
+    __CFRunLoopPortData* port = (__CFRunLoopPortData*)data;
+    __CFRunLoopPortInitData(port);
+    port->eventFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    return port->eventFD != -1;
+}
+
+static Boolean __CFRunLoopPortArmTimer(void* data, SInt64 fireTSR) {
+    __CFRunLoopPortData* port = (__CFRunLoopPortData*)data;
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (fireTSR > 0 && fireTSR != LLONG_MAX) {
+        spec.it_value.tv_sec = (time_t)(fireTSR / 1000000000);
+        spec.it_value.tv_nsec = (long)(fireTSR % 1000000000);
+    }
+    return timerfd_settime(port->eventFD, TFD_TIMER_ABSTIME, &spec, NULL) != -1;
+}
+
+/* Returns epoll events to watch for 'events', 0 if descriptor
+ *  shouldn't be registered.
+ */
+static uint32_t __CFRunLoopPortGetEpollEvents(CFOptionFlags events) {
+    uint32_t epollEvents = 0;
+    if (events & kCFRunLoopPortReadEvent) {
+        epollEvents |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (events & kCFRunLoopPortWriteEvent) {
+        epollEvents |= EPOLLOUT;
+    }
+    if (epollEvents && (events & kCFRunLoopPortEdgeTriggered)) {
+        epollEvents |= EPOLLET;
+    }
+    return epollEvents;
+}
+
+/* Moves descriptor registration in 'epollFD' from 'oldEvents'
+ *  to 'newEvents'. Port must be locked.
+ */
+static Boolean __CFRunLoopPortUpdateEpoll(__CFRunLoopPortData* port, int epollFD, CFOptionFlags oldEvents, CFOptionFlags newEvents) {
+    uint32_t oldEpollEvents = __CFRunLoopPortGetEpollEvents(oldEvents);
+    struct epoll_event event;
+    event.events = __CFRunLoopPortGetEpollEvents(newEvents);
+    event.data.ptr = port->self;
+    if (!event.events) {
+        if (oldEpollEvents && epoll_ctl(epollFD, EPOLL_CTL_DEL, port->fd, &event) == -1) {
+            // Descriptor is already gone if it was closed.
+            return errno == EBADF || errno == ENOENT;
+        }
+        return true;
+    }
+    return epoll_ctl(epollFD, oldEpollEvents ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, port->fd, &event) != -1;
+}
+
+static Boolean __CFRunLoopPortCreateWithFileDescriptor(void* data, int fd) {
+    __CFRunLoopPortData* port = (__CFRunLoopPortData*)data;
+    struct stat info;
+    __CFRunLoopPortInitData(port);
+    // epoll rejects regular files and directories with EPERM.
+    if (fstat(fd, &info) == -1 || S_ISREG(info.st_mode) || S_ISDIR(info.st_mode)) {
+        return false;
+    }
+    port->fd = fd;
+    return true;
+}
+
+static Boolean __CFRunLoopPortSetFileDescriptorEvents(void* data, CFOptionFlags events) {
+    __CFRunLoopPortData* port = (__CFRunLoopPortData*)data;
+    Boolean result = true;
+    CFIndex i;
+    CFLock(&port->lock);
+    for (i = 0; i != port->setCount; ++i) {
+        if (!__CFRunLoopPortUpdateEpoll(port, port->setFDs[i], port->events, events)) {
+            result = false;
+            break;
+        }
+    }
+    if (result) {
+        port->events = events;
+    } else {
+        // Restore sets that were already updated.
+        while (i--) {
+            __CFRunLoopPortUpdateEpoll(port, port->setFDs[i], events, port->events);
+        }
+    }
+    CFUnlock(&port->lock);
+    return result;
+}
+
+static CFOptionFlags __CFRunLoopPortTakeReadyEvents(void* data) {
+    __CFRunLoopPortData* port = (__CFRunLoopPortData*)data;
+    CFOptionFlags events;
+    CFLock(&port->lock);
+    events = port->readyEvents;
+    port->readyEvents = 0;
+    CFUnlock(&port->lock);
+    return events;
+}
+
+/* Called for the port reported by epoll with 'epollEvents'. */
+static void __CFRunLoopPortReset(__CFRunLoopPortData* port, uint32_t epollEvents) {
+    if (port->fd != -1) {
+        CFOptionFlags readyEvents = 0;
+        if (epollEvents & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            readyEvents |= kCFRunLoopPortReadEvent;
+        }
+        if (epollEvents & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+            readyEvents |= kCFRunLoopPortWriteEvent;
+        }
+        CFLock(&port->lock);
+        port->readyEvents |= readyEvents;
+        CFUnlock(&port->lock);
+    } else {
+        uint64_t value;
+        while (read(port->eventFD, &value, sizeof(value)) == -1 && errno == EINTR) {
+        }
+    }
+}
+
+/* Waits on 'epollFD' for at most 'timeout' seconds.
+ * Negative timeout means infinite wait, very long timeouts are
+ *  clamped (caller is expected to wait again).
+ * epoll_pwait2 is used (when available) for nanosecond-accurate
+ *  timeouts, otherwise timeout is rounded up to milliseconds so
+ *  that we never wake up before the deadline.
+ */
+static int __CFEpollWait(int epollFD, struct epoll_event* events, int maxEvents, CFTimeInterval timeout) {
+#if defined(__NR_epoll_pwait2)
+    static Boolean hasPwait2 = true;
+    if (hasPwait2 && timeout > 0 && timeout < INT_MAX / 1000) {
+        struct timespec ts;
+        ts.tv_sec = (time_t)timeout;
+        ts.tv_nsec = (long)((timeout - (CFTimeInterval)ts.tv_sec) * 1.0e9);
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec += 1;
+            ts.tv_nsec -= 1000000000;
+        }
+        int result = (int)syscall(__NR_epoll_pwait2, epollFD, events, maxEvents, &ts, NULL, 0);
+        if (result != -1 || errno != ENOSYS) {
+            return result;
+        }
+        hasPwait2 = false;
+    }
+#endif
+    int timeoutMS;
+    if (timeout < 0) {
+        timeoutMS = -1;
+    } else if (timeout >= INT_MAX / 1000) {
+        timeoutMS = INT_MAX;
+    } else {
+        timeoutMS = (int)ceil(timeout * 1000.0);
+    }
+    return epoll_wait(epollFD, events, maxEvents, timeoutMS);
+}
+
+static Boolean __CFRunLoopPortWait(CFArrayRef ports, CFTimeInterval timeout, CFIndex* signalledIndex) {
+    CFIndex i, count = CFArrayGetCount(ports);
+    struct epoll_event event;
+    int result;
+    int epollFD = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFD == -1) {
+        return false;
+    }
+    for (i = 0; i != count; ++i) {
+        CFRunLoopPortRef port = (CFRunLoopPortRef)CFArrayGetValueAtIndex(ports, i);
+        __CFRunLoopPortData* data = (__CFRunLoopPortData*)CFRunLoopPortGetImplData(port);
+        int fd = data->eventFD;
+        event.events = EPOLLIN;
+        event.data.u64 = (uint64_t)i;
+        if (data->fd != -1) {
+            CFLock(&data->lock);
+            event.events = __CFRunLoopPortGetEpollEvents(data->events);
+            CFUnlock(&data->lock);
+            fd = data->fd;
+            if (!event.events) {
+                continue;
+            }
+        }
+        if (epoll_ctl(epollFD, EPOLL_CTL_ADD, fd, &event) == -1 && errno != EEXIST) {
+            close(epollFD);
+            return false;
+        }
+    }
+    result = __CFEpollWait(epollFD, &event, 1, timeout);
+    close(epollFD);
+    if (result == -1 && errno != EINTR) {
+        return false;
+    }
+    if (result > 0) {
+        CFIndex index = (CFIndex)event.data.u64;
+        CFRunLoopPortRef port = (CFRunLoopPortRef)CFArrayGetValueAtIndex(ports, index);
+        __CFRunLoopPortReset((__CFRunLoopPortData*)CFRunLoopPortGetImplData(port), event.events);
+        *signalledIndex = index;
+    } else {
+        *signalledIndex = -1;
+    }
+    return true;
+}
+
+/* Port set is a long-lived epoll instance, ports are registered
+ *  with their CFRunLoopPortRef as epoll data. Up to
+ *  __kCFRunLoopPortSetMaxEvents ports are collected per wait.
+ */
+
+#define __kCFRunLoopPortSetMaxEvents 64
+
+typedef struct {
+    int epollFD;
+} __CFRunLoopPortSetData;
+
+static Boolean __CFRunLoopPortSetCreate(void* setData) {
+    __CFRunLoopPortSetData* set = (__CFRunLoopPortSetData*)setData;
+    set->epollFD = epoll_create1(EPOLL_CLOEXEC);
+    return set->epollFD != -1;
+}
+
+static void __CFRunLoopPortSetDestroy(void* setData) {
+    __CFRunLoopPortSetData* set = (__CFRunLoopPortSetData*)setData;
+    close(set->epollFD);
+}
+
+static Boolean __CFRunLoopPortSetAddFileDescriptor(__CFRunLoopPortSetData* set, CFRunLoopPortRef port, __CFRunLoopPortData* data) {
+    Boolean result = false;
+    CFLock(&data->lock);
+    if (data->setCount == data->setCapacity) {
+        CFIndex capacity = data->setCapacity ? 2 * data->setCapacity : 2;
+        int* setFDs = (int*)CFAllocatorReallocate(kCFAllocatorSystemDefault, data->setFDs, capacity * sizeof(int), 0);
+        if (setFDs) {
+            data->setFDs = setFDs;
+            data->setCapacity = capacity;
+        }
+    }
+    if (data->setCount != data->setCapacity) {
+        data->self = port;
+        if (__CFRunLoopPortUpdateEpoll(data, set->epollFD, 0, data->events)) {
+            data->setFDs[data->setCount++] = set->epollFD;
+            result = true;
+        }
+    }
+    CFUnlock(&data->lock);
+    return result;
+}
+
+static void __CFRunLoopPortSetRemoveFileDescriptor(__CFRunLoopPortSetData* set, __CFRunLoopPortData* data) {
+    CFIndex i;
+    CFLock(&data->lock);
+    for (i = 0; i != data->setCount; ++i) {
+        if (data->setFDs[i] == set->epollFD) {
+            __CFRunLoopPortUpdateEpoll(data, set->epollFD, data->events, 0);
+            data->setFDs[i] = data->setFDs[--data->setCount];
+            break;
+        }
+    }
+    CFUnlock(&data->lock);
+}
+
+static Boolean __CFRunLoopPortSetAdd(void* setData, CFRunLoopPortRef port, void* data) {
+    __CFRunLoopPortSetData* set = (__CFRunLoopPortSetData*)setData;
+    __CFRunLoopPortData* portData = (__CFRunLoopPortData*)data;
+    struct epoll_event event;
+    if (portData->fd != -1) {
+        return __CFRunLoopPortSetAddFileDescriptor(set, port, portData);
+    }
+    event.events = EPOLLIN;
+    event.data.ptr = port;
+    return epoll_ctl(set->epollFD, EPOLL_CTL_ADD, portData->eventFD, &event) != -1;
+}
+
+static void __CFRunLoopPortSetRemove(void* setData, CFRunLoopPortRef port, void* data) {
+    __CFRunLoopPortSetData* set = (__CFRunLoopPortSetData*)setData;
+    __CFRunLoopPortData* portData = (__CFRunLoopPortData*)data;
+    struct epoll_event event; // ignored, but must be non-NULL on old kernels
+    if (portData->fd != -1) {
+        __CFRunLoopPortSetRemoveFileDescriptor(set, portData);
+        return;
+    }
+    epoll_ctl(set->epollFD, EPOLL_CTL_DEL, portData->eventFD, &event);
+}
+
+static Boolean __CFRunLoopPortSetWait(void* setData, CFTimeInterval timeout, CFRunLoopPortRef* signalledPorts, CFIndex capacity, CFIndex* signalledCount) {
+    __CFRunLoopPortSetData* set = (__CFRunLoopPortSetData*)setData;
+    struct epoll_event events[__kCFRunLoopPortSetMaxEvents];
+    int i, result;
+    result = __CFEpollWait(set->epollFD, events, (int)_CFMin(capacity, __kCFRunLoopPortSetMaxEvents), timeout);
+    *signalledCount = 0;
+    if (result == -1 && errno != EINTR) {
+        return false;
+    }
+    for (i = 0; i < result; ++i) {
+        CFRunLoopPortRef port = (CFRunLoopPortRef)events[i].data.ptr;
+        __CFRunLoopPortReset((__CFRunLoopPortData*)CFRunLoopPortGetImplData(port), events[i].events);
+        signalledPorts[i] = port;
+    }
+    *signalledCount = (result > 0) ? result : 0;
+    return true;
+}
+
+static const CFRunLoopPortImpl __CFRunLoopPortImpl = {
+    sizeof(__CFRunLoopPortData),
+    __CFRunLoopPortCreate,
+    __CFRunLoopPortDestroy,
+    __CFRunLoopPortSignal,
+    __CFRunLoopPortWait
+};
+
+static const CFRunLoopPortExtendedImpl __CFRunLoopPortExtendedImpl = {
+    0, // version
+    sizeof(__CFRunLoopPortSetData),
+    __CFRunLoopPortSetCreate,
+    __CFRunLoopPortSetDestroy,
+    __CFRunLoopPortSetAdd,
+    __CFRunLoopPortSetRemove,
+    __CFRunLoopPortSetWait,
+    __CFRunLoopPortCreateTimer,
+    __CFRunLoopPortArmTimer,
+    __CFRunLoopPortCreateWithFileDescriptor,
+    __CFRunLoopPortSetFileDescriptorEvents,
+    __CFRunLoopPortTakeReadyEvents
+};
+
+#if defined(__NR_io_uring_setup)
+
+/* io_uring implementation of CFPlatformIORing
+ *
+ * Ring is set up and entered with raw syscalls (no liburing). Completions
+ *  are signalled through an eventfd registered with the ring. Ring is
+ *  used by a single thread, so the only synchronization needed is with
+ *  the kernel: head / tail indices are accessed with acquire / release
+ *  semantics.
+ * IORING_OP_READ / IORING_OP_WRITE appeared in 5.6, IORING_FEAT_FAST_POLL
+ *  in 5.7, so the latter is used to detect kernels supporting the former.
+ * Without io_uring headers (e.g. older Android NDKs) rings are not
+ *  available and CFAsyncFile uses worker threads.
+ */
+
+struct _CFPlatformIORing {
+    int ringFD;
+    int eventFD;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    unsigned sqEntries;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+};
+
+static void __CFPlatformIORingUnmap(CFPlatformIORingRef ring) {
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    if (ring->cqRing && ring->cqRing != ring->sqRing) {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    if (ring->sqRing) {
+        munmap(ring->sqRing, ring->sqRingSize);
+    }
+}
+
+static void* __CFPlatformIORingMap(int ringFD, size_t size, off_t offset) {
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFD, offset);
+    return (ptr == MAP_FAILED) ? NULL : ptr;
+}
+
+#endif /* __NR_io_uring_setup */
 
 ///////////////////////////////////////////////////////////////////// internal
 
@@ -29,6 +503,139 @@ CFStringEncoding CFPlatformGetFileSystemEncoding() {
     return kCFStringEncodingUTF8;
 }
 
+CF_INTERNAL
+void* CFPlatformReserveMemory(CFIndex size) {
+    void* address = mmap(NULL, (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return (address == MAP_FAILED) ? NULL : address;
+}
+
+CF_INTERNAL
+Boolean CFPlatformCommitMemory(void* address, CFIndex size) {
+    return !mprotect(address, (size_t)size, PROT_READ | PROT_WRITE);
+}
+
+#define __kCFPlatformDefaultHugePageSize (2 * 1024 * 1024)
+
+static volatile CFIndex __CFPlatformHugePageSize = 0;
+
+// How long explicit huge pages are not tried after the pool ran out.
+#define __kCFPlatformHugeTLBBackoff 1.0
+
+// Set when explicit huge pages are not configured (empty hugetlbfs pool).
+static Boolean __CFPlatformHugeTLBUnavailable = false;
+
+// Whether HugePages_Total was read, it is read only once.
+static Boolean __CFPlatformHugeTLBPoolChecked = false;
+
+// TSR before which explicit huge pages are not tried (exhausted pool).
+static SInt64 __CFPlatformHugeTLBRetryTSR = 0;
+
+/* Reads value of the key from /proc/meminfo, values in kB are
+ *  converted to bytes.
+ */
+static Boolean __CFPlatformReadMemInfo(const char* key, long long* value) {
+    size_t keyLength = strlen(key);
+    Boolean found = false;
+    char line[128];
+    FILE* file = fopen("/proc/meminfo", "r");
+    if (!file) {
+        return false;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        char unit[8] = "";
+        if (strncmp(line, key, keyLength) || line[keyLength] != ':') {
+            continue;
+        }
+        if (sscanf(line + keyLength + 1, "%lld %7s", value, unit) >= 1) {
+            if (!strcmp(unit, "kB")) {
+                *value *= 1024;
+            }
+            found = true;
+        }
+        break;
+    }
+    fclose(file);
+    return found;
+}
+
+CF_INTERNAL
+CFIndex CFPlatformGetHugePageSize(void) {
+    CFIndex size = __CFPlatformHugePageSize;
+    if (!size) {
+        long long value;
+        if (__CFPlatformReadMemInfo("Hugepagesize", &value) &&
+            value > 0 && !(value & (value - 1)) && value <= LONG_MAX)
+        {
+            size = (CFIndex)value;
+        } else {
+            size = __kCFPlatformDefaultHugePageSize;
+        }
+        __CFPlatformHugePageSize = size;
+    }
+    return size;
+}
+
+CF_INTERNAL
+void* CFPlatformAllocateHugePages(CFIndex size) {
+    const uintptr_t alignment = (uintptr_t)CFPlatformGetHugePageSize();
+    uint8_t* region;
+    uint8_t* address;
+#if defined(MAP_HUGETLB)
+    if (!__CFPlatformHugeTLBUnavailable &&
+        CFPlatformReadTSR() >= __atomic_load_n(&__CFPlatformHugeTLBRetryTSR, __ATOMIC_RELAXED))
+    {
+        // Explicit huge page mappings are naturally aligned.
+        address = (uint8_t*)mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (address != MAP_FAILED) {
+            return address;
+        }
+        if (errno == ENOMEM || errno == EINVAL) {
+            /* Empty pool means explicit huge pages are not configured, so
+             *  they are never tried again. Otherwise the pool is merely
+             *  exhausted right now, so back off instead of doing a failing
+             *  mmap on every allocation.
+             */
+            if (!__CFPlatformHugeTLBPoolChecked) {
+                long long total;
+                if (__CFPlatformReadMemInfo("HugePages_Total", &total) && !total) {
+                    __CFPlatformHugeTLBUnavailable = true;
+                }
+                __CFPlatformHugeTLBPoolChecked = true;
+            }
+            if (!__CFPlatformHugeTLBUnavailable) {
+                __atomic_store_n(&__CFPlatformHugeTLBRetryTSR,
+                    CFPlatformReadTSR() + (SInt64)(__kCFPlatformHugeTLBBackoff * CFPlatformGetTSRRatePerSecond()),
+                    __ATOMIC_RELAXED);
+            }
+        }
+    }
+#endif
+    // Map extra huge page and trim both ends to get the alignment.
+    region = (uint8_t*)mmap(NULL, (size_t)size + alignment, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        return NULL;
+    }
+    address = (uint8_t*)(((uintptr_t)region + alignment - 1) & ~(alignment - 1));
+    if (address != region) {
+        munmap(region, address - region);
+    }
+    if (address + size != region + size + alignment) {
+        munmap(address + size, (region + alignment) - address);
+    }
+#if defined(MADV_HUGEPAGE)
+    // Transparent huge pages, fails harmlessly when they are disabled.
+    madvise(address, (size_t)size, MADV_HUGEPAGE);
+#endif
+    return address;
+}
+
+CF_INTERNAL
+void CFPlatformFreeHugePages(void* address, CFIndex size) {
+    munmap(address, (size_t)size);
+}
+
 CF_INTERNAL
 void CFPlatformLog(const char* prefix, CFLogLevel level, CFStringRef message) {
     CFDataRef chars = CFStringCreateExternalRepresentation(
@@ -59,6 +666,285 @@ uintptr_t CFPlatformGetThreadID(pthread_t thread) {
     return (uintptr_t)thread;
 }
 
+CF_INTERNAL
+const CFRunLoopPortImpl* CFPlatformGetRunLoopPortImpl(void) {
+    return &__CFRunLoopPortImpl;
+}
+
+CF_INTERNAL
+const CFRunLoopPortExtendedImpl* CFPlatformGetRunLoopPortExtendedImpl(void) {
+    return &__CFRunLoopPortExtendedImpl;
+}
+
+CF_INTERNAL
+void CFPlatformWaitOnAddress(volatile int32_t* address, int32_t value) {
+    syscall(__NR_futex, address, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+CF_INTERNAL
+void CFPlatformWakeAddress(volatile int32_t* address) {
+    syscall(__NR_futex, address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+typedef struct {
+    void** frames;
+    CFIndex capacity;
+    CFIndex count;
+    CFIndex skip;
+} __CFBacktraceState;
+
+static _Unwind_Reason_Code __CFBacktraceCallback(struct _Unwind_Context* context, void* info) {
+    __CFBacktraceState* state = (__CFBacktraceState*)info;
+    uintptr_t pc = _Unwind_GetIP(context);
+    if (!pc) {
+        return _URC_END_OF_STACK;
+    }
+    if (state->skip) {
+        state->skip--;
+        return _URC_NO_REASON;
+    }
+    state->frames[state->count++] = (void*)pc;
+    return (state->count == state->capacity) ? _URC_END_OF_STACK : _URC_NO_REASON;
+}
+
+CF_INTERNAL
+CFIndex CFPlatformGetBacktrace(void** frames, CFIndex capacity, CFIndex skip) {
+    __CFBacktraceState state = {frames, capacity, 0, skip + 1};
+    if (capacity <= 0) {
+        return 0;
+    }
+    // execinfo is not available on Android, libgcc unwinder is.
+    _Unwind_Backtrace(__CFBacktraceCallback, &state);
+    return state.count;
+}
+
+CF_INTERNAL
+CFDataRef CFPlatformCopyMemoryMap(void) {
+    CFMutableDataRef data;
+    UInt8 buffer[4096];
+    int fd = open("/proc/self/maps", O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+    data = CFDataCreateMutable(kCFAllocatorSystemDefault, 0);
+    while (true) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count == -1 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        CFDataAppendBytes(data, buffer, count);
+    }
+    close(fd);
+    return data;
+}
+
+CF_INTERNAL
+CFIndex CFPlatformGetProcessorCount(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (CFIndex)count : 1;
+}
+
+CF_INTERNAL
+Boolean CFPlatformSetThreadAffinity(pthread_t thread, CFIndex index) {
+    cpu_set_t set;
+    if (index < 0 || index >= CPU_SETSIZE) {
+        return false;
+    }
+    CPU_ZERO(&set);
+    CPU_SET(index, &set);
+    return !pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+#if defined(__NR_io_uring_setup)
+
+CF_INTERNAL
+CFPlatformIORingRef CFPlatformIORingCreate(CFIndex entries) {
+    struct io_uring_params params;
+    CFPlatformIORingRef ring;
+    memset(&params, 0, sizeof(params));
+    int ringFD = (int)syscall(__NR_io_uring_setup, (unsigned)entries, &params);
+    if (ringFD == -1) {
+        // ENOSYS on old kernels, EPERM when disabled by seccomp / sysctl.
+        return NULL;
+    }
+    if (!(params.features & IORING_FEAT_FAST_POLL)) {
+        close(ringFD);
+        return NULL;
+    }
+    ring = (CFPlatformIORingRef)calloc(1, sizeof(struct _CFPlatformIORing));
+    if (!ring) {
+        close(ringFD);
+        return NULL;
+    }
+    ring->ringFD = ringFD;
+    ring->eventFD = -1;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cqRingSize > ring->sqRingSize) {
+            ring->sqRingSize = ring->cqRingSize;
+        }
+        ring->cqRingSize = ring->sqRingSize;
+    }
+    ring->sqRing = __CFPlatformIORingMap(ringFD, ring->sqRingSize, IORING_OFF_SQ_RING);
+    if (!ring->sqRing) {
+        goto failed;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = __CFPlatformIORingMap(ringFD, ring->cqRingSize, IORING_OFF_CQ_RING);
+        if (!ring->cqRing) {
+            goto failed;
+        }
+    }
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)__CFPlatformIORingMap(ringFD, ring->sqesSize, IORING_OFF_SQES);
+    if (!ring->sqes) {
+        goto failed;
+    }
+    ring->sqHead = (unsigned*)((char*)ring->sqRing + params.sq_off.head);
+    ring->sqTail = (unsigned*)((char*)ring->sqRing + params.sq_off.tail);
+    ring->sqMask = (unsigned*)((char*)ring->sqRing + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned*)((char*)ring->sqRing + params.sq_off.array);
+    ring->sqEntries = params.sq_entries;
+    ring->cqHead = (unsigned*)((char*)ring->cqRing + params.cq_off.head);
+    ring->cqTail = (unsigned*)((char*)ring->cqRing + params.cq_off.tail);
+    ring->cqMask = (unsigned*)((char*)ring->cqRing + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)((char*)ring->cqRing + params.cq_off.cqes);
+
+    ring->eventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ring->eventFD == -1 ||
+        syscall(__NR_io_uring_register, ringFD, IORING_REGISTER_EVENTFD, &ring->eventFD, 1) == -1)
+    {
+        goto failed;
+    }
+    return ring;
+
+failed:
+    CFPlatformIORingDestroy(ring);
+    return NULL;
+}
+
+CF_INTERNAL
+void CFPlatformIORingDestroy(CFPlatformIORingRef ring) {
+    if (!ring) {
+        return;
+    }
+    __CFPlatformIORingUnmap(ring);
+    if (ring->eventFD != -1) {
+        close(ring->eventFD);
+    }
+    close(ring->ringFD);
+    free(ring);
+}
+
+CF_INTERNAL
+int CFPlatformIORingGetEventFD(CFPlatformIORingRef ring) {
+    return ring->eventFD;
+}
+
+CF_INTERNAL
+Boolean CFPlatformIORingSubmit(CFPlatformIORingRef ring, Boolean write, int fd, SInt64 offset, void* buffer, CFIndex length, void* context) {
+    unsigned tail = *ring->sqTail;
+    unsigned head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+    if ((UInt64)length > UINT32_MAX) {
+        // Doesn't fit 'len', let CFPlatformTransferFile handle it.
+        return false;
+    }
+    if (tail - head >= ring->sqEntries) {
+        return false;
+    }
+    unsigned index = tail & *ring->sqMask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = (uint64_t)offset;
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = (uint32_t)length;
+    sqe->user_data = (uint64_t)(uintptr_t)context;
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    long result;
+    do {
+        result = syscall(__NR_io_uring_enter, ring->ringFD, 1, 0, 0, NULL, 0);
+    } while (result == -1 && errno == EINTR);
+    if (result != 1) {
+        // Entry wasn't consumed, take it back.
+        __atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+        return false;
+    }
+    return true;
+}
+
+CF_INTERNAL
+CFIndex CFPlatformIORingReap(CFPlatformIORingRef ring, void** contexts, CFIndex* results, CFIndex capacity) {
+    uint64_t value;
+    CFIndex count = 0;
+    ssize_t ignored = read(ring->eventFD, &value, sizeof(value));
+    (void)ignored;
+    unsigned head = *ring->cqHead;
+    unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail && count < capacity) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cqMask];
+        contexts[count] = (void*)(uintptr_t)cqe->user_data;
+        results[count] = cqe->res;
+        count++;
+        head++;
+    }
+    __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    if (head != tail) {
+        // Not everything was reaped, make sure eventfd stays readable.
+        value = 1;
+        ignored = write(ring->eventFD, &value, sizeof(value));
+    }
+    return count;
+}
+
+#else /* !__NR_io_uring_setup */
+
+CF_INTERNAL
+CFPlatformIORingRef CFPlatformIORingCreate(CFIndex entries) {
+    return NULL;
+}
+
+CF_INTERNAL
+void CFPlatformIORingDestroy(CFPlatformIORingRef ring) {
+}
+
+CF_INTERNAL
+int CFPlatformIORingGetEventFD(CFPlatformIORingRef ring) {
+    return -1;
+}
+
+CF_INTERNAL
+Boolean CFPlatformIORingSubmit(CFPlatformIORingRef ring, Boolean write, int fd, SInt64 offset, void* buffer, CFIndex length, void* context) {
+    return false;
+}
+
+CF_INTERNAL
+CFIndex CFPlatformIORingReap(CFPlatformIORingRef ring, void** contexts, CFIndex* results, CFIndex capacity) {
+    return 0;
+}
+
+#endif /* __NR_io_uring_setup */
+
+CF_INTERNAL
+CFIndex CFPlatformTransferFile(Boolean write, int fd, SInt64 offset, void* buffer, CFIndex length) {
+    ssize_t result;
+    do {
+        result = write ?
+            pwrite(fd, buffer, (size_t)length, (off_t)offset) :
+            pread(fd, buffer, (size_t)length, (off_t)offset);
+    } while (result == -1 && errno == EINTR);
+    return (result == -1) ? -errno : (CFIndex)result;
+}
+
 CF_INTERNAL
 CFURLPathStyle CFPlatformGetURLPathStyle(void) {
     return kCFURLPOSIXPathStyle;
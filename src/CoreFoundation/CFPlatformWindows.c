@@ -16,6 +16,7 @@
 
 #include <windows.h>
 #include <stdio.h>
+#include <errno.h>
 #include "CFInternal.h"
 
 ///////////////////////////////////////////////////////////////////// internal
@@ -30,6 +31,32 @@ CFStringEncoding CFPlatformGetFileSystemEncoding() {
     return CFPlatformGetSystemEncoding();
 }
 
+CF_INTERNAL
+void* CFPlatformReserveMemory(CFIndex size) {
+    return VirtualAlloc(NULL, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+CF_INTERNAL
+Boolean CFPlatformCommitMemory(void* address, CFIndex size) {
+    return VirtualAlloc(address, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+CF_INTERNAL
+CFIndex CFPlatformGetHugePageSize(void) {
+    return 2 * 1024 * 1024;
+}
+
+CF_INTERNAL
+void* CFPlatformAllocateHugePages(CFIndex size) {
+    //TODO CFPlatformAllocateHugePages (MEM_LARGE_PAGES needs SeLockMemoryPrivilege)
+    return VirtualAlloc(NULL, (SIZE_T)size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+CF_INTERNAL
+void CFPlatformFreeHugePages(void* address, CFIndex size) {
+    VirtualFree(address, 0, MEM_RELEASE);
+}
+
 CF_INTERNAL
 void CFPlatformLog(const char* prefix, CFLogLevel level, CFStringRef message) {
     CFDataRef chars = CFStringCreateExternalRepresentation(
@@ -66,6 +93,91 @@ uintptr_t CFPlatformGetThreadID(pthread_t thread) {
     return (uintptr_t)pthread_getw32threadhandle_np(thread);
 }
 
+CF_INTERNAL
+const CFRunLoopPortImpl* CFPlatformGetRunLoopPortImpl(void) {
+    //TODO CFPlatformGetRunLoopPortImpl
+    return NULL;
+}
+
+CF_INTERNAL
+const CFRunLoopPortExtendedImpl* CFPlatformGetRunLoopPortExtendedImpl(void) {
+    return NULL;
+}
+
+CF_INTERNAL
+void CFPlatformWaitOnAddress(volatile int32_t* address, int32_t value) {
+    //TODO CFPlatformWaitOnAddress (WaitOnAddress on Windows 8+)
+    if (*address == value) {
+        SwitchToThread();
+    }
+}
+
+CF_INTERNAL
+void CFPlatformWakeAddress(volatile int32_t* address) {
+}
+
+CF_INTERNAL
+CFIndex CFPlatformGetBacktrace(void** frames, CFIndex capacity, CFIndex skip) {
+    if (capacity <= 0) {
+        return 0;
+    }
+    return (CFIndex)CaptureStackBackTrace((DWORD)(skip + 1), (DWORD)capacity, frames, NULL);
+}
+
+CF_INTERNAL
+CFDataRef CFPlatformCopyMemoryMap(void) {
+    //TODO CFPlatformCopyMemoryMap (EnumProcessModules)
+    return NULL;
+}
+
+CF_INTERNAL
+CFIndex CFPlatformGetProcessorCount(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors > 0) ? (CFIndex)info.dwNumberOfProcessors : 1;
+}
+
+CF_INTERNAL
+Boolean CFPlatformSetThreadAffinity(pthread_t thread, CFIndex index) {
+    if (index < 0 || index >= (CFIndex)(sizeof(DWORD_PTR) * 8)) {
+        return false;
+    }
+    return SetThreadAffinityMask(
+        pthread_getw32threadhandle_np(thread),
+        (DWORD_PTR)1 << index) != 0;
+}
+
+CF_INTERNAL
+CFPlatformIORingRef CFPlatformIORingCreate(CFIndex entries) {
+    //TODO CFPlatformIORingCreate (IoRing / completion ports)
+    return NULL;
+}
+
+CF_INTERNAL
+void CFPlatformIORingDestroy(CFPlatformIORingRef ring) {
+}
+
+CF_INTERNAL
+int CFPlatformIORingGetEventFD(CFPlatformIORingRef ring) {
+    return -1;
+}
+
+CF_INTERNAL
+Boolean CFPlatformIORingSubmit(CFPlatformIORingRef ring, Boolean write, int fd, SInt64 offset, void* buffer, CFIndex length, void* context) {
+    return false;
+}
+
+CF_INTERNAL
+CFIndex CFPlatformIORingReap(CFPlatformIORingRef ring, void** contexts, CFIndex* results, CFIndex capacity) {
+    return 0;
+}
+
+CF_INTERNAL
+CFIndex CFPlatformTransferFile(Boolean write, int fd, SInt64 offset, void* buffer, CFIndex length) {
+    //TODO CFPlatformTransferFile
+    return -ENOSYS;
+}
+
 CF_INTERNAL
 CFURLPathStyle CFPlatformGetURLPathStyle(void) {
     return kCFURLWindowsPathStyle;
@@ -43,7 +43,7 @@
 //XXX move up
 extern void __CFRunLoopPortInitialize();
 
-int _LogCFRunLoop = 1;
+int _LogCFRunLoop = 0;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -52,17 +52,34 @@ int _LogCFRunLoop = 1;
 /* be very careful of common subexpression elimination and compacting code, particular across locks and unlocks! */
 /* run loop mode structures should never be deallocated, even if they become empty */
 
+/* Node of the function queue, see CFRunLoopPerformFunction(). */
+typedef struct __CFRunLoopFunctionNode {
+    struct __CFRunLoopFunctionNode* next;
+    CFStringRef modeName; // retained
+    CFRunLoopPerformCallBack function;
+    void* context;
+    uint64_t order; // submission order, assigned when the node is queued to a mode
+} __CFRunLoopFunctionNode;
+
+/* FIFO of function nodes, guarded by the run loop lock. */
+typedef struct {
+    __CFRunLoopFunctionNode* head;
+    __CFRunLoopFunctionNode** tail;
+} __CFRunLoopFunctionQueue;
+
 struct __CFRunLoopMode {
     CFRuntimeBase _base;
-    CFSpinLock_t _lock; /* must have the run loop locked before locking this */
+    CFLock_t _lock; /* must have the run loop locked before locking this */
     CFStringRef _name;
     Boolean _stopped;
     char _padding[3];
     CFMutableSetRef _sources;
     CFMutableSetRef _observers;
-    CFMutableSetRef _timers;
+    __CFRunLoopTimerHeap _timers;
     CFMutableArrayRef _submodes; // names of the submodes
-    CFMutableArrayRef _portSet;
+    CFRunLoopPortSetRef _portSet; // wakeup port, timer port and ports of version 1 sources
+    CFMutableDictionaryRef _portSources; // port -> version 1 source, not retained
+    __CFRunLoopFunctionQueue _functions; // functions for this mode
 };
 
 static CFTypeID __kCFRunLoopTypeID = _kCFRuntimeNotATypeID;
@@ -70,8 +87,15 @@ static CFTypeID __kCFRunLoopModeTypeID = _kCFRuntimeNotATypeID;
 
 struct __CFRunLoop {
     CFRuntimeBase _base;
-    CFSpinLock_t _lock; // locked for accessing mode list
+    CFLock_t _lock; // locked for accessing mode list
     CFRunLoopPortRef _wakeUpPort; // used for CFRunLoopWakeUp
+    __CFRunLoopSourceLink* volatile _signalledSources; // lock-free LIFO, pushed by CFRunLoopSourceSignal
+    __CFRunLoopSourceLink* _pendingSources; // signalled, but not in the current mode; guarded by _lock
+    __CFRunLoopFunctionNode* volatile _functions; // lock-free LIFO, pushed by CFRunLoopPerformFunction
+    __CFRunLoopFunctionQueue _commonFunctions; // functions for kCFRunLoopCommonModes
+    uint64_t _functionOrder; // guarded by _lock
+    void* _asyncFileQueue; // owned by CFAsyncFile, accessed only by the run loop thread
+    __CFRunLoopStatistics* volatile _statistics; // created when enabled for the first time
     volatile uint32_t* _stopped;
     CFMutableSetRef _commonModes;
     CFMutableSetRef _commonModeItems;
@@ -79,11 +103,6 @@ struct __CFRunLoop {
     CFMutableDictionaryRef _modes;
 };
 
-typedef struct {
-    CFMutableArrayRef results;
-    int64_t cutoffTSR;
-} __CFRunLoopTimersToFireContext;
-
 
 /* Bit 0 of CF_INFO is used for stopped state */
 /* Bit 1 of the base reserved bits is used for sleeping state */
@@ -94,7 +113,7 @@ typedef struct {
 
 
 static CFMutableDictionaryRef __CFRunLoops = NULL;
-static CFSpinLock_t __CFRunLoopsLock = CFSpinLockInit;
+static CFLock_t __CFRunLoopsLock = CFLockInit;
 
 // If this is called on a non-main thread, and the main thread pthread_t is passed in,
 // and this has not yet beed called on the main thread (since the last fork(), this will
@@ -102,11 +121,6 @@ static CFSpinLock_t __CFRunLoopsLock = CFSpinLockInit;
 // main thread run loop. There's nothing much we can do about that, without a call to
 // fetch the main thread's pthread_t from the pthreads subsystem.
 
-struct _findsource {
-    CFRunLoopPortRef port;
-    CFRunLoopSourceRef result;
-};
-
 typedef struct ___CFThreadID* __CFThreadID;
 static __CFThreadID __CFMainThreadID;
 
@@ -117,10 +131,10 @@ CF_INLINE __CFThreadID __CFGetCurrentThreadID(void) {
 }
 
 CF_INLINE void __CFRunLoopModeLock(CFRunLoopModeRef rlm) {
-    CFSpinLock(&rlm->_lock);
+    CFLock(&rlm->_lock);
 }
 CF_INLINE void __CFRunLoopModeUnlock(CFRunLoopModeRef rlm) {
-    CFSpinUnlock(&rlm->_lock);
+    CFUnlock(&rlm->_lock);
 }
 
 CF_INLINE Boolean __CFRunLoopIsStopped(CFRunLoopRef rl) {
@@ -154,11 +168,25 @@ CF_INLINE void __CFRunLoopSetDeallocating(CFRunLoopRef rl) {
     _CFBitfieldSetValue(CF_INFO(rl), 2, 2, 1);
 }
 
+/* Returns NULL unless statistics are enabled. */
+CF_INLINE __CFRunLoopStatistics* __CFRunLoopGetStatistics(CFRunLoopRef rl) {
+    __CFRunLoopStatistics* stats = rl->_statistics;
+    return (stats && __CFRunLoopStatisticsIsEnabled(stats)) ? stats : NULL;
+}
+
+/* Drops statistics of the object removed from the mode. */
+CF_INLINE void __CFRunLoopForgetStatistics(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTypeRef object) {
+    __CFRunLoopStatistics* stats = rl->_statistics;
+    if (stats) {
+        __CFRunLoopStatisticsForgetObject(stats, rlm->_name, object);
+    }
+}
+
 CF_INLINE void __CFRunLoopLock(CFRunLoopRef rl) {
-    CFSpinLock(&rl->_lock);
+    CFLock(&rl->_lock);
 }
 CF_INLINE void __CFRunLoopUnlock(CFRunLoopRef rl) {
-    CFSpinUnlock(&rl->_lock);
+    CFUnlock(&rl->_lock);
 }
 
 /* call with rl locked; returns mode locked */
@@ -181,15 +209,26 @@ static CFRunLoopModeRef __CFRunLoopFindMode(CFRunLoopRef rl, CFStringRef modeNam
     if (!rlm) {
         return NULL;
     }
-    rlm->_lock = CFSpinLockInit;
+    rlm->_lock = CFLockInit;
     rlm->_name = CFStringCreateCopy(CFGetAllocator(rlm), modeName);
     rlm->_stopped = false;
     rlm->_sources = NULL;
     rlm->_observers = NULL;
-    rlm->_timers = NULL;
+    __CFRunLoopTimerHeapInit(&rlm->_timers, CFRunLoopPortCreateTimer(kCFAllocatorSystemDefault));
     rlm->_submodes = NULL;
-    rlm->_portSet = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
-    CFArrayAppendValue(rlm->_portSet, rl->_wakeUpPort);
+    rlm->_portSet = CFRunLoopPortSetCreate(kCFAllocatorSystemDefault);
+    if (!rlm->_portSet) {
+        CF_GENERIC_ERROR("Failed to create port set.");
+    }
+    if (!CFRunLoopPortSetAddPort(rlm->_portSet, rl->_wakeUpPort)) {
+        CF_GENERIC_ERROR("Failed to add wake up port to mode %@.", modeName);
+    }
+    rlm->_portSources = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, NULL);
+    rlm->_functions.head = NULL;
+    rlm->_functions.tail = &rlm->_functions.head;
+    if (rlm->_timers.port && !CFRunLoopPortSetAddPort(rlm->_portSet, rlm->_timers.port)) {
+        CF_GENERIC_ERROR("Failed to add timer port to mode %@.", modeName);
+    }
     CFDictionaryAddValue(rl->_modes, modeName, rlm);
     CFRelease(rlm);
     __CFRunLoopModeLock(rlm); /* return mode locked */
@@ -204,7 +243,7 @@ static Boolean __CFRunLoopModeIsEmpty(CFRunLoopRef rl, CFRunLoopModeRef rlm) {
     if (rlm->_sources && 0 < CFSetGetCount(rlm->_sources)) {
         return false;
     }
-    if (rlm->_timers && 0 < CFSetGetCount(rlm->_timers)) {
+    if (0 < __CFRunLoopTimerHeapGetCount(&rlm->_timers)) {
         return false;
     }
     if (rlm->_submodes) {
@@ -227,7 +266,7 @@ static Boolean __CFRunLoopModeIsEmpty(CFRunLoopRef rl, CFRunLoopModeRef rlm) {
 }
 
 // rl is locked, rlm is locked on entry and exit
-static void __CFRunLoopModeAddPortsToPortSet(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFMutableArrayRef portSet) {
+static void __CFRunLoopModeAddPortsToPortSet(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLoopPortSetRef portSet) {
     CFIndex idx, cnt;
     const void** list, * buffer[256];
 
@@ -240,7 +279,7 @@ static void __CFRunLoopModeAddPortsToPortSet(CFRunLoopRef rl, CFRunLoopModeRef r
             CFRunLoopSourceRef rls = (CFRunLoopSourceRef)list[idx];
             CFRunLoopPortRef port = __CFRunLoopSourceGetPort(rls);
             if (port) {
-                CFArrayAppendValue(portSet, port);
+                CFRunLoopPortSetAddPort(portSet, port);
             }
         }
         if (list != buffer) {
@@ -259,45 +298,35 @@ static void __CFRunLoopModeAddPortsToPortSet(CFRunLoopRef rl, CFRunLoopModeRef r
     }
 }
 
-static CFArrayRef __CFRunLoopModeCollectWaitSet(CFRunLoopRef rl, CFRunLoopModeRef rlm) {
+/* Modes without submodes are waited on using their persistent port
+ *  set, which is updated by _CFRunLoopModeAddPort/_CFRunLoopModeRemovePort.
+ * For modes with submodes temporary port set is collected.
+ * Returned port set must be released.
+ */
+static CFRunLoopPortSetRef __CFRunLoopModeCopyWaitSet(CFRunLoopRef rl, CFRunLoopModeRef rlm) {
     if (rlm->_submodes) {
-        CFMutableArrayRef waitSet = CFArrayCreateMutable(
-                kCFAllocatorSystemDefault,
-                0,
-                &kCFTypeArrayCallBacks);
-        __CFRunLoopModeUnlock(rlm);
+        CFRunLoopPortSetRef waitSet = CFRunLoopPortSetCreate(kCFAllocatorSystemDefault);
+        if (!waitSet) {
+            return NULL;
+        }
+        if (!CFRunLoopPortSetAddPort(waitSet, rl->_wakeUpPort)) {
+            CFRelease(waitSet);
+            return NULL;
+        }
         __CFRunLoopLock(rl);
         __CFRunLoopModeLock(rlm);
         __CFRunLoopModeAddPortsToPortSet(rl, rlm, waitSet);
+        __CFRunLoopModeUnlock(rlm);
         __CFRunLoopUnlock(rl);
         return waitSet;
     } else {
-        return CFArrayCreateCopy(CFGetAllocator(rlm->_portSet), rlm->_portSet);
+        return (CFRunLoopPortSetRef)CFRetain(rlm->_portSet);
     }
 }
 
 static void __CFRunLoopDeallocateTimers(const void* key, const void* value, void* context) {
     CFRunLoopModeRef rlm = (CFRunLoopModeRef)value;
-    CFRunLoopRef rl = (CFRunLoopRef)context;
-    CFIndex idx, cnt;
-    const void** list, * buffer[256];
-    if (!rlm->_timers) {
-        return;
-    }
-    cnt = CFSetGetCount(rlm->_timers);
-    list = (cnt <= 256) ? buffer : (const void**)CFAllocatorAllocate(kCFAllocatorSystemDefault, cnt * sizeof(void*), 0);
-    CFSetGetValues(rlm->_timers, list);
-    for (idx = 0; idx < cnt; idx++) {
-        CFRetain(list[idx]);
-    }
-    CFSetRemoveAllValues(rlm->_timers);
-    for (idx = 0; idx < cnt; idx++) {
-        //__CFRunLoopTimerCancel((CFRunLoopTimerRef)list[idx],rl,rlm);
-        CFRelease(list[idx]);
-    }
-    if (list != buffer) {
-        CFAllocatorDeallocate(kCFAllocatorSystemDefault, list);
-    }
+    __CFRunLoopTimerHeapRemoveAll(&rlm->_timers);
 }
 
 static void __CFRunLoopDeallocateSources(const void* key, const void* value, void* context) {
@@ -358,11 +387,19 @@ static CFRunLoopRef __CFRunLoopCreate(void) {
         return NULL;
     }
     loop->_stopped = NULL;
-    loop->_lock = CFSpinLockInit;
+    loop->_lock = CFLockInit;
     loop->_wakeUpPort = CFRunLoopPortCreate(CFGetAllocator(loop));
     if (!loop->_wakeUpPort) {
         CF_GENERIC_ERROR("Failed to create wakeup port.");
     }
+    loop->_signalledSources = NULL;
+    loop->_pendingSources = NULL;
+    loop->_functions = NULL;
+    loop->_commonFunctions.head = NULL;
+    loop->_commonFunctions.tail = &loop->_commonFunctions.head;
+    loop->_functionOrder = 0;
+    loop->_asyncFileQueue = NULL;
+    loop->_statistics = NULL;
     loop->_commonModes = CFSetCreateMutable(CFGetAllocator(loop), 0, &kCFTypeSetCallBacks);
     CFSetAddValue(loop->_commonModes, kCFRunLoopDefaultMode);
     loop->_commonModeItems = NULL;
@@ -421,24 +458,10 @@ static void __CFRunLoopRemoveItemFromCommonModes(const void* value, void* ctx) {
     }
 }
 
-static void __CFRunLoopFindSource(const void* value, void* ctx) {
-    CFRunLoopSourceRef rls = (CFRunLoopSourceRef)value;
-    struct _findsource* context = (struct _findsource*)ctx;
-    if (context->result) {
-        return;
-    }
-    if (__CFRunLoopSourceGetPort(rls) == context->port) {
-        context->result = rls;
-    }
-}
-
 // call with rl and rlm locked
-static CFRunLoopSourceRef __CFRunLoopModeFindSourceForPort(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLoopPortRef port) {    /* DOES CALLOUT */
-    struct _findsource context = {port, NULL};
-    if (rlm->_sources) {
-        CFSetApplyFunction(rlm->_sources, (__CFRunLoopFindSource), &context);
-    }
-    if (!context.result && rlm->_submodes) {
+static CFRunLoopSourceRef __CFRunLoopModeFindSourceForPort(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLoopPortRef port) {
+    CFRunLoopSourceRef result = (CFRunLoopSourceRef)CFDictionaryGetValue(rlm->_portSources, port);
+    if (!result && rlm->_submodes) {
         CFIndex idx, cnt;
         for (idx = 0, cnt = CFArrayGetCount(rlm->_submodes); idx < cnt; idx++) {
             CFRunLoopSourceRef source = NULL;
@@ -450,12 +473,12 @@ static CFRunLoopSourceRef __CFRunLoopModeFindSourceForPort(CFRunLoopRef rl, CFRu
                 __CFRunLoopModeUnlock(subrlm);
             }
             if (source) {
-                context.result = source;
+                result = source;
                 break;
             }
         }
     }
-    return context.result;
+    return result;
 }
 
 /* rl is unlocked, rlm is locked on entrance and exit */
@@ -491,7 +514,12 @@ static void __CFRunLoopDoObservers(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunL
             for (idx = 0; idx < cnt; idx++) {
                 CFRunLoopObserverRef rlo = collectedObservers[idx];
                 if (rlo) {
+                    __CFRunLoopStatistics* stats = __CFRunLoopGetStatistics(rl);
+                    int64_t startTSR = stats ? _CFReadTSR() : 0;
                     _CFRunLoopObserverFire(activity, rlo);
+                    if (stats) {
+                        __CFRunLoopStatisticsRecordCallout(stats, rlo, startTSR);
+                    }
                     CFRelease(rlo);
                 }
             }
@@ -520,148 +548,409 @@ static void __CFRunLoopDoObservers(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunL
     }
 }
 
-static void __CFRunLoopCollectSources0(const void* value, void* context) {
-    CFRunLoopSourceRef rls = (CFRunLoopSourceRef)value;
-    CFTypeRef* sources = (CFTypeRef*)context;
-    if (_CFRunLoopSource0IsSignalled(rls)) {
-        if (!*sources) {
-            *sources = CFRetain(rls);
-        } else if (CFGetTypeID(*sources) == CFRunLoopSourceGetTypeID()) {
-            CFTypeRef oldrls = *sources;
-            *sources = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
-            CFArrayAppendValue((CFMutableArrayRef) * sources, oldrls);
-            CFArrayAppendValue((CFMutableArrayRef) * sources, rls);
-            CFRelease(oldrls);
+/* Takes all links from the signalled sources queue, returns them in
+ *  the order they were pushed.
+ */
+static __CFRunLoopSourceLink* __CFRunLoopTakeSignalledSources(CFRunLoopRef rl) {
+    __CFRunLoopSourceLink* head;
+    __CFRunLoopSourceLink* reversed = NULL;
+    do {
+        head = rl->_signalledSources;
+    } while (head && !OSAtomicCompareAndSwapPtrBarrier(head, NULL, (void* volatile*)&rl->_signalledSources));
+    while (head) {
+        __CFRunLoopSourceLink* next = head->next;
+        head->next = reversed;
+        reversed = head;
+        head = next;
+    }
+    return reversed;
+}
+
+/* Marks link as no longer queued. After that the link can be queued
+ *  again by CFRunLoopSourceSignal, so 'next' must not be used. Caller
+ *  is responsible for releasing the source.
+ */
+CF_INLINE void __CFRunLoopUnqueueSourceLink(__CFRunLoopSourceLink* link) {
+    link->next = NULL;
+    OSAtomicCompareAndSwap32Barrier(1, 0, &link->queued);
+}
+
+static void __CFRunLoopReleaseSourceLinks(__CFRunLoopSourceLink* link) {
+    while (link) {
+        __CFRunLoopSourceLink* next = link->next;
+        CFRunLoopSourceRef rls = link->source;
+        __CFRunLoopUnqueueSourceLink(link);
+        CFRelease(rls);
+        link = next;
+    }
+}
+
+// rl and rlm must be locked
+static Boolean __CFRunLoopModeContainsSource(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLoopSourceRef rls) {
+    Boolean contains = (rlm->_sources && CFSetContainsValue(rlm->_sources, rls));
+    if (!contains && rlm->_submodes) {
+        CFIndex idx, cnt;
+        for (idx = 0, cnt = CFArrayGetCount(rlm->_submodes); !contains && idx < cnt; idx++) {
+            CFStringRef modeName = (CFStringRef)CFArrayGetValueAtIndex(rlm->_submodes, idx);
+            CFRunLoopModeRef subrlm = __CFRunLoopFindMode(rl, modeName, false);
+            if (subrlm) {
+                contains = __CFRunLoopModeContainsSource(rl, subrlm, rls);
+                __CFRunLoopModeUnlock(subrlm);
+            }
+        }
+    }
+    return contains;
+}
+
+/* Collects signalled sources of 'rlm' into a list ordered by source
+ *  order (FIFO within the same order). Sources from other modes are
+ *  kept pending, sources that are no longer signalled are dropped.
+ * rl and rlm must be locked.
+ */
+static __CFRunLoopSourceLink* __CFRunLoopCollectSources0(CFRunLoopRef rl, CFRunLoopModeRef rlm) {
+    __CFRunLoopSourceLink* link;
+    __CFRunLoopSourceLink* ready = NULL;
+    __CFRunLoopSourceLink* readyTail = NULL;
+    __CFRunLoopSourceLink** pendingTail = &rl->_pendingSources;
+
+    // Append new links to the pending ones
+    while (*pendingTail) {
+        pendingTail = &(*pendingTail)->next;
+    }
+    *pendingTail = __CFRunLoopTakeSignalledSources(rl);
+
+    link = rl->_pendingSources;
+    pendingTail = &rl->_pendingSources;
+    while (link) {
+        __CFRunLoopSourceLink* next = link->next;
+        link->next = NULL;
+        if (link->runLoop != rl) {
+            // Source was removed from all modes of 'rl'
+            __CFRunLoopReleaseSourceLinks(link);
+        } else if (!_CFRunLoopSource0IsSignalled(link->source)) {
+            CFRunLoopSourceRef rls = link->source;
+            __CFRunLoopUnqueueSourceLink(link);
+            // Source could be signalled before the link was unqueued
+            if (_CFRunLoopSource0IsSignalled(rls)) {
+                _CFRunLoopEnqueueSource0(rl, link);
+            }
+            CFRelease(rls);
+        } else if (!__CFRunLoopModeContainsSource(rl, rlm, link->source)) {
+            *pendingTail = link;
+            pendingTail = &link->next;
+        } else if (!readyTail || readyTail->order <= link->order) {
+            // Common case: same order, append to the last bucket
+            if (readyTail) {
+                readyTail->next = link;
+            } else {
+                ready = link;
+            }
+            readyTail = link;
         } else {
-            CFArrayAppendValue((CFMutableArrayRef) * sources, rls);
+            __CFRunLoopSourceLink** position = &ready;
+            while ((*position)->order <= link->order) {
+                position = &(*position)->next;
+            }
+            link->next = *position;
+            *position = link;
         }
+        link = next;
     }
+    *pendingTail = NULL;
+    return ready;
 }
 
 /* rl is unlocked, rlm is locked on entrance and exit */
 static Boolean __CFRunLoopDoSources0(CFRunLoopRef rl, CFRunLoopModeRef rlm, Boolean stopAfterHandle) {    /* DOES CALLOUT */
-    CFTypeRef sources = NULL;
+    __CFRunLoopSourceLink* sources;
     Boolean sourceHandled = false;
-    CFIndex idx, cnt;
+
+    if (!rl->_signalledSources && !rl->_pendingSources) {
+        return false;
+    }
 
     __CFRunLoopModeUnlock(rlm); // locks have to be taken in order
     __CFRunLoopLock(rl);
     __CFRunLoopModeLock(rlm);
-    /* Fire the version 0 sources */
-    if (rlm->_sources && 0 < CFSetGetCount(rlm->_sources)) {
-        CFSetApplyFunction(rlm->_sources, (__CFRunLoopCollectSources0), &sources);
-    }
-    for (idx = 0, cnt = (rlm->_submodes) ? CFArrayGetCount(rlm->_submodes) : 0; idx < cnt; idx++) {
-        CFStringRef modeName = (CFStringRef)CFArrayGetValueAtIndex(rlm->_submodes, idx);
-        CFRunLoopModeRef subrlm;
-        subrlm = __CFRunLoopFindMode(rl, modeName, false);
-        if (subrlm) {
-            if (subrlm->_sources && 0 < CFSetGetCount(subrlm->_sources)) {
-                CFSetApplyFunction(subrlm->_sources, (__CFRunLoopCollectSources0), &sources);
-            }
-            __CFRunLoopModeUnlock(subrlm);
-        }
-    }
+    sources = __CFRunLoopCollectSources0(rl, rlm);
     __CFRunLoopUnlock(rl);
     if (sources) {
-        // sources is either a single (retained) CFRunLoopSourceRef or an array of (retained) CFRunLoopSourceRef
         __CFRunLoopModeUnlock(rlm);
-        if (CFGetTypeID(sources) == CFRunLoopSourceGetTypeID()) {
-            CFRunLoopSourceRef rls = (CFRunLoopSourceRef)sources;
-            sourceHandled = _CFRunLoopSource0Perform(rls);
-        } else {
-            cnt = CFArrayGetCount((CFArrayRef)sources);
-            CFArraySortValues((CFMutableArrayRef)sources, CFRangeMake(0, cnt), (__CFRunLoopSourceComparator), NULL);
-            for (idx = 0; idx < cnt; idx++) {
-                CFRunLoopSourceRef rls = (CFRunLoopSourceRef)CFArrayGetValueAtIndex((CFArrayRef)sources, idx);
+        while (sources) {
+            __CFRunLoopSourceLink* link = sources;
+            CFRunLoopSourceRef rls = link->source;
+            sources = link->next;
+            // Unqueue before performing, so that signal from the callout
+            //  queues the source again.
+            __CFRunLoopUnqueueSourceLink(link);
+            // Source can be performed by another loop
+            if (_CFRunLoopSource0IsSignalled(rls)) {
+                __CFRunLoopStatistics* stats = __CFRunLoopGetStatistics(rl);
+                int64_t startTSR = stats ? _CFReadTSR() : 0;
                 sourceHandled = _CFRunLoopSource0Perform(rls);
-                if (stopAfterHandle && sourceHandled) {
-                    break;
+                if (stats) {
+                    __CFRunLoopStatisticsRecordCallout(stats, rls, startTSR);
                 }
             }
+            CFRelease(rls);
+            if (stopAfterHandle && sourceHandled) {
+                break;
+            }
+        }
+        if (sources) {
+            // Put the rest back to be performed on the next pass
+            __CFRunLoopSourceLink* tail = sources;
+            __CFRunLoopLock(rl);
+            while (tail->next) {
+                tail = tail->next;
+            }
+            tail->next = rl->_pendingSources;
+            rl->_pendingSources = sources;
+            __CFRunLoopUnlock(rl);
         }
-        CFRelease(sources);
         __CFRunLoopModeLock(rlm);
     }
     return sourceHandled;
 }
 
+/* Takes all nodes from the function queue, returns them in the order
+ *  they were pushed.
+ */
+static __CFRunLoopFunctionNode* __CFRunLoopTakeFunctions(CFRunLoopRef rl) {
+    __CFRunLoopFunctionNode* head;
+    __CFRunLoopFunctionNode* reversed = NULL;
+    do {
+        head = rl->_functions;
+    } while (head && !OSAtomicCompareAndSwapPtrBarrier(head, NULL, (void* volatile*)&rl->_functions));
+    while (head) {
+        __CFRunLoopFunctionNode* next = head->next;
+        head->next = reversed;
+        reversed = head;
+        head = next;
+    }
+    return reversed;
+}
+
+static void __CFRunLoopFreeFunctionNodes(__CFRunLoopFunctionNode* node) {
+    while (node) {
+        __CFRunLoopFunctionNode* next = node->next;
+        CFRelease(node->modeName);
+        CFAllocatorDeallocate(kCFAllocatorSystemDefault, node);
+        node = next;
+    }
+}
+
+CF_INLINE void __CFRunLoopFunctionQueueAppend(__CFRunLoopFunctionQueue* queue, __CFRunLoopFunctionNode* node) {
+    node->next = NULL;
+    *queue->tail = node;
+    queue->tail = &node->next;
+}
+
+CF_INLINE __CFRunLoopFunctionNode* __CFRunLoopFunctionQueueTake(__CFRunLoopFunctionQueue* queue) {
+    __CFRunLoopFunctionNode* head = queue->head;
+    queue->head = NULL;
+    queue->tail = &queue->head;
+    return head;
+}
+
+/* Moves submitted functions to queues of their modes, so that each mode
+ *  looks only at its own functions. rl must be locked.
+ */
+static void __CFRunLoopDistributeFunctions(CFRunLoopRef rl, CFRunLoopModeRef rlm) {
+    __CFRunLoopFunctionNode* node = __CFRunLoopTakeFunctions(rl);
+    while (node) {
+        __CFRunLoopFunctionNode* next = node->next;
+        node->order = rl->_functionOrder++;
+        if (CFEqual(node->modeName, rlm->_name)) {
+            __CFRunLoopFunctionQueueAppend(&rlm->_functions, node);
+        } else if (CFEqual(node->modeName, kCFRunLoopCommonModes)) {
+            __CFRunLoopFunctionQueueAppend(&rl->_commonFunctions, node);
+        } else {
+            CFRunLoopModeRef nodeMode = __CFRunLoopFindMode(rl, node->modeName, true);
+            if (nodeMode) {
+                __CFRunLoopFunctionQueueAppend(&nodeMode->_functions, node);
+                __CFRunLoopModeUnlock(nodeMode);
+            } else {
+                // Mode can't be created, so the function would never run.
+                node->next = NULL;
+                __CFRunLoopFreeFunctionNodes(node);
+            }
+        }
+        node = next;
+    }
+}
+
+/* rl is unlocked, rlm is locked on entrance and exit */
+static Boolean __CFRunLoopDoFunctions(CFRunLoopRef rl, CFRunLoopModeRef rlm) {   /* DOES CALLOUT */
+    __CFRunLoopFunctionNode* node;
+    __CFRunLoopFunctionNode* functions;
+    __CFRunLoopFunctionNode* common = NULL;
+    __CFRunLoopFunctionNode** functionsTail;
+
+    if (!rl->_functions && !rlm->_functions.head && !rl->_commonFunctions.head) {
+        return false;
+    }
+
+    __CFRunLoopModeUnlock(rlm); // locks have to be taken in order
+    __CFRunLoopLock(rl);
+    __CFRunLoopDistributeFunctions(rl, rlm);
+    functions = __CFRunLoopFunctionQueueTake(&rlm->_functions);
+    if (rl->_commonModes && CFSetContainsValue(rl->_commonModes, rlm->_name)) {
+        common = __CFRunLoopFunctionQueueTake(&rl->_commonFunctions);
+    }
+    __CFRunLoopUnlock(rl);
+
+    // Merge common mode functions in, keeping the submission order.
+    functionsTail = &functions;
+    while (common) {
+        if (!*functionsTail || common->order < (*functionsTail)->order) {
+            __CFRunLoopFunctionNode* next = common->next;
+            common->next = *functionsTail;
+            *functionsTail = common;
+            common = next;
+        }
+        functionsTail = &(*functionsTail)->next;
+    }
+
+    for (node = functions; node; node = node->next) {
+        __CFRunLoopStatistics* stats = __CFRunLoopGetStatistics(rl);
+        int64_t startTSR = stats ? _CFReadTSR() : 0;
+        node->function(node->context); /* CALLOUT */
+        if (stats) {
+            __CFRunLoopStatisticsRecordCallout(stats, NULL, startTSR);
+        }
+    }
+    __CFRunLoopFreeFunctionNodes(functions);
+    __CFRunLoopModeLock(rlm);
+    return (functions != NULL);
+}
+
 static Boolean __CFRunLoopDoSource1(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLoopSourceRef rls) {    /* DOES CALLOUT */
     Boolean sourceHandled = false;
+    __CFRunLoopStatistics* stats;
+    int64_t startTSR;
 
     /* Fire a version 1 source */
     CFRetain(rls);
     __CFRunLoopModeUnlock(rlm);
 
+    stats = __CFRunLoopGetStatistics(rl);
+    startTSR = stats ? _CFReadTSR() : 0;
     sourceHandled = _CFRunLoopSource1Perform(rls);
+    if (stats) {
+        __CFRunLoopStatisticsRecordCallout(stats, rls, startTSR);
+    }
 
     CFRelease(rls);
     __CFRunLoopModeLock(rlm);
     return sourceHandled;
 }
 
-static void __CFRunLoopGetNextTimerFireTSRIterator(CFRunLoopTimerRef rlt, void* context) {
-    int64_t* fireTSR = (int64_t*)context;
-    if (__CFIsValid(rlt)) {
-        int64_t timerFireTSR = __CFRunLoopTimerGetFireTSR(rlt);
-        if (!*fireTSR || *fireTSR > timerFireTSR) {
-            *fireTSR = timerFireTSR;
+/* Returns fire TSR of the timer which fires next in 'rlm' (and its submodes), or,
+ *  if 'wakeup' is true, TSR to wake up at to fire timers within their
+ *  tolerance. rl and rlm must be locked.
+ */
+static int64_t __CFRunLoopGetNextTimerFireTSR(CFRunLoopRef rl, CFRunLoopModeRef rlm, Boolean wakeup) {
+    int64_t fireTSR = wakeup ?
+        __CFRunLoopTimerHeapGetWakeupTSR(&rlm->_timers) :
+        __CFRunLoopTimerHeapGetNextFireTSR(&rlm->_timers);
+    if (rlm->_submodes) {
+        CFIndex idx, cnt;
+        for (idx = 0, cnt = CFArrayGetCount(rlm->_submodes); idx < cnt; idx++) {
+            CFStringRef modeName = (CFStringRef)CFArrayGetValueAtIndex(rlm->_submodes, idx);
+            CFRunLoopModeRef subrlm = __CFRunLoopFindMode(rl, modeName, false);
+            if (subrlm) {
+                int64_t subFireTSR = __CFRunLoopGetNextTimerFireTSR(rl, subrlm, wakeup);
+                if (subFireTSR && (!fireTSR || subFireTSR < fireTSR)) {
+                    fireTSR = subFireTSR;
+                }
+                __CFRunLoopModeUnlock(subrlm);
+            }
         }
     }
+    return fireTSR;
 }
 
-static int64_t __CFRunLoopGetNextTimerFireTSR(CFRunLoopRef rl, CFRunLoopModeRef rlm) {
-    int64_t fireTime = 0;
-    __CFRunLoopModeIterateTimers(rl, rlm, __CFRunLoopGetNextTimerFireTSRIterator, &fireTime);
-    return fireTime;
-}
-
-
-static void __CFRunLoopTimersToFireIterator(CFRunLoopTimerRef rlt, void* ctx) {
-    __CFRunLoopTimersToFireContext* context = (__CFRunLoopTimersToFireContext*)ctx;
-    int64_t fireTSR = __CFRunLoopTimerGetFireTSR(rlt);
-    if (fireTSR <= context->cutoffTSR) {
-        if (!context->results) {
-            context->results = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+/* Returns number of timers in 'rlm' (and its submodes) that are due at
+ *  'cutoffTSR'. Stores up to 'capacity' of them (retained) to 'timers'.
+ * rl and rlm must be locked.
+ */
+static CFIndex __CFRunLoopCopyDueTimers(CFRunLoopRef rl, CFRunLoopModeRef rlm, int64_t cutoffTSR, CFRunLoopTimerRef* timers, CFIndex capacity) {
+    CFIndex count = __CFRunLoopTimerHeapCopyDueTimers(&rlm->_timers, cutoffTSR, timers, capacity);
+    if (rlm->_submodes) {
+        CFIndex idx, cnt;
+        for (idx = 0, cnt = CFArrayGetCount(rlm->_submodes); idx < cnt; idx++) {
+            CFStringRef modeName = (CFStringRef)CFArrayGetValueAtIndex(rlm->_submodes, idx);
+            CFRunLoopModeRef subrlm = __CFRunLoopFindMode(rl, modeName, false);
+            if (subrlm) {
+                CFIndex stored = _CFMin(count, capacity);
+                count += __CFRunLoopCopyDueTimers(rl, subrlm, cutoffTSR, timers + stored, capacity - stored);
+                __CFRunLoopModeUnlock(subrlm);
+            }
         }
-        CFArrayAppendValue(context->results, rlt);
     }
+    return count;
 }
 
-// rl and rlm must be locked
-static CFArrayRef __CFRunLoopTimersToFire(CFRunLoopRef rl, CFRunLoopModeRef rlm) {
-    __CFRunLoopTimersToFireContext ctxt = {NULL, _CFReadTSR()};
-    __CFRunLoopModeIterateTimers(rl, rlm, __CFRunLoopTimersToFireIterator, &ctxt);
-    return ctxt.results;
-}
+/* Maximum number of ports handled per run loop iteration. */
+#define __kCFRunLoopMaxLivePorts 64
 
-
-static CFRunLoopPortRef __CFRunLoopWait(CFRunLoopRef rl, CFRunLoopModeRef rlm, int64_t termTSR) {
-    CFArrayRef waitSet = __CFRunLoopModeCollectWaitSet(rl, rlm);
+/* rl and rlm are unlocked; stores up to 'capacity' signalled ports
+ *  to 'livePorts' and returns their number, ports must be released.
+ */
+static CFIndex __CFRunLoopWait(CFRunLoopRef rl, CFRunLoopModeRef rlm, int64_t termTSR, CFRunLoopPortRef* livePorts, CFIndex capacity) {
+    CFRunLoopPortSetRef waitSet = __CFRunLoopModeCopyWaitSet(rl, rlm);
     CFTimeInterval timeout = 0;
     if (termTSR) {
-        int64_t nextStop = __CFRunLoopGetNextTimerFireTSR(rl, rlm);
+        int64_t tsr = _CFReadTSR();
+        int64_t nextStop;
+        __CFRunLoopLock(rl);
+        __CFRunLoopModeLock(rlm);
+        nextStop = __CFRunLoopGetNextTimerFireTSR(rl, rlm, true);
+        if (rlm->_timers.port && !rlm->_submodes && nextStop > tsr) {
+            // Timer port wakes us up, handle only wakeups that are already due.
+            nextStop = 0;
+        }
+        __CFRunLoopModeUnlock(rlm);
+        __CFRunLoopUnlock(rl);
         if (nextStop <= 0) {
             nextStop = termTSR;
         } else if (nextStop > termTSR) {
             nextStop = termTSR;
         }
-        int64_t tsr = _CFReadTSR();
         int64_t timeoutTSR = nextStop - tsr;
-        printf("Next stop: %I64d, TSR: %I64d, timeout: %I64d\n", nextStop, tsr, timeoutTSR);
         if (timeoutTSR < 0) {
             timeout = 0;
         } else {
             timeout = _CFTSRToTimeInterval(timeoutTSR);
         }
     }
-    CFRunLoopPortRef signalledPort = NULL;
-    CFIndex signalledIndex = 0;
-    if (CFRunLoopPortWait(waitSet, timeout, &signalledIndex) && signalledIndex != -1) {
-        signalledPort = (CFRunLoopPortRef)CFArrayGetValueAtIndex(waitSet, signalledIndex);
+    CFIndex count = 0;
+    if (waitSet) {
+        CFRunLoopPortSetWait(waitSet, timeout, livePorts, capacity, &count);
+        CFRelease(waitSet);
     }
-    CFRelease(waitSet);
-    return signalledPort;
+    return count;
+}
+
+/* Picks the most specific cause among ports returned by __CFRunLoopWait. */
+static CFRunLoopWakeUpCause __CFRunLoopGetWakeUpCause(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLoopPortRef* livePorts, CFIndex count) {
+    CFRunLoopWakeUpCause cause = kCFRunLoopWakeUpTimeout;
+    CFIndex i;
+    for (i = 0; i != count; ++i) {
+        if (livePorts[i] == rl->_wakeUpPort) {
+            if (cause == kCFRunLoopWakeUpTimeout) {
+                cause = kCFRunLoopWakeUpExplicit;
+            }
+        } else if (livePorts[i] == rlm->_timers.port) {
+            if (cause != kCFRunLoopWakeUpPort) {
+                cause = kCFRunLoopWakeUpTimer;
+            }
+        } else {
+            return kCFRunLoopWakeUpPort;
+        }
+    }
+    return cause;
 }
 
 /* rl is unlocked, rlm locked on entrance and exit */
@@ -687,16 +976,29 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
         poll = true;
     }
     for (;; ) {
-        CFArrayRef timersToCall = NULL;
-        CFRunLoopPortRef livePort = NULL;
+        CFRunLoopTimerRef timersBuffer[32];
+        CFRunLoopTimerRef* timersToCall = timersBuffer;
+        CFIndex timersCount;
+        CFRunLoopPortRef livePorts[__kCFRunLoopMaxLivePorts];
+        CFIndex livePortsCount;
         int32_t returnValue = 0;
         Boolean sourceHandledThisLoop = false;
+        __CFRunLoopIteration iteration;
+        __CFRunLoopStatistics* stats = __CFRunLoopGetStatistics(rl);
+
+        if (stats) {
+            __CFRunLoopStatisticsBeginIteration(stats, &iteration, rlm->_name);
+        }
 
         __CFRunLoopDoObservers(rl, rlm, kCFRunLoopBeforeTimers);
         __CFRunLoopDoObservers(rl, rlm, kCFRunLoopBeforeSources);
 
         sourceHandledThisLoop = __CFRunLoopDoSources0(rl, rlm, stopAfterHandle);
 
+        if (__CFRunLoopDoFunctions(rl, rlm)) {
+            sourceHandledThisLoop = true;
+        }
+
         if (sourceHandledThisLoop) {
             poll = true;
         }
@@ -707,7 +1009,23 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
         }
         __CFRunLoopModeUnlock(rlm);
 
-        livePort = __CFRunLoopWait(rl, rlm, poll ? 0 : termTSR);
+        if (!poll) {
+            // Releases queued by other threads for objects we own.
+            _CFRCRunLoopWillSleep(rl);
+        }
+
+        if (stats) {
+            __CFRunLoopStatisticsBeginSleep(stats);
+        }
+        livePortsCount = __CFRunLoopWait(rl, rlm, poll ? 0 : termTSR, livePorts, __kCFRunLoopMaxLivePorts);
+        if (stats) {
+            __CFRunLoopStatisticsEndSleep(stats, poll ?
+                kCFRunLoopWakeUpNone :
+                __CFRunLoopGetWakeUpCause(rl, rlm, livePorts, livePortsCount));
+        }
+        if (!poll) {
+            _CFRCRunLoopDidWakeUp();
+        }
 
         __CFRunLoopLock(rl);
         __CFRunLoopModeLock(rlm);
@@ -721,42 +1039,88 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
         __CFRunLoopLock(rl);
         __CFRunLoopModeLock(rlm);
 
-        timersToCall = __CFRunLoopTimersToFire(rl, rlm);
+        {
+            int64_t cutoffTSR = _CFReadTSR();
+            timersCount = __CFRunLoopCopyDueTimers(rl, rlm, cutoffTSR, timersBuffer, 32);
+            if (timersCount > 32) {
+                CFIndex i;
+                for (i = 0; i != 32; ++i) {
+                    CFRelease(timersBuffer[i]);
+                }
+                timersToCall = (CFRunLoopTimerRef*)CFAllocatorAllocate(
+                    kCFAllocatorSystemDefault, timersCount * sizeof(CFRunLoopTimerRef), 0);
+                timersCount = _CFMin(timersCount,
+                    __CFRunLoopCopyDueTimers(rl, rlm, cutoffTSR, timersToCall, timersCount));
+            }
+        }
 
-        if (!livePort) {
-            __CFRunLoopUnlock(rl);
-        } else if (livePort == rl->_wakeUpPort) {
-            __CFRunLoopUnlock(rl);
-            if (_LogCFRunLoop) {
-                CFLog(kCFLogLevelDebug, CFSTR("wakeupPort was signalled"));
+        if (livePortsCount) {
+            /* All signalled ports are handled, since waiting has already
+             *  reset them. Sources are retained, because callouts can
+             *  remove them from the mode.
+             */
+            CFRunLoopSourceRef liveSources[__kCFRunLoopMaxLivePorts];
+            CFIndex i, liveSourcesCount = 0;
+            for (i = 0; i != livePortsCount; ++i) {
+                CFRunLoopPortRef livePort = livePorts[i];
+                if (livePort == rl->_wakeUpPort) {
+                    if (_LogCFRunLoop) {
+                        CFLog(kCFLogLevelDebug, CFSTR("wakeupPort was signalled"));
+                    }
+                } else if (livePort != rlm->_timers.port) {
+                    CFRunLoopSourceRef rls = __CFRunLoopModeFindSourceForPort(rl, rlm, livePort);
+                    if (rls) {
+                        liveSources[liveSourcesCount++] = (CFRunLoopSourceRef)CFRetain(rls);
+                    }
+                }
             }
-        } else {
-            CFRunLoopSourceRef rls = __CFRunLoopModeFindSourceForPort(rl, rlm, livePort);
             __CFRunLoopUnlock(rl);
-            if (rls) {
+            for (i = 0; i != liveSourcesCount; ++i) {
                 if (_LogCFRunLoop) {
-                    CFLog(kCFLogLevelDebug, CFSTR("Source %@ was signalled"), rls);
+                    CFLog(kCFLogLevelDebug, CFSTR("Source %@ was signalled"), liveSources[i]);
                 }
-                if (__CFRunLoopDoSource1(rl, rlm, rls)) {
+                if (__CFRunLoopDoSource1(rl, rlm, liveSources[i])) {
                     sourceHandledThisLoop = true;
                 }
             }
+            __CFRunLoopModeUnlock(rlm);
+            for (i = 0; i != liveSourcesCount; ++i) {
+                CFRelease(liveSources[i]);
+            }
+            for (i = 0; i != livePortsCount; ++i) {
+                CFRelease(livePorts[i]);
+            }
+            __CFRunLoopModeLock(rlm);
+        } else {
+            __CFRunLoopUnlock(rl);
         }
 
-        if (timersToCall) {
+        if (timersCount) {
             CFIndex i;
-            for (i = CFArrayGetCount(timersToCall) - 1; i >= 0; i--) {
-                CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(timersToCall, i);
-                if (rlt) {
-                    __CFRunLoopModeUnlock(rlm);
-                    __CFRunLoopTimerFire(rl, rlt);
-                    __CFRunLoopModeLock(rlm);
+            __CFRunLoopModeUnlock(rlm);
+            for (i = 0; i != timersCount; ++i) {
+                int64_t startTSR = 0;
+                if (stats) {
+                    startTSR = _CFReadTSR();
+                    __CFRunLoopStatisticsRecordTimerLateness(
+                        stats, startTSR - __CFRunLoopTimerGetFireTSR(timersToCall[i]));
                 }
+                __CFRunLoopTimerFire(rl, timersToCall[i]);
+                if (stats) {
+                    __CFRunLoopStatisticsRecordCallout(stats, timersToCall[i], startTSR);
+                }
+                CFRelease(timersToCall[i]);
+            }
+            __CFRunLoopModeLock(rlm);
+            if (timersToCall != timersBuffer) {
+                CFAllocatorDeallocate(kCFAllocatorSystemDefault, timersToCall);
             }
-            CFRelease(timersToCall);
         }
 
         __CFRunLoopModeUnlock(rlm);     // locks must be taken in order
+        if (stats) {
+            __CFRunLoopStatisticsEndIteration(stats, rl);
+        }
         __CFRunLoopLock(rl);
         __CFRunLoopModeLock(rlm);
         if (sourceHandledThisLoop && stopAfterHandle) {
@@ -784,9 +1148,9 @@ static int32_t __CFRunLoopRun(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFTimeInter
 
 static CFRunLoopRef __CFRunLoopGetForThread(__CFThreadID thread) {
     CFRunLoopRef loop = NULL;
-    CFSpinLock(&__CFRunLoopsLock);
+    CFLock(&__CFRunLoopsLock);
     if (!__CFRunLoops) {
-        CFSpinUnlock(&__CFRunLoopsLock);
+        CFUnlock(&__CFRunLoopsLock);
         CFMutableDictionaryRef loops = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, NULL);
         CFRunLoopRef mainLoop = __CFRunLoopCreate();
         CFDictionarySetValue(loops, __CFMainThreadID, mainLoop);
@@ -794,13 +1158,13 @@ static CFRunLoopRef __CFRunLoopGetForThread(__CFThreadID thread) {
             CFRelease(loops);
             CFRelease(mainLoop);
         }
-        CFSpinLock(&__CFRunLoopsLock);
+        CFLock(&__CFRunLoopsLock);
     }
     loop = (CFRunLoopRef)CFDictionaryGetValue(__CFRunLoops, thread);
     if (!loop) {
-        CFSpinUnlock(&__CFRunLoopsLock);
+        CFUnlock(&__CFRunLoopsLock);
         CFRunLoopRef newLoop = __CFRunLoopCreate();
-        CFSpinLock(&__CFRunLoopsLock);
+        CFLock(&__CFRunLoopsLock);
         loop = (CFRunLoopRef)CFDictionaryGetValue(__CFRunLoops, thread);
         if (loop) {
             CFRelease(newLoop);
@@ -813,7 +1177,7 @@ static CFRunLoopRef __CFRunLoopGetForThread(__CFThreadID thread) {
         // Make sure run loop finalizer is registered.
         _CFGetThreadSpecificData();
     }
-    CFSpinUnlock(&__CFRunLoopsLock);
+    CFUnlock(&__CFRunLoopsLock);
     return loop;
 }
 
@@ -839,8 +1203,8 @@ static CFStringRef __CFRunLoopModeCopyDescription(CFTypeRef cf) {
         rlm, CFGetAllocator(rlm), rlm->_name);
     CFStringAppendFormat(
         result,
-        NULL, CFSTR("\n\tsources = %@,\n\tobservers = %@,\n\ttimers = %@\n},\n"),
-        rlm->_sources, rlm->_observers, rlm->_timers);
+        NULL, CFSTR("\n\tsources = %@,\n\tobservers = %@,\n\ttimers = %d\n},\n"),
+        rlm->_sources, rlm->_observers, (int)__CFRunLoopTimerHeapGetCount(&rlm->_timers));
     return result;
 }
 
@@ -852,14 +1216,14 @@ static void __CFRunLoopModeDeallocate(CFTypeRef cf) {
     if (rlm->_observers) {
         CFRelease(rlm->_observers);
     }
-    if (rlm->_timers) {
-        CFRelease(rlm->_timers);
-    }
+    __CFRunLoopTimerHeapDestroy(&rlm->_timers);
     if (rlm->_submodes) {
         CFRelease(rlm->_submodes);
     }
     CFRelease(rlm->_name);
     CFRelease(rlm->_portSet);
+    CFRelease(rlm->_portSources);
+    __CFRunLoopFreeFunctionNodes(rlm->_functions.head);
 }
 
 static const CFRuntimeClass __CFRunLoopModeClass = {
@@ -903,7 +1267,20 @@ static void __CFRunLoopDeallocate(CFTypeRef cf) {
         CFRelease(rl->_modes);
     }
     CFRelease(rl->_wakeUpPort);
+    __CFRunLoopReleaseSourceLinks(__CFRunLoopTakeSignalledSources(rl));
+    __CFRunLoopReleaseSourceLinks(rl->_pendingSources);
+    rl->_pendingSources = NULL;
+    __CFRunLoopFreeFunctionNodes(__CFRunLoopTakeFunctions(rl));
+    __CFRunLoopFreeFunctionNodes(__CFRunLoopFunctionQueueTake(&rl->_commonFunctions));
     __CFRunLoopUnlock(rl);
+    if (rl->_asyncFileQueue) {
+        _CFAsyncFileQueueDestroy(rl->_asyncFileQueue);
+        rl->_asyncFileQueue = NULL;
+    }
+    if (rl->_statistics) {
+        __CFRunLoopStatisticsDestroy(rl->_statistics);
+        rl->_statistics = NULL;
+    }
 }
 
 static CFStringRef __CFRunLoopCopyDescription(CFTypeRef cf) {
@@ -945,7 +1322,8 @@ CF_INTERNAL void _CFRunLoopInitialize(void) {
 }
 
 CF_INTERNAL void _CFFinalizeCurrentRunLoop(void) {
-    CFSpinLock(&__CFRunLoopsLock);
+    _CFThreadData._runLoop = NULL;
+    CFLock(&__CFRunLoopsLock);
     if (__CFRunLoops) {
         __CFThreadID threadID = __CFGetCurrentThreadID();
         if (threadID != __CFMainThreadID) {
@@ -956,53 +1334,84 @@ CF_INTERNAL void _CFFinalizeCurrentRunLoop(void) {
             }        
         }
     }
-    CFSpinUnlock(&__CFRunLoopsLock);
+    CFUnlock(&__CFRunLoopsLock);
 }
 
-CF_INTERNAL void __CFRunLoopModeIterateTimers(CFRunLoopRef rl, CFRunLoopModeRef rlm, __CFRunLoopModeTimerIterator iterator, void* context) {
-    if (rlm->_timers && CFSetGetCount(rlm->_timers)) {
-        CFSetApplyFunction(rlm->_timers, (CFSetApplierFunction)iterator, context);
-    }
-    if (rlm->_submodes) {
-        CFIndex idx, cnt;
-        for (idx = 0, cnt = CFArrayGetCount(rlm->_submodes); idx < cnt; idx++) {
-            CFStringRef modeName = (CFStringRef)CFArrayGetValueAtIndex(rlm->_submodes, idx);
-            CFRunLoopModeRef subrlm = __CFRunLoopFindMode(rl, modeName, false);
-            if (subrlm) {
-                __CFRunLoopModeIterateTimers(rl, subrlm, iterator, context);
-                __CFRunLoopModeUnlock(subrlm);
-            }
-        }
+CF_INTERNAL void* _CFRunLoopGetAsyncFileQueue(CFRunLoopRef rl) {
+    return rl->_asyncFileQueue;
+}
+
+CF_INTERNAL void _CFRunLoopSetAsyncFileQueue(CFRunLoopRef rl, void* queue) {
+    rl->_asyncFileQueue = queue;
+}
+
+/* Queues signalled version 0 source to be performed by 'rl', unless
+ *  it's already queued. Doesn't take any locks or allocate, and can be
+ *  called from any thread.
+ */
+CF_INTERNAL void _CFRunLoopEnqueueSource0(CFRunLoopRef rl, __CFRunLoopSourceLink* link) {
+    if (!OSAtomicCompareAndSwap32Barrier(0, 1, &link->queued)) {
+        return;
     }
+    CFRetain(link->source);
+    do {
+        link->next = rl->_signalledSources;
+    } while (!OSAtomicCompareAndSwapPtrBarrier(link->next, link, (void* volatile*)&rl->_signalledSources));
 }
 
-CF_INTERNAL void __CFRunLoopFindModeIterateTimers(CFRunLoopRef rl, CFStringRef modeName, __CFRunLoopModeTimerIterator iterator, void* context) {
-    CFRunLoopModeRef rlm;
+/* Removes queued links of the source which was removed from all modes
+ *  of 'rl'. Links that are being performed are dropped by the next
+ *  __CFRunLoopCollectSources0.
+ */
+CF_INTERNAL void _CFRunLoopDequeueSource0(CFRunLoopRef rl, CFRunLoopSourceRef rls) {
+    __CFRunLoopSourceLink* removed = NULL;
+    __CFRunLoopSourceLink** position;
+    __CFRunLoopSourceLink** pendingTail = &rl->_pendingSources;
+    if (!rl->_signalledSources && !rl->_pendingSources) {
+        return;
+    }
     __CFRunLoopLock(rl);
-    rlm = __CFRunLoopFindMode(rl, modeName, false);
-    __CFRunLoopUnlock(rl);
-    if (rlm) {
-        __CFRunLoopModeIterateTimers(rl, rlm, iterator, context);
-        __CFRunLoopModeUnlock(rlm);
+    while (*pendingTail) {
+        pendingTail = &(*pendingTail)->next;
+    }
+    *pendingTail = __CFRunLoopTakeSignalledSources(rl);
+    position = &rl->_pendingSources;
+    while (*position) {
+        __CFRunLoopSourceLink* link = *position;
+        if (link->source == rls && link->runLoop != rl) {
+            *position = link->next;
+            link->next = removed;
+            removed = link;
+        } else {
+            position = &link->next;
+        }
     }
+    __CFRunLoopUnlock(rl);
+    __CFRunLoopReleaseSourceLinks(removed);
 }
 
 CF_INTERNAL CFStringRef _CFRunLoopModeGetName(CFRunLoopModeRef rlm) {
     return rlm->_name;
 }
 
-CF_INTERNAL void _CFRunLoopModeAddPort(CFRunLoopModeRef rlm, CFRunLoopPortRef port) {
-    CFArrayAppendValue(rlm->_portSet, port);
+/* rlm is not locked */
+CF_INTERNAL void _CFRunLoopModeAddPort(CFRunLoopModeRef rlm, CFRunLoopPortRef port, CFRunLoopSourceRef rls) {
+    if (!CFRunLoopPortSetAddPort(rlm->_portSet, port)) {
+        CF_GENERIC_ERROR("Failed to add port %@ to mode %@.", port, rlm->_name);
+    }
+    __CFRunLoopModeLock(rlm);
+    CFDictionarySetValue(rlm->_portSources, port, rls);
+    __CFRunLoopModeUnlock(rlm);
 }
 
-CF_INTERNAL void _CFRunLoopModeRemovePort(CFRunLoopModeRef rlm, CFRunLoopPortRef port) {
-    CFIndex index = CFArrayGetFirstIndexOfValue(
-            rlm->_portSet,
-            CFRangeMake(0, CFArrayGetCount(rlm->_portSet)),
-            port);
-    if (index != kCFNotFound) {
-        CFArrayRemoveValueAtIndex(rlm->_portSet, index);
+/* rlm is not locked */
+CF_INTERNAL void _CFRunLoopModeRemovePort(CFRunLoopModeRef rlm, CFRunLoopPortRef port, CFRunLoopSourceRef rls) {
+    __CFRunLoopModeLock(rlm);
+    if (CFDictionaryGetValue(rlm->_portSources, port) == rls) {
+        CFDictionaryRemoveValue(rlm->_portSources, port);
     }
+    __CFRunLoopModeUnlock(rlm);
+    CFRunLoopPortSetRemovePort(rlm->_portSet, port);
 }
 
 ///////////////////////////////////////////////////////////////////// public
@@ -1019,7 +1428,13 @@ CFRunLoopRef CFRunLoopGetMain(void) {
 }
 
 CFRunLoopRef CFRunLoopGetCurrent(void) {
-    return __CFRunLoopGetForThread(__CFGetCurrentThreadID());
+    // Current run loop can't go away while the thread is alive (it's
+    //  removed by _CFFinalizeCurrentRunLoop() at exit), so it's cached.
+    _CFThreadSpecificData* tsd = _CFGetThreadSpecificData();
+    if (!tsd->_runLoop) {
+        tsd->_runLoop = __CFRunLoopGetForThread(__CFGetCurrentThreadID());
+    }
+    return tsd->_runLoop;
 }
 
 CFStringRef CFRunLoopCopyCurrentMode(CFRunLoopRef rl) {
@@ -1125,6 +1540,66 @@ void CFRunLoopStop(CFRunLoopRef rl) {
     CFRunLoopWakeUp(rl);
 }
 
+Boolean CFRunLoopPerformFunction(CFRunLoopRef rl, CFStringRef modeName, CFRunLoopPerformCallBack function, void* context) {
+    __CFRunLoopFunctionNode* node;
+    CF_VALIDATE_PTR_ARG(function);
+    node = (__CFRunLoopFunctionNode*)CFAllocatorAllocate(
+        kCFAllocatorSystemDefault, sizeof(__CFRunLoopFunctionNode), 0);
+    if (!node) {
+        return false;
+    }
+    node->modeName = (CFStringRef)CFRetain(modeName);
+    node->function = function;
+    node->context = context;
+    do {
+        node->next = rl->_functions;
+    } while (!OSAtomicCompareAndSwapPtrBarrier(node->next, node, (void* volatile*)&rl->_functions));
+    if (!node->next) {
+        // Queue was empty, so nobody woke the loop up yet. Subsequent
+        //  functions are picked up by the same wakeup.
+        CFRunLoopWakeUp(rl);
+    }
+    return true;
+}
+
+void CFRunLoopSetStatisticsEnabled(CFRunLoopRef rl, Boolean enabled) {
+    __CFRunLoopLock(rl);
+    if (!rl->_statistics && enabled) {
+        rl->_statistics = __CFRunLoopStatisticsCreate();
+    }
+    if (rl->_statistics) {
+        __CFRunLoopStatisticsSetEnabled(rl->_statistics, enabled);
+    }
+    __CFRunLoopUnlock(rl);
+}
+
+Boolean CFRunLoopIsStatisticsEnabled(CFRunLoopRef rl) {
+    return __CFRunLoopGetStatistics(rl) != NULL;
+}
+
+CFDictionaryRef CFRunLoopCopyStatistics(CFRunLoopRef rl) {
+    __CFRunLoopStatistics* stats = rl->_statistics;
+    return stats ? __CFRunLoopStatisticsCopy(stats) : NULL;
+}
+
+void CFRunLoopResetStatistics(CFRunLoopRef rl) {
+    __CFRunLoopStatistics* stats = rl->_statistics;
+    if (stats) {
+        __CFRunLoopStatisticsReset(stats);
+    }
+}
+
+void CFRunLoopSetStatisticsCallBack(CFRunLoopRef rl, CFRunLoopStatisticsCallBack callback, void* info) {
+    __CFRunLoopLock(rl);
+    if (!rl->_statistics) {
+        rl->_statistics = __CFRunLoopStatisticsCreate();
+    }
+    __CFRunLoopUnlock(rl);
+    if (rl->_statistics) {
+        __CFRunLoopStatisticsSetCallBack(rl->_statistics, callback, info);
+    }
+}
+
 Boolean CFRunLoopContainsSource(CFRunLoopRef rl, CFRunLoopSourceRef rls, CFStringRef modeName) {
     CFRunLoopModeRef rlm;
     Boolean hasValue = false;
@@ -1216,6 +1691,7 @@ void CFRunLoopRemoveSource(CFRunLoopRef rl, CFRunLoopSourceRef rls, CFStringRef
             CFSetRemoveValue(rlm->_sources, rls);
             __CFRunLoopModeUnlock(rlm);
             __CFRunLoopSourceCancel(rls, rl, rlm); /* DOES CALLOUT */
+            __CFRunLoopForgetStatistics(rl, rlm, rls);
             CFRelease(rls);
         } else if (rlm) {
             __CFRunLoopModeUnlock(rlm);
@@ -1310,6 +1786,7 @@ void CFRunLoopRemoveObserver(CFRunLoopRef rl, CFRunLoopObserverRef rlo, CFString
             CFSetRemoveValue(rlm->_observers, rlo);
             __CFRunLoopModeUnlock(rlm);
             __CFRunLoopObserverCancel(rlo, rl);
+            __CFRunLoopForgetStatistics(rl, rlm, rlo);
             CFRelease(rlo);
         } else if (rlm) {
             __CFRunLoopModeUnlock(rlm);
@@ -1329,10 +1806,8 @@ Boolean CFRunLoopContainsTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringR
     } else {
         rlm = __CFRunLoopFindMode(rl, modeName, false);
         __CFRunLoopUnlock(rl);
-        if (rlm && rlm->_timers) {
-            hasValue = CFSetContainsValue(rlm->_timers, rlt);
-            __CFRunLoopModeUnlock(rlm);
-        } else if (rlm) {
+        if (rlm) {
+            hasValue = __CFRunLoopTimerHeapContains(&rlm->_timers, rlt);
             __CFRunLoopModeUnlock(rlm);
         }
     }
@@ -1364,13 +1839,8 @@ void CFRunLoopAddTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringRef modeN
     } else {
         rlm = __CFRunLoopFindMode(rl, modeName, true);
         __CFRunLoopUnlock(rl);
-        if (rlm && !rlm->_timers) {
-            rlm->_timers = CFSetCreateMutable(CFGetAllocator(rlm), 0, &kCFTypeSetCallBacks);
-        }
-        if (rlm && !CFSetContainsValue(rlm->_timers, rlt)) {
-            CFSetAddValue(rlm->_timers, rlt);
-            __CFRunLoopModeUnlock(rlm);
-        } else if (rlm) {
+        if (rlm) {
+            __CFRunLoopTimerHeapAdd(&rlm->_timers, rlt);
             __CFRunLoopModeUnlock(rlm);
         }
     }
@@ -1396,20 +1866,26 @@ void CFRunLoopRemoveTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringRef mo
     } else {
         rlm = __CFRunLoopFindMode(rl, modeName, false);
         __CFRunLoopUnlock(rl);
-        if (rlm && rlm->_timers && CFSetContainsValue(rlm->_timers, rlt)) {
+        if (rlm) {
             CFRetain(rlt);
-            CFSetRemoveValue(rlm->_timers, rlt);
+            __CFRunLoopTimerHeapRemove(&rlm->_timers, rlt);
             __CFRunLoopModeUnlock(rlm);
+            __CFRunLoopForgetStatistics(rl, rlm, rlt);
             CFRelease(rlt);
-        } else if (rlm) {
-            __CFRunLoopModeUnlock(rlm);
         }
     }
 }
 
 CFAbsoluteTime CFRunLoopGetNextTimerFireDate(CFRunLoopRef rl, CFStringRef modeName) {
     int64_t fireTSR = 0;
-    __CFRunLoopFindModeIterateTimers(rl, modeName, __CFRunLoopGetNextTimerFireTSRIterator, &fireTSR);
+    CFRunLoopModeRef rlm;
+    __CFRunLoopLock(rl);
+    rlm = __CFRunLoopFindMode(rl, modeName, false);
+    if (rlm) {
+        fireTSR = __CFRunLoopGetNextTimerFireTSR(rl, rlm, false);
+        __CFRunLoopModeUnlock(rlm);
+    }
+    __CFRunLoopUnlock(rl);
     int64_t nowTSR = _CFReadTSR();
     CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
     return !fireTSR ? 0.0 : (now + _CFTSRToTimeInterval(fireTSR - nowTSR));
@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <CoreFoundation/CFRunLoopGroup.h>
+#include "CFInternal.h"
+#include "CFRunLoop_Common.h"
+#include <string.h>
+
+#define CF_VALIDATE_RUNLOOPGROUP_ARG(group) \
+    CF_VALIDATE_OBJECT_ARG(CF, group, __kCFRunLoopGroupTypeID)
+
+/* Load of a member run loop is tracked with two numbers:
+ *  - backlog, number of functions submitted through the group and not
+ *    yet performed;
+ *  - busy ratio, fraction of time spent between waking up and going to
+ *    sleep, averaged over recent iterations. It's updated by an
+ *    observer on the member thread, and read racily by other threads.
+ *    Iteration ends when the run loop goes to sleep, or, if it didn't
+ *    sleep, when the next iteration starts, so a run loop that is too
+ *    busy to sleep is seen as fully busy.
+ */
+
+typedef struct {
+    CFRunLoopGroupRef group; // not retained
+    pthread_t thread;
+    CFRunLoopRef runLoop; // retained
+    CFRunLoopObserverRef observer;
+    volatile int32_t backlog;
+    volatile int32_t busyPermille; // exponential moving average
+    int64_t wakeTSR; // start of the current busy period
+    int64_t sleepTSR; // end of the previous iteration
+    Boolean slept; // run loop slept since the iteration started
+} __CFRunLoopGroupMember;
+
+typedef struct {
+    __CFRunLoopGroupMember* member;
+    CFRunLoopPerformCallBack function;
+    void* context;
+} __CFRunLoopGroupCall;
+
+struct __CFRunLoopGroup {
+    CFRuntimeBase _base;
+    pthread_mutex_t _lock; // guards startup and invalidation
+    pthread_cond_t _startedCondition;
+    CFIndex _startedCount;
+    volatile int32_t _cursor; // round-robin position
+    volatile Boolean _stopping;
+    CFRunLoopSourceRef _keepAliveSource; // keeps run loops from finishing
+    CFIndex _count;
+    CFIndex _threadCount; // members with started threads, first in '_members'
+    __CFRunLoopGroupMember* _members;
+};
+
+static CFTypeID __kCFRunLoopGroupTypeID = _kCFRuntimeNotATypeID;
+
+/* Backlog that outweighs any busy ratio difference. */
+#define __kCFRunLoopGroupBacklogThreshold 16
+
+///////////////////////////////////////////////////////////////////// private
+
+static void __CFRunLoopGroupKeepAlivePerform(void* info) {
+}
+
+static void __CFRunLoopGroupStopCurrent(void* context) {
+    CFRunLoopStop(CFRunLoopGetCurrent());
+}
+
+static void __CFRunLoopGroupEndIteration(__CFRunLoopGroupMember* member, int64_t now) {
+    int64_t cycle = now - member->sleepTSR;
+    if (cycle > 0) {
+        int64_t busy = now - member->wakeTSR;
+        int32_t permille = (int32_t)((busy * 1000) / cycle);
+        member->busyPermille = (member->busyPermille * 7 + permille) / 8;
+    }
+    member->sleepTSR = now;
+}
+
+static void __CFRunLoopGroupObserve(CFRunLoopObserverRef observer, CFRunLoopActivity activity, void* info) {
+    __CFRunLoopGroupMember* member = (__CFRunLoopGroupMember*)info;
+    int64_t now = CFPlatformReadTSR();
+    if (activity == kCFRunLoopBeforeTimers) {
+        if (!member->slept) {
+            // Previous iteration didn't sleep.
+            __CFRunLoopGroupEndIteration(member, now);
+            member->wakeTSR = now;
+        }
+        member->slept = false;
+    } else if (activity == kCFRunLoopAfterWaiting) {
+        member->wakeTSR = now;
+        member->slept = true;
+    } else {
+        __CFRunLoopGroupEndIteration(member, now);
+    }
+}
+
+static void* __CFRunLoopGroupMain(void* arg) {
+    __CFRunLoopGroupMember* member = (__CFRunLoopGroupMember*)arg;
+    CFRunLoopGroupRef group = member->group;
+    CFRunLoopRef rl = CFRunLoopGetCurrent();
+
+    CFRunLoopAddSource(rl, group->_keepAliveSource, kCFRunLoopCommonModes);
+    CFRunLoopAddObserver(rl, member->observer, kCFRunLoopCommonModes);
+    member->wakeTSR = member->sleepTSR = CFPlatformReadTSR();
+    member->slept = true;
+
+    pthread_mutex_lock(&group->_lock);
+    member->runLoop = (CFRunLoopRef)CFRetain(rl);
+    group->_startedCount++;
+    pthread_cond_broadcast(&group->_startedCondition);
+    pthread_mutex_unlock(&group->_lock);
+
+    // Group is not accessed past this point: it may be deallocated by
+    //  a callout on this thread, see CFRunLoopGroupInvalidate().
+    while (true) {
+        SInt32 result = CFRunLoopRunInMode(kCFRunLoopDefaultMode, __CFRunLoopInfiniteWait, false);
+        if (result == kCFRunLoopRunStopped || result == kCFRunLoopRunFinished) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+CF_INLINE Boolean __CFRunLoopGroupIsLessLoaded(__CFRunLoopGroupMember* x, __CFRunLoopGroupMember* y, Boolean preferBacklog) {
+    int32_t backlogDelta = x->backlog - y->backlog;
+    if (preferBacklog || backlogDelta >= __kCFRunLoopGroupBacklogThreshold || backlogDelta <= -__kCFRunLoopGroupBacklogThreshold) {
+        if (backlogDelta) {
+            return backlogDelta < 0;
+        }
+    }
+    return x->busyPermille < y->busyPermille;
+}
+
+/* Functions are balanced by backlog first, long-living items (sources
+ *  and timers) by busy ratio, unless backlogs differ significantly.
+ */
+static __CFRunLoopGroupMember* __CFRunLoopGroupChooseMember(CFRunLoopGroupRef group, Boolean preferBacklog) {
+    uint32_t cursor = (uint32_t)OSAtomicIncrement32(&group->_cursor);
+    __CFRunLoopGroupMember* first = &group->_members[cursor % group->_count];
+    __CFRunLoopGroupMember* second = &group->_members[(cursor + 1) % group->_count];
+    return __CFRunLoopGroupIsLessLoaded(second, first, preferBacklog) ? second : first;
+}
+
+static void __CFRunLoopGroupPerformCall(void* info) {
+    __CFRunLoopGroupCall* call = (__CFRunLoopGroupCall*)info;
+    __CFRunLoopGroupMember* member = call->member;
+    CFRunLoopPerformCallBack function = call->function;
+    void* context = call->context;
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, call);
+    function(context); /* CALLOUT */
+    OSAtomicDecrement32(&member->backlog);
+}
+
+static Boolean __CFRunLoopGroupSubmit(__CFRunLoopGroupMember* member, CFStringRef mode, CFRunLoopPerformCallBack function, void* context) {
+    __CFRunLoopGroupCall* call = (__CFRunLoopGroupCall*)CFAllocatorAllocate(
+        kCFAllocatorSystemDefault, sizeof(__CFRunLoopGroupCall), 0);
+    if (!call) {
+        return false;
+    }
+    call->member = member;
+    call->function = function;
+    call->context = context;
+    OSAtomicIncrement32(&member->backlog);
+    if (!CFRunLoopPerformFunction(member->runLoop, mode, __CFRunLoopGroupPerformCall, call)) {
+        OSAtomicDecrement32(&member->backlog);
+        CFAllocatorDeallocate(kCFAllocatorSystemDefault, call);
+        return false;
+    }
+    return true;
+}
+
+/*** CFRunLoopGroup class ***/
+
+static CFStringRef __CFRunLoopGroupCopyDescription(CFTypeRef cf) {
+    CFRunLoopGroupRef group = (CFRunLoopGroupRef)cf;
+    CFMutableStringRef result;
+    CFIndex i;
+    result = CFStringCreateMutable(kCFAllocatorSystemDefault, 0);
+    CFStringAppendFormat(
+        result, NULL,
+        CFSTR("<CFRunLoopGroup %p [%p]>{valid = %s, count = %ld,\n"),
+        cf, CFGetAllocator(cf),
+        group->_stopping ? "No" : "Yes",
+        (long)group->_count);
+    for (i = 0; i < group->_count; i++) {
+        __CFRunLoopGroupMember* member = &group->_members[i];
+        CFStringAppendFormat(
+            result, NULL,
+            CFSTR("\t%ld : run loop = %p, backlog = %d, busy = %d.%d%%\n"),
+            (long)i, member->runLoop, (int)member->backlog,
+            member->busyPermille / 10, member->busyPermille % 10);
+    }
+    CFStringAppend(result, CFSTR("}"));
+    return result;
+}
+
+static void __CFRunLoopGroupDeallocate(CFTypeRef cf) {
+    CFRunLoopGroupRef group = (CFRunLoopGroupRef)cf;
+    CFIndex i;
+    CFRunLoopGroupInvalidate(group);
+    for (i = 0; i < group->_count; i++) {
+        __CFRunLoopGroupMember* member = &group->_members[i];
+        if (member->runLoop) {
+            CFRelease(member->runLoop);
+        }
+        if (member->observer) {
+            CFRelease(member->observer);
+        }
+    }
+    if (group->_keepAliveSource) {
+        CFRelease(group->_keepAliveSource);
+    }
+    if (group->_members) {
+        CFAllocatorDeallocate(CFGetAllocator(group), group->_members);
+    }
+    pthread_cond_destroy(&group->_startedCondition);
+    pthread_mutex_destroy(&group->_lock);
+}
+
+static const CFRuntimeClass __CFRunLoopGroupClass = {
+    0,
+    "CFRunLoopGroup",
+    NULL, // init
+    NULL, // copy
+    __CFRunLoopGroupDeallocate,
+    NULL, // equal
+    NULL, // hash
+    NULL,
+    __CFRunLoopGroupCopyDescription
+};
+
+///////////////////////////////////////////////////////////////////// internal
+
+CF_INTERNAL void __CFRunLoopGroupInitialize(void) {
+    __kCFRunLoopGroupTypeID = _CFRuntimeRegisterClass(&__CFRunLoopGroupClass);
+}
+
+///////////////////////////////////////////////////////////////////// public
+
+CFTypeID CFRunLoopGroupGetTypeID(void) {
+    return __kCFRunLoopGroupTypeID;
+}
+
+CFRunLoopGroupRef CFRunLoopGroupCreate(CFAllocatorRef allocator, CFIndex count, Boolean pinThreads) {
+    struct __CFRunLoopGroup* group;
+    CFIndex processorCount = CFPlatformGetProcessorCount();
+    CFIndex i;
+    CF_VALIDATE_NONNEGATIVE_ARG(count);
+    if (!count) {
+        count = processorCount;
+    }
+
+    group = (struct __CFRunLoopGroup*)_CFRuntimeCreateInstance(
+        allocator,
+        __kCFRunLoopGroupTypeID,
+        sizeof(struct __CFRunLoopGroup) - sizeof(CFRuntimeBase),
+        NULL);
+    if (!group) {
+        return NULL;
+    }
+    pthread_mutex_init(&group->_lock, NULL);
+    pthread_cond_init(&group->_startedCondition, NULL);
+    group->_startedCount = 0;
+    group->_cursor = -1;
+    group->_stopping = false;
+    group->_count = 0;
+    group->_threadCount = 0;
+    {
+        CFRunLoopSourceContext context = {0};
+        context.perform = __CFRunLoopGroupKeepAlivePerform;
+        group->_keepAliveSource = CFRunLoopSourceCreate(allocator, 0, &context);
+    }
+    group->_members = (__CFRunLoopGroupMember*)CFAllocatorAllocate(
+        allocator, count * sizeof(__CFRunLoopGroupMember), 0);
+    if (!group->_keepAliveSource || !group->_members) {
+        CFRelease(group);
+        return NULL;
+    }
+    memset(group->_members, 0, count * sizeof(__CFRunLoopGroupMember));
+    group->_count = count;
+    for (i = 0; i < count; i++) {
+        __CFRunLoopGroupMember* member = &group->_members[i];
+        CFRunLoopObserverContext context = {0, member, NULL, NULL, NULL};
+        member->group = group;
+        member->observer = CFRunLoopObserverCreate(
+            allocator,
+            kCFRunLoopBeforeTimers | kCFRunLoopBeforeWaiting | kCFRunLoopAfterWaiting,
+            true, 0,
+            __CFRunLoopGroupObserve, &context);
+        if (!member->observer) {
+            CFRelease(group);
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        __CFRunLoopGroupMember* member = &group->_members[i];
+        if (pthread_create(&member->thread, NULL, __CFRunLoopGroupMain, member)) {
+            break;
+        }
+        group->_threadCount++;
+        if (pinThreads) {
+            CFPlatformSetThreadAffinity(member->thread, i % processorCount);
+        }
+    }
+
+    pthread_mutex_lock(&group->_lock);
+    while (group->_startedCount != group->_threadCount) {
+        pthread_cond_wait(&group->_startedCondition, &group->_lock);
+    }
+    pthread_mutex_unlock(&group->_lock);
+    if (group->_threadCount != count) {
+        // Deallocation stops and joins threads that were started.
+        CFRelease(group);
+        return NULL;
+    }
+    return group;
+}
+
+CFIndex CFRunLoopGroupGetCount(CFRunLoopGroupRef group) {
+    CF_VALIDATE_RUNLOOPGROUP_ARG(group);
+    return group->_count;
+}
+
+CFRunLoopRef CFRunLoopGroupGetRunLoopAtIndex(CFRunLoopGroupRef group, CFIndex index) {
+    CF_VALIDATE_RUNLOOPGROUP_ARG(group);
+    CF_VALIDATE_INDEX_ARG(index, group->_count);
+    return group->_members[index].runLoop;
+}
+
+CFRunLoopRef CFRunLoopGroupGetRunLoopForKey(CFRunLoopGroupRef group, CFHashCode key) {
+    CF_VALIDATE_RUNLOOPGROUP_ARG(group);
+    return group->_members[key % group->_count].runLoop;
+}
+
+CFRunLoopRef CFRunLoopGroupAddSource(CFRunLoopGroupRef group, CFRunLoopSourceRef source, CFStringRef mode) {
+    CFRunLoopRef rl;
+    CF_VALIDATE_RUNLOOPGROUP_ARG(group);
+    if (group->_stopping) {
+        return NULL;
+    }
+    rl = __CFRunLoopGroupChooseMember(group, false)->runLoop;
+    CFRunLoopAddSource(rl, source, mode);
+    return rl;
+}
+
+CFRunLoopRef CFRunLoopGroupAddTimer(CFRunLoopGroupRef group, CFRunLoopTimerRef timer, CFStringRef mode) {
+    CFRunLoopRef rl;
+    CF_VALIDATE_RUNLOOPGROUP_ARG(group);
+    if (group->_stopping) {
+        return NULL;
+    }
+    rl = __CFRunLoopGroupChooseMember(group, false)->runLoop;
+    CFRunLoopAddTimer(rl, timer, mode);
+    return rl;
+}
+
+Boolean CFRunLoopGroupPerformFunction(CFRunLoopGroupRef group, CFStringRef mode, CFRunLoopPerformCallBack function, void* context) {
+    CF_VALIDATE_RUNLOOPGROUP_ARG(group);
+    CF_VALIDATE_PTR_ARG(function);
+    if (group->_stopping) {
+        return false;
+    }
+    return __CFRunLoopGroupSubmit(__CFRunLoopGroupChooseMember(group, true), mode, function, context);
+}
+
+Boolean CFRunLoopGroupPerformFunctionForKey(CFRunLoopGroupRef group, CFHashCode key, CFStringRef mode, CFRunLoopPerformCallBack function, void* context) {
+    CF_VALIDATE_RUNLOOPGROUP_ARG(group);
+    CF_VALIDATE_PTR_ARG(function);
+    if (group->_stopping) {
+        return false;
+    }
+    return __CFRunLoopGroupSubmit(&group->_members[key % group->_count], mode, function, context);
+}
+
+void CFRunLoopGroupInvalidate(CFRunLoopGroupRef group) {
+    CFIndex i;
+    CF_VALIDATE_RUNLOOPGROUP_ARG(group);
+    pthread_mutex_lock(&group->_lock);
+    if (group->_stopping) {
+        pthread_mutex_unlock(&group->_lock);
+        return;
+    }
+    group->_stopping = true;
+    pthread_mutex_unlock(&group->_lock);
+
+    for (i = 0; i < group->_threadCount; i++) {
+        // Stopping from inside the run loop works even if the thread
+        //  is just about to enter CFRunLoopRunInMode(). If the function
+        //  can't be queued, stop flag is set directly.
+        CFRunLoopRef rl = group->_members[i].runLoop;
+        if (!CFRunLoopPerformFunction(rl, kCFRunLoopCommonModes, __CFRunLoopGroupStopCurrent, NULL)) {
+            CFRunLoopStop(rl);
+        }
+    }
+    for (i = 0; i < group->_threadCount; i++) {
+        __CFRunLoopGroupMember* member = &group->_members[i];
+        if (pthread_equal(member->thread, pthread_self())) {
+            pthread_detach(member->thread);
+        } else {
+            pthread_join(member->thread, NULL);
+        }
+        CFRunLoopRemoveSource(member->runLoop, group->_keepAliveSource, kCFRunLoopCommonModes);
+        CFRunLoopRemoveObserver(member->runLoop, member->observer, kCFRunLoopCommonModes);
+    }
+}
+
+Boolean CFRunLoopGroupIsValid(CFRunLoopGroupRef group) {
+    CF_VALIDATE_RUNLOOPGROUP_ARG(group);
+    return !group->_stopping;
+}
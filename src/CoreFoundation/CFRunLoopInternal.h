@@ -34,6 +34,12 @@ void __CFRunLoopTimerInitialize(void);
 CF_EXPORT
 void __CFRunLoopSourceInitialize(void);
 
+CF_EXPORT
+void __CFFileDescriptorInitialize(void);
+
+CF_EXPORT
+void __CFRunLoopGroupInitialize(void);
+
 CF_EXTERN_C_END
 
 #endif /* !__COREFOUNDATION_CFRUNLOOPINTERNAL__ */
@@ -33,7 +33,7 @@ static Boolean DefaultWait(CFArrayRef ports,CFTimeInterval timeout,CFIndex* sign
      return false;
 }
 
-static CFSpinLock_t g_implLock=CFSpinLockInit;
+static CFLock_t g_implLock=CFLockInit;
 static Boolean g_implUsed=false;
 static Boolean g_implSet=false;
 static CFRunLoopPortImpl g_impl={
@@ -43,16 +43,41 @@ static CFRunLoopPortImpl g_impl={
     DefaultSignal,
     DefaultWait
 };
+static CFRunLoopPortExtendedImpl g_extImpl={0};
+
+static void UseImpl() {
+    CFLock(&g_implLock);
+    if (!g_implSet) {
+        CFLog(kCFLogLevelWarning,CFSTR("CFRunLoopPortImpl was not set. CFRunLoop may not behave as expected."));
+    }
+    g_implUsed=g_implSet;
+    CFUnlock(&g_implLock);
+}
 
 void CFRunLoopPortSetImpl(const CFRunLoopPortImpl* impl) {
-    CFSpinLock(&g_implLock);
+    CFLock(&g_implLock);
     if (g_implUsed) {
-        CFSpinUnlock(&g_implLock);
+        CFUnlock(&g_implLock);
         CF_GENERIC_ERROR("Current CFRunLoopPortImpl object is in use and can't be changed.");
     }
     memcpy(&g_impl,impl,sizeof(CFRunLoopPortImpl));
+    memset(&g_extImpl,0,sizeof(CFRunLoopPortExtendedImpl));
     g_implSet=true;
-    CFSpinUnlock(&g_implLock);
+    CFUnlock(&g_implLock);
+}
+
+void CFRunLoopPortSetExtendedImpl(const CFRunLoopPortExtendedImpl* impl) {
+    CFLock(&g_implLock);
+    if (g_implUsed) {
+        CFUnlock(&g_implLock);
+        CF_GENERIC_ERROR("Current CFRunLoopPortImpl object is in use and can't be changed.");
+    }
+    if (impl->version!=0) {
+        CFUnlock(&g_implLock);
+        CF_GENERIC_ERROR("Unsupported CFRunLoopPortExtendedImpl version.");
+    }
+    memcpy(&g_extImpl,impl,sizeof(CFRunLoopPortExtendedImpl));
+    CFUnlock(&g_implLock);
 }
 
 ///////////////////////////////////////////////// port
@@ -68,34 +93,63 @@ CFTypeID CFRunLoopPortTypeID() {
     return g_typeID;
 }
 
-CFRunLoopPortRef CFRunLoopPortCreate(CFAllocatorRef allocator) {
-    {
-        CFSpinLock(&g_implLock);
-        if (!g_implSet) {
-            CFLog(kCFLogLevelWarning,CFSTR("CFRunLoopPortImpl was not set. CFRunLoop may not behave as expected."));
-        }
-        g_implUsed=g_implSet;
-        CFSpinUnlock(&g_implLock);
-    }
+static CFRunLoopPort* AllocatePort(CFAllocatorRef allocator) {
     CFRunLoopPort* port=(CFRunLoopPort*)_CFRuntimeCreateInstance(
         allocator,
         CFRunLoopPortTypeID(),
         (CFIndex)g_impl.dataSize - sizeof(port->data),
         NULL);
-    if (!port) {
-        return port;
-    }
-    if (!g_impl.create(port->data)) {
+    return port;
+}
+
+static CFRunLoopPortRef CompletePort(CFRunLoopPort* port,Boolean created) {
+    if (port && !created) {
         CFRelease(port);
         return NULL;
     }
-    return port;        
+    return port;
+}
+
+CFRunLoopPortRef CFRunLoopPortCreate(CFAllocatorRef allocator) {
+    UseImpl();
+    CFRunLoopPort* port=AllocatePort(allocator);
+    return CompletePort(port,port && g_impl.create(port->data));
 }
 
 Boolean CFRunLoopPortSignal(CFRunLoopPortRef port) {
     return g_impl.signal(port->data);
 }
 
+CFRunLoopPortRef CFRunLoopPortCreateTimer(CFAllocatorRef allocator) {
+    UseImpl();
+    if (!g_extImpl.createTimer) {
+        return NULL;
+    }
+    CFRunLoopPort* port=AllocatePort(allocator);
+    return CompletePort(port,port && g_extImpl.createTimer(port->data));
+}
+
+Boolean CFRunLoopPortArmTimer(CFRunLoopPortRef port,SInt64 fireTSR) {
+    return g_extImpl.armTimer(port->data,fireTSR);
+}
+
+CFRunLoopPortRef CFRunLoopPortCreateWithFileDescriptor(CFAllocatorRef allocator,int fd) {
+    UseImpl();
+    if (!g_extImpl.createWithFileDescriptor) {
+        return NULL;
+    }
+    CFRunLoopPort* port=AllocatePort(allocator);
+    return CompletePort(port,port && g_extImpl.createWithFileDescriptor(port->data,fd));
+}
+
+Boolean CFRunLoopPortSetFileDescriptorEvents(CFRunLoopPortRef port,CFOptionFlags events) {
+    return g_extImpl.setFileDescriptorEvents(port->data,events);
+}
+
+CFOptionFlags CFRunLoopPortTakeReadyEvents(CFRunLoopPortRef port) {
+    return g_extImpl.takeReadyEvents(port->data);
+}
+
 Boolean CFRunLoopPortWait(CFArrayRef ports,CFTimeInterval timeout,CFIndex* signalledIndex) {
     return g_impl.wait(ports,timeout,signalledIndex);
 }
@@ -108,6 +162,149 @@ void* CFRunLoopPortGetImplData(CFRunLoopPortRef port) {
     return port->data;
 }
 
+///////////////////////////////////////////////// port set
+
+/* Ports are kept in the bag (which also keeps them alive), impl is
+ *  notified only when port is added for the first time or removed
+ *  for the last time.
+ * Ports removed while the set is being waited on are kept alive in
+ *  'removedPorts' until all waits return, because impl may still
+ *  report them. 'waiters' counts threads waiting on the set.
+ */
+
+typedef struct _CFRunLoopPortSet {
+    CFRuntimeBase runtime;
+    CFLock_t lock;
+    CFIndex waiters;
+    CFMutableBagRef ports;
+    CFMutableArrayRef removedPorts;
+    UInt8 data[1];
+} CFRunLoopPortSet;
+
+static CFTypeID g_setTypeID=_kCFRuntimeNotATypeID;
+
+CFTypeID CFRunLoopPortSetTypeID() {
+    return g_setTypeID;
+}
+
+CFRunLoopPortSetRef CFRunLoopPortSetCreate(CFAllocatorRef allocator) {
+    UseImpl();
+    CFIndex dataSize=g_extImpl.createSet ? g_extImpl.setDataSize : 0;
+    CFRunLoopPortSet* set=(CFRunLoopPortSet*)_CFRuntimeCreateInstance(
+        allocator,
+        CFRunLoopPortSetTypeID(),
+        sizeof(CFRunLoopPortSet) - sizeof(CFRuntimeBase) + dataSize - sizeof(set->data),
+        NULL);
+    if (!set) {
+        return set;
+    }
+    set->lock=CFLockInit;
+    set->waiters=0;
+    set->ports=CFBagCreateMutable(CFGetAllocator(set),0,&kCFTypeBagCallBacks);
+    set->removedPorts=NULL;
+    if (g_extImpl.createSet && !g_extImpl.createSet(set->data)) {
+        // NULL 'ports' tells SetDeallocate that impl data is not valid.
+        CFRelease(set->ports);
+        set->ports=NULL;
+        CFRelease(set);
+        return NULL;
+    }
+    return set;
+}
+
+Boolean CFRunLoopPortSetAddPort(CFRunLoopPortSetRef set,CFRunLoopPortRef port) {
+    Boolean result=true;
+    CFLock(&set->lock);
+    if (g_extImpl.addToSet && !CFBagContainsValue(set->ports,port)) {
+        result=g_extImpl.addToSet(set->data,port,port->data);
+    }
+    if (result) {
+        CFBagAddValue(set->ports,port);
+    }
+    CFUnlock(&set->lock);
+    return result;
+}
+
+void CFRunLoopPortSetRemovePort(CFRunLoopPortSetRef set,CFRunLoopPortRef port) {
+    CFLock(&set->lock);
+    CFIndex count=CFBagGetCountOfValue(set->ports,port);
+    if (count==1) {
+        if (g_extImpl.removeFromSet) {
+            g_extImpl.removeFromSet(set->data,port,port->data);
+        }
+        if (set->waiters) {
+            if (!set->removedPorts) {
+                set->removedPorts=CFArrayCreateMutable(kCFAllocatorSystemDefault,0,&kCFTypeArrayCallBacks);
+            }
+            CFArrayAppendValue(set->removedPorts,port);
+        }
+    }
+    if (count) {
+        CFBagRemoveValue(set->ports,port);
+    }
+    CFUnlock(&set->lock);
+}
+
+static Boolean WaitEmulated(CFRunLoopPortSetRef set,CFTimeInterval timeout,CFRunLoopPortRef* signalledPorts,CFIndex* signalledCount) {
+    CFLock(&set->lock);
+    CFIndex count=CFBagGetCount(set->ports);
+    _CF_ARRAY_ALLOCA(const void*,values,count)
+    CFBagGetValues(set->ports,values);
+    CFUnlock(&set->lock);
+
+    // Bag returns duplicates, but that doesn't affect 'wait'.
+    CFArrayRef ports=CFArrayCreate(kCFAllocatorSystemDefault,values,count,&kCFTypeArrayCallBacks);
+    CFIndex signalledIndex=-1;
+    Boolean result=g_impl.wait(ports,timeout,&signalledIndex);
+    if (result && signalledIndex!=-1) {
+        signalledPorts[0]=(CFRunLoopPortRef)CFRetain(CFArrayGetValueAtIndex(ports,signalledIndex));
+        *signalledCount=1;
+    }
+    CFRelease(ports);
+    return result;
+}
+
+Boolean CFRunLoopPortSetWait(CFRunLoopPortSetRef set,CFTimeInterval timeout,CFRunLoopPortRef* signalledPorts,CFIndex capacity,CFIndex* signalledCount) {
+    *signalledCount=0;
+    if (capacity<1) {
+        return false;
+    }
+    if (!g_extImpl.waitSet) {
+        return WaitEmulated(set,timeout,signalledPorts,signalledCount);
+    }
+
+    CFLock(&set->lock);
+    set->waiters++;
+    CFUnlock(&set->lock);
+
+    CFIndex count=0;
+    Boolean result=g_extImpl.waitSet(set->data,timeout,signalledPorts,capacity,&count);
+
+    CFLock(&set->lock);
+    set->waiters--;
+    if (result) {
+        // Drop ports that were removed while we were waiting.
+        CFIndex i;
+        for (i=0;i!=count;++i) {
+            CFRunLoopPortRef port=signalledPorts[i];
+            if (CFBagContainsValue(set->ports,port)) {
+                signalledPorts[(*signalledCount)++]=(CFRunLoopPortRef)CFRetain(port);
+            }
+        }
+    }
+    CFMutableArrayRef removedPorts=NULL;
+    if (!set->waiters) {
+        removedPorts=set->removedPorts;
+        set->removedPorts=NULL;
+    }
+    CFUnlock(&set->lock);
+
+    if (removedPorts) {
+        CFRelease(removedPorts);
+    }
+    return result;
+}
+
 ///////////////////////////////////////////////// class
 
 static void Deallocate(CFTypeRef cf) {
@@ -139,8 +336,46 @@ static const CFRuntimeClass g_class={
     NULL,        // description
 };
 
+static void SetDeallocate(CFTypeRef cf) {
+    CFRunLoopPortSet* set=CF_CONST_CAST(CFRunLoopPortSet*,cf);
+    if (!set->ports) {
+        // Impl failed to create the set.
+        return;
+    }
+    if (g_extImpl.destroySet) {
+        g_extImpl.destroySet(set->data);
+    }
+    CFRelease(set->ports);
+    if (set->removedPorts) {
+        CFRelease(set->removedPorts);
+    }
+}
+
+static const CFRuntimeClass g_setClass={
+    0,
+    "CFRunLoopPortSet",
+    NULL,        // init
+    NULL,        // copy
+    SetDeallocate,
+    NULL,        // equal
+    NULL,        // hash
+    NULL,        // formatting description
+    NULL,        // description
+};
+
 CF_INTERNAL void __CFRunLoopPortInitialize() {
     g_typeID=_CFRuntimeRegisterClass(&g_class);
+    g_setTypeID=_CFRuntimeRegisterClass(&g_setClass);
+    {
+        const CFRunLoopPortImpl* impl=CFPlatformGetRunLoopPortImpl();
+        if (impl) {
+            CFRunLoopPortSetImpl(impl);
+            const CFRunLoopPortExtendedImpl* extImpl=CFPlatformGetRunLoopPortExtendedImpl();
+            if (extImpl) {
+                CFRunLoopPortSetExtendedImpl(extImpl);
+            }
+        }
+    }
 }
 
 /////////////////////////////////////////////////
@@ -50,22 +50,115 @@ CF_INLINE void __CFUnsetValid(void* cf) {
 
 /////////////////////////////////////////////////
 
-typedef void(*__CFRunLoopModeTimerIterator)(CFRunLoopTimerRef rlt,void* context);
-CF_EXPORT void __CFRunLoopModeIterateTimers(CFRunLoopRef rl,CFRunLoopModeRef rlm,__CFRunLoopModeTimerIterator iterator,void* context);
-CF_EXPORT void __CFRunLoopFindModeIterateTimers(CFRunLoopRef rl,CFStringRef modeName,__CFRunLoopModeTimerIterator iterator,void* context);
-
+/* Link of a version 0 source in the signalled sources queue of a run
+ *  loop. Source has a link for every run loop it's scheduled on: the
+ *  first one is embedded in the source, others are allocated when the
+ *  source is scheduled, so signalling doesn't allocate.
+ * 'runLoop' is set while the source is scheduled on the run loop, and
+ *  is changed under the source lock. Link is in the queue (and the
+ *  queue retains the source) while 'queued' is set.
+ */
+typedef struct __CFRunLoopSourceLink {
+    struct __CFRunLoopSourceLink* next; // next link in the queue
+    struct __CFRunLoopSourceLink* nextLink; // next link of the source
+    CFRunLoopSourceRef source;
+    CFIndex order;
+    CFRunLoopRef volatile runLoop;
+    volatile int32_t queued;
+} __CFRunLoopSourceLink;
+
+CF_EXPORT void _CFRunLoopEnqueueSource0(CFRunLoopRef rl, __CFRunLoopSourceLink* link);
+CF_EXPORT void _CFRunLoopDequeueSource0(CFRunLoopRef rl, CFRunLoopSourceRef rls);
 CF_EXPORT CFStringRef _CFRunLoopModeGetName(CFRunLoopModeRef rlm);
-CF_EXPORT void _CFRunLoopModeAddPort(CFRunLoopModeRef rlm, CFRunLoopPortRef port);
-CF_EXPORT void _CFRunLoopModeRemovePort(CFRunLoopModeRef rlm, CFRunLoopPortRef port);
+CF_EXPORT void _CFRunLoopModeAddPort(CFRunLoopModeRef rlm, CFRunLoopPortRef port, CFRunLoopSourceRef rls);
+CF_EXPORT void _CFRunLoopModeRemovePort(CFRunLoopModeRef rlm, CFRunLoopPortRef port, CFRunLoopSourceRef rls);
+
+/* Per-run loop CFAsyncFile state. It's created and used only by the
+ *  run loop thread, and is destroyed with the run loop.
+ */
+CF_EXPORT void* _CFRunLoopGetAsyncFileQueue(CFRunLoopRef rl);
+CF_EXPORT void _CFRunLoopSetAsyncFileQueue(CFRunLoopRef rl, void* queue);
+CF_EXPORT void _CFAsyncFileQueueDestroy(void* queue);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
+/* Timer heap
+ *
+ * Binary min-heap of timers ordered by deadline (fire TSR plus tolerance,
+ *  see CFRunLoop_Timer.c). Timers remember their position in every heap
+ *  they are in, so that rescheduling and removal are O(log n) and the
+ *  wakeup TSR is available in O(1).
+ * All heaps are guarded by a single timer lock. The only lock taken while
+ *  it is held is a heap's armLock, so heap functions can be called with or
+ *  without run loop / mode locks.
+ * When 'port' is not NULL it's a timer port which is kept armed to
+ *  the wakeup TSR, see __CFRunLoopTimerHeapGetWakeupTSR(). Ports are armed
+ *  after the timer lock is unlocked.
+ */
+typedef struct __CFRunLoopTimerHeap {
+    CFRunLoopTimerRef* timers;
+    CFIndex count;
+    CFIndex capacity;
+    CFRunLoopPortRef port;
+    int64_t armedTSR;
+    CFLock_t armLock;
+    struct __CFRunLoopTimerHeap* armNext; // guarded by armLock
+} __CFRunLoopTimerHeap;
+
+CF_EXPORT void __CFRunLoopTimerHeapInit(__CFRunLoopTimerHeap* heap, CFRunLoopPortRef port);
+CF_EXPORT void __CFRunLoopTimerHeapDestroy(__CFRunLoopTimerHeap* heap);
+CF_EXPORT CFIndex __CFRunLoopTimerHeapGetCount(__CFRunLoopTimerHeap* heap);
+CF_EXPORT Boolean __CFRunLoopTimerHeapContains(__CFRunLoopTimerHeap* heap, CFRunLoopTimerRef rlt);
+CF_EXPORT Boolean __CFRunLoopTimerHeapAdd(__CFRunLoopTimerHeap* heap, CFRunLoopTimerRef rlt);
+CF_EXPORT Boolean __CFRunLoopTimerHeapRemove(__CFRunLoopTimerHeap* heap, CFRunLoopTimerRef rlt);
+CF_EXPORT void __CFRunLoopTimerHeapRemoveAll(__CFRunLoopTimerHeap* heap);
+CF_EXPORT int64_t __CFRunLoopTimerHeapGetNextFireTSR(__CFRunLoopTimerHeap* heap);
+CF_EXPORT int64_t __CFRunLoopTimerHeapGetWakeupTSR(__CFRunLoopTimerHeap* heap);
+CF_EXPORT CFIndex __CFRunLoopTimerHeapCopyDueTimers(__CFRunLoopTimerHeap* heap, int64_t cutoffTSR, CFRunLoopTimerRef* timers, CFIndex capacity);
+
 CF_EXPORT CFRunLoopRef __CFRunLoopTimerGetLoop(CFRunLoopTimerRef rlt);
 CF_EXPORT Boolean __CFRunLoopTimerFire(CFRunLoopRef rl,CFRunLoopTimerRef rlt);
 CF_EXPORT int64_t __CFRunLoopTimerGetFireTSR(CFRunLoopTimerRef rlt);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
+/* Statistics
+ *
+ * Statistics object is created when statistics are enabled for the first
+ *  time, and is destroyed together with the run loop. Iterations are
+ *  tracked only by the run loop thread; they are stacked, since callouts
+ *  can run the loop recursively. Everything else is guarded by the
+ *  statistics lock.
+ */
+typedef struct __CFRunLoopStatistics __CFRunLoopStatistics;
+
+typedef struct __CFRunLoopIteration {
+    struct __CFRunLoopIteration* previous;
+    void* modeStatistics;
+    CFRunLoopIterationStatistics info;
+    int64_t startTSR;
+    int64_t sleepStartTSR;
+    int64_t sleepTSR;
+    int64_t longestCalloutTSR;
+} __CFRunLoopIteration;
+
+CF_INTERNAL __CFRunLoopStatistics* __CFRunLoopStatisticsCreate(void);
+CF_INTERNAL void __CFRunLoopStatisticsDestroy(__CFRunLoopStatistics* stats);
+CF_INTERNAL Boolean __CFRunLoopStatisticsIsEnabled(__CFRunLoopStatistics* stats);
+CF_INTERNAL void __CFRunLoopStatisticsSetEnabled(__CFRunLoopStatistics* stats, Boolean enabled);
+CF_INTERNAL void __CFRunLoopStatisticsSetCallBack(__CFRunLoopStatistics* stats, CFRunLoopStatisticsCallBack callback, void* info);
+CF_INTERNAL void __CFRunLoopStatisticsReset(__CFRunLoopStatistics* stats);
+CF_INTERNAL CFDictionaryRef __CFRunLoopStatisticsCopy(__CFRunLoopStatistics* stats);
+CF_INTERNAL void __CFRunLoopStatisticsBeginIteration(__CFRunLoopStatistics* stats, __CFRunLoopIteration* iteration, CFStringRef modeName);
+CF_INTERNAL void __CFRunLoopStatisticsEndIteration(__CFRunLoopStatistics* stats, CFRunLoopRef rl);
+CF_INTERNAL void __CFRunLoopStatisticsBeginSleep(__CFRunLoopStatistics* stats);
+CF_INTERNAL void __CFRunLoopStatisticsEndSleep(__CFRunLoopStatistics* stats, CFRunLoopWakeUpCause cause);
+CF_INTERNAL void __CFRunLoopStatisticsRecordCallout(__CFRunLoopStatistics* stats, CFTypeRef object, int64_t startTSR);
+CF_INTERNAL void __CFRunLoopStatisticsForgetObject(__CFRunLoopStatistics* stats, CFStringRef modeName, CFTypeRef object);
+CF_INTERNAL void __CFRunLoopStatisticsRecordTimerLateness(__CFRunLoopStatistics* stats, int64_t latenessTSR);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
 CF_EXPORT CFRunLoopPortRef __CFRunLoopSourceGetPort(CFRunLoopSourceRef rls);
 CF_EXPORT void __CFRunLoopSourceSchedule(CFRunLoopSourceRef rls,CFRunLoopRef rl,CFRunLoopModeRef rlm);
 CF_EXPORT void __CFRunLoopSourceCancel(CFRunLoopSourceRef rls,CFRunLoopRef rl,CFRunLoopModeRef rlm);
@@ -40,7 +40,7 @@ static CFTypeID __kCFRunLoopObserverTypeID = _kCFRuntimeNotATypeID;
 
 struct __CFRunLoopObserver {
     CFRuntimeBase _base;
-    CFSpinLock_t _lock;
+    CFLock_t _lock;
     CFRunLoopRef _runLoop;
     CFIndex _rlCount;
     CFOptionFlags _activities;          /* immutable */
@@ -76,10 +76,10 @@ CF_INLINE void __CFRunLoopObserverUnsetRepeats(CFRunLoopObserverRef rlo) {
 }
 
 CF_INLINE void __CFRunLoopObserverLock(CFRunLoopObserverRef rlo) {
-    CFSpinLock(&rlo->_lock);
+    CFLock(&rlo->_lock);
 }
 CF_INLINE void __CFRunLoopObserverUnlock(CFRunLoopObserverRef rlo) {
-    CFSpinUnlock(&rlo->_lock);
+    CFUnlock(&rlo->_lock);
 }
 
 /*** CFRunLoopObserver class ***/
@@ -247,7 +247,7 @@ CFRunLoopObserverRef CFRunLoopObserverCreate(CFAllocatorRef allocator,
     } else {
         __CFRunLoopObserverUnsetRepeats(memory);
     }
-    memory->_lock = CFSpinLockInit;
+    memory->_lock = CFLockInit;
     memory->_runLoop = NULL;
     memory->_rlCount = 0;
     memory->_activities = activities;
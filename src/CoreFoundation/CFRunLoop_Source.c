@@ -38,9 +38,10 @@
 struct __CFRunLoopSource {
     CFRuntimeBase _base;
     uint32_t _bits;
-    CFSpinLock_t _lock;
+    CFLock_t _lock;
     CFIndex _order; // immutable
     CFMutableBagRef _runLoops;
+    __CFRunLoopSourceLink _link; // first link, see __CFRunLoopSourceLink
     union {
         CFRunLoopSourceContext version0; // immutable, except invalidation
         CFRunLoopSourceContext1 version1; // immutable, except invalidation
@@ -62,11 +63,48 @@ CF_INLINE void __CFRunLoopSourceUnsetSignaled(CFRunLoopSourceRef rls) {
 }
 
 CF_INLINE void __CFRunLoopSourceLock(CFRunLoopSourceRef rls) {
-    CFSpinLock(&rls->_lock);
+    CFLock(&rls->_lock);
 }
 
 CF_INLINE void __CFRunLoopSourceUnlock(CFRunLoopSourceRef rls) {
-    CFSpinUnlock(&rls->_lock);
+    CFUnlock(&rls->_lock);
+}
+
+/* Source lock must be held. */
+static __CFRunLoopSourceLink* __CFRunLoopSourceFindLink(CFRunLoopSourceRef rls, CFRunLoopRef rl) {
+    __CFRunLoopSourceLink* link;
+    for (link = &rls->_link; link; link = link->nextLink) {
+        if (link->runLoop == rl) {
+            return link;
+        }
+    }
+    return NULL;
+}
+
+/* Binds free link to 'rl', allocates new one if needed.
+ * Source lock must be held.
+ */
+static __CFRunLoopSourceLink* __CFRunLoopSourceBindLink(CFRunLoopSourceRef rls, CFRunLoopRef rl) {
+    __CFRunLoopSourceLink* link;
+    for (link = &rls->_link; link; link = link->nextLink) {
+        if (!link->runLoop && !link->queued) {
+            link->runLoop = rl;
+            return link;
+        }
+    }
+    link = (__CFRunLoopSourceLink*)CFAllocatorAllocate(
+        CFGetAllocator(rls), sizeof(__CFRunLoopSourceLink), 0);
+    if (!link) {
+        CF_GENERIC_ERROR("Failed to allocate run loop link for %@.", rls);
+    }
+    link->next = NULL;
+    link->source = rls;
+    link->order = rls->_order;
+    link->runLoop = rl;
+    link->queued = 0;
+    link->nextLink = rls->_link.nextLink;
+    rls->_link.nextLink = link;
+    return link;
 }
 
 static void __CFRunLoopSourceRemoveFromRunLoop(const void* value, void* context) {
@@ -169,10 +207,18 @@ static CFStringRef __CFRunLoopSourceCopyDescription(CFTypeRef cf) { /* DOES CALL
 
 static void __CFRunLoopSourceDeallocate(CFTypeRef cf) { /* DOES CALLOUT */
     CFRunLoopSourceRef rls = (CFRunLoopSourceRef)cf;
+    __CFRunLoopSourceLink* link;
     CFRunLoopSourceInvalidate(rls);
     if (rls->_context.version0.release) {
         rls->_context.version0.release(rls->_context.version0.info);
     }
+    // Links are not queued, since queue retains the source
+    link = rls->_link.nextLink;
+    while (link) {
+        __CFRunLoopSourceLink* next = link->nextLink;
+        CFAllocatorDeallocate(CFGetAllocator(rls), link);
+        link = next;
+    }
 }
 
 static const CFRuntimeClass __CFRunLoopSourceClass = {
@@ -204,6 +250,15 @@ CF_INTERNAL void __CFRunLoopSourceSchedule(CFRunLoopSourceRef rls, CFRunLoopRef
         rls->_runLoops = CFBagCreateMutable(CFGetAllocator(rls), 0, NULL);
     }
     CFBagAddValue(rls->_runLoops, rl);
+    if (!rls->_context.version0.version) {
+        __CFRunLoopSourceLink* link = (CFBagGetCountOfValue(rls->_runLoops, rl) == 1) ?
+            __CFRunLoopSourceBindLink(rls, rl) :
+            __CFRunLoopSourceFindLink(rls, rl);
+        if (__CFRunLoopSourceIsSignaled(rls)) {
+            // Signalled before it was scheduled
+            _CFRunLoopEnqueueSource0(rl, link);
+        }
+    }
     __CFRunLoopSourceUnlock(rls);
     // Have to unlock before the callout -- cannot help clients with safety.
 
@@ -214,7 +269,7 @@ CF_INTERNAL void __CFRunLoopSourceSchedule(CFRunLoopSourceRef rls, CFRunLoopRef
     } else if (1 == rls->_context.version0.version) {
         CFRunLoopPortRef port = rls->_context.version1.getPort(rls->_context.version1.info); /* CALLOUT */
         if (port) {
-            _CFRunLoopModeAddPort(rlm, port);
+            _CFRunLoopModeAddPort(rlm, port, rls);
         }
     }
 }
@@ -228,14 +283,26 @@ CF_INTERNAL void __CFRunLoopSourceCancel(CFRunLoopSourceRef rls, CFRunLoopRef rl
     } else if (1 == rls->_context.version0.version) {
         CFRunLoopPortRef port = rls->_context.version1.getPort(rls->_context.version1.info); /* CALLOUT */
         if (port) {
-            _CFRunLoopModeRemovePort(rlm, port);
+            _CFRunLoopModeRemovePort(rlm, port, rls);
         }
     }
+    Boolean unscheduled = true;
     __CFRunLoopSourceLock(rls);
     if (rls->_runLoops) {
         CFBagRemoveValue(rls->_runLoops, rl);
+        unscheduled = !CFBagContainsValue(rls->_runLoops, rl);
+    }
+    if (unscheduled && !rls->_context.version0.version) {
+        __CFRunLoopSourceLink* link = __CFRunLoopSourceFindLink(rls, rl);
+        if (link) {
+            link->runLoop = NULL;
+        }
     }
     __CFRunLoopSourceUnlock(rls);
+    if (unscheduled && !rls->_context.version0.version) {
+        // Don't keep the source queued until it's signalled again
+        _CFRunLoopDequeueSource0(rl, rls);
+    }
 }
 
 CF_INTERNAL CFComparisonResult __CFRunLoopSourceComparator(const void* val1, const void* val2, void* context) {
@@ -318,10 +385,13 @@ CFRunLoopSourceRef CFRunLoopSourceCreate(CFAllocatorRef allocator, CFIndex order
     }
     __CFSetValid(memory);
     __CFRunLoopSourceUnsetSignaled(memory);
-    memory->_lock = CFSpinLockInit;
+    memory->_lock = CFLockInit;
     memory->_bits = 0;
     memory->_order = order;
     memory->_runLoops = NULL;
+    memset(&memory->_link, 0, sizeof(memory->_link));
+    memory->_link.source = memory;
+    memory->_link.order = order;
     size = 0;
     switch (context->version) {
         case 0:
@@ -392,8 +462,18 @@ void CFRunLoopSourceGetContext(CFRunLoopSourceRef rls, CFRunLoopSourceContext* c
 
 void CFRunLoopSourceSignal(CFRunLoopSourceRef rls) {
     __CFRunLoopSourceLock(rls);
-    if (__CFIsValid(rls)) {
+    if (__CFIsValid(rls) && !__CFRunLoopSourceIsSignaled(rls)) {
         __CFRunLoopSourceSetSignaled(rls);
+        // Run loops stay alive while links are bound to them, since
+        //  unbinding also takes the source lock.
+        if (!rls->_context.version0.version) {
+            __CFRunLoopSourceLink* link;
+            for (link = &rls->_link; link; link = link->nextLink) {
+                if (link->runLoop) {
+                    _CFRunLoopEnqueueSource0(link->runLoop, link);
+                }
+            }
+        }
     }
     __CFRunLoopSourceUnlock(rls);
 }
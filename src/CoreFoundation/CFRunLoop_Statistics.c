@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CFInternal.h"
+#include "CFRunLoop_Common.h"
+#include <string.h>
+
+typedef struct {
+    int64_t count;
+    int64_t totalTSR;
+    int64_t maxTSR;
+} __CFRunLoopCalloutStatistics;
+
+/* Objects removed from a mode are remembered for a while, so that their
+ *  running callouts are not recorded (see __CFRunLoopStatisticsForgetObject).
+ *  Objects are not retained and are compared by address.
+ */
+#define __kCFRunLoopStatisticsForgottenCount 8
+
+typedef struct {
+    CFTypeRef object;
+    int64_t forgetTSR;
+} __CFRunLoopForgottenObject;
+
+typedef struct {
+    int64_t iterationCount;
+    int64_t busyHistogram[kCFRunLoopStatisticsHistogramSize];
+    int64_t sleepTSR;
+    int64_t sleepHistogram[kCFRunLoopStatisticsHistogramSize];
+    int64_t wakeUpCounts[kCFRunLoopWakeUpCauseCount];
+    int64_t timerLatenessHistogram[kCFRunLoopStatisticsHistogramSize];
+    CFMutableDictionaryRef callouts; // object -> __CFRunLoopCalloutStatistics*
+    __CFRunLoopForgottenObject forgotten[__kCFRunLoopStatisticsForgottenCount]; // ring
+    CFIndex forgottenNext;
+    int64_t forgottenOverflowTSR; // forget TSR of the last overwritten entry
+} __CFRunLoopModeStatistics;
+
+struct __CFRunLoopStatistics {
+    CFLock_t lock;
+    volatile Boolean enabled;
+    CFRunLoopStatisticsCallBack callback;
+    void* info;
+    CFMutableDictionaryRef modes; // name -> __CFRunLoopModeStatistics*, never removed
+    __CFRunLoopIteration* iteration; // innermost, run loop thread only
+};
+
+///////////////////////////////////////////////////////////////////// private
+
+/* Callouts are keyed by identity, not by CFEqual(): distinct sources
+ *  with equal contexts must be accounted separately.
+ * Keys are retained, so that CFRunLoopCopyStatistics() can report them,
+ *  but entries are dropped when objects are removed from the mode
+ *  (see __CFRunLoopStatisticsForgetObject), so statistics don't keep
+ *  objects alive.
+ */
+static const void* __CFRunLoopStatisticsRetainKey(CFAllocatorRef allocator, const void* value) {
+    return CFRetain(value);
+}
+
+static void __CFRunLoopStatisticsReleaseKey(CFAllocatorRef allocator, const void* value) {
+    CFRelease(value);
+}
+
+static const CFDictionaryKeyCallBacks __CFRunLoopStatisticsCalloutKeyCallBacks = {
+    0,
+    __CFRunLoopStatisticsRetainKey,
+    __CFRunLoopStatisticsReleaseKey,
+    CFCopyDescription,
+    NULL, // equal
+    NULL // hash
+};
+
+CF_INLINE void __CFRunLoopStatisticsLock(__CFRunLoopStatistics* stats) {
+    CFLock(&stats->lock);
+}
+
+CF_INLINE void __CFRunLoopStatisticsUnlock(__CFRunLoopStatistics* stats) {
+    CFUnlock(&stats->lock);
+}
+
+static CFIndex __CFRunLoopStatisticsGetBucket(int64_t tsr) {
+    CFIndex bucket = 0;
+    uint64_t micros;
+    if (tsr <= 0) {
+        return 0;
+    }
+    micros = (uint64_t)(_CFTSRToTimeInterval(tsr) * 1.0e6);
+    while (micros > 1 && bucket < kCFRunLoopStatisticsHistogramSize - 1) {
+        micros >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void __CFRunLoopStatisticsFreeCallout(const void* key, const void* value, void* context) {
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, (void*)value);
+}
+
+static void __CFRunLoopStatisticsResetMode(const void* key, const void* value, void* context) {
+    __CFRunLoopModeStatistics* modeStats = (__CFRunLoopModeStatistics*)value;
+    CFMutableDictionaryRef callouts = modeStats->callouts;
+    CFDictionaryApplyFunction(callouts, __CFRunLoopStatisticsFreeCallout, NULL);
+    CFDictionaryRemoveAllValues(callouts);
+    memset(modeStats, 0, sizeof(__CFRunLoopModeStatistics));
+    modeStats->callouts = callouts;
+}
+
+/* Returns true if 'object' was (or may have been) removed from the mode
+ *  after 'startTSR'. When the ring overflows, objects forgotten before
+ *  the overwritten entry are conservatively treated as removed.
+ */
+static Boolean __CFRunLoopStatisticsWasForgotten(__CFRunLoopModeStatistics* modeStats, CFTypeRef object, int64_t startTSR) {
+    CFIndex i;
+    if (modeStats->forgottenOverflowTSR >= startTSR) {
+        return true;
+    }
+    for (i = 0; i != __kCFRunLoopStatisticsForgottenCount; ++i) {
+        const __CFRunLoopForgottenObject* forgotten = &modeStats->forgotten[i];
+        if (forgotten->object == object && forgotten->forgetTSR >= startTSR) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void __CFRunLoopStatisticsDestroyMode(const void* key, const void* value, void* context) {
+    __CFRunLoopModeStatistics* modeStats = (__CFRunLoopModeStatistics*)value;
+    CFDictionaryApplyFunction(modeStats->callouts, __CFRunLoopStatisticsFreeCallout, NULL);
+    CFRelease(modeStats->callouts);
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, modeStats);
+}
+
+/* Expects 'stats' to be locked. Returns NULL if mode statistics
+ *  can't be allocated.
+ */
+static __CFRunLoopModeStatistics* __CFRunLoopStatisticsGetMode(__CFRunLoopStatistics* stats, CFStringRef modeName) {
+    __CFRunLoopModeStatistics* modeStats = (__CFRunLoopModeStatistics*)CFDictionaryGetValue(stats->modes, modeName);
+    if (!modeStats) {
+        modeStats = (__CFRunLoopModeStatistics*)CFAllocatorAllocate(
+            kCFAllocatorSystemDefault, sizeof(__CFRunLoopModeStatistics), 0);
+        if (!modeStats) {
+            return NULL;
+        }
+        memset(modeStats, 0, sizeof(__CFRunLoopModeStatistics));
+        modeStats->callouts = CFDictionaryCreateMutable(
+            kCFAllocatorSystemDefault, 0,
+            &__CFRunLoopStatisticsCalloutKeyCallBacks, NULL);
+        if (!modeStats->callouts) {
+            CFAllocatorDeallocate(kCFAllocatorSystemDefault, modeStats);
+            return NULL;
+        }
+        CFDictionarySetValue(stats->modes, modeName, modeStats);
+    }
+    return modeStats;
+}
+
+static CFNumberRef __CFRunLoopStatisticsCreateCount(int64_t value) {
+    return CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberSInt64Type, &value);
+}
+
+static CFNumberRef __CFRunLoopStatisticsCreateTime(int64_t tsr) {
+    CFTimeInterval value = _CFTSRToTimeInterval(tsr);
+    return CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberDoubleType, &value);
+}
+
+static CFArrayRef __CFRunLoopStatisticsCreateCounts(const int64_t* values, CFIndex count) {
+    CFNumberRef numbers[kCFRunLoopStatisticsHistogramSize];
+    CFArrayRef result;
+    CFIndex i;
+    for (i = 0; i != count; ++i) {
+        numbers[i] = __CFRunLoopStatisticsCreateCount(values[i]);
+    }
+    result = CFArrayCreate(kCFAllocatorSystemDefault, (const void**)numbers, count, &kCFTypeArrayCallBacks);
+    for (i = 0; i != count; ++i) {
+        CFRelease(numbers[i]);
+    }
+    return result;
+}
+
+static void __CFRunLoopStatisticsSetAndRelease(CFMutableDictionaryRef dictionary, CFStringRef key, CFTypeRef value) {
+    CFDictionarySetValue(dictionary, key, value);
+    CFRelease(value);
+}
+
+static void __CFRunLoopStatisticsCopyCallout(const void* key, const void* value, void* context) {
+    const __CFRunLoopCalloutStatistics* callout = (const __CFRunLoopCalloutStatistics*)value;
+    CFMutableDictionaryRef result = CFDictionaryCreateMutable(
+        kCFAllocatorSystemDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    CFDictionarySetValue(result, kCFRunLoopStatisticsCalloutObjectKey, key);
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsCalloutCountKey,
+        __CFRunLoopStatisticsCreateCount(callout->count));
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsCalloutTimeKey,
+        __CFRunLoopStatisticsCreateTime(callout->totalTSR));
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsCalloutMaxTimeKey,
+        __CFRunLoopStatisticsCreateTime(callout->maxTSR));
+    CFArrayAppendValue((CFMutableArrayRef)context, result);
+    CFRelease(result);
+}
+
+static void __CFRunLoopStatisticsCopyMode(const void* key, const void* value, void* context) {
+    const __CFRunLoopModeStatistics* modeStats = (const __CFRunLoopModeStatistics*)value;
+    CFMutableDictionaryRef result = CFDictionaryCreateMutable(
+        kCFAllocatorSystemDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    CFMutableArrayRef callouts = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsIterationCountKey,
+        __CFRunLoopStatisticsCreateCount(modeStats->iterationCount));
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsBusyTimeHistogramKey,
+        __CFRunLoopStatisticsCreateCounts(modeStats->busyHistogram, kCFRunLoopStatisticsHistogramSize));
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsSleepTimeKey,
+        __CFRunLoopStatisticsCreateTime(modeStats->sleepTSR));
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsSleepTimeHistogramKey,
+        __CFRunLoopStatisticsCreateCounts(modeStats->sleepHistogram, kCFRunLoopStatisticsHistogramSize));
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsWakeUpCountsKey,
+        __CFRunLoopStatisticsCreateCounts(modeStats->wakeUpCounts, kCFRunLoopWakeUpCauseCount));
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsTimerLatenessHistogramKey,
+        __CFRunLoopStatisticsCreateCounts(modeStats->timerLatenessHistogram, kCFRunLoopStatisticsHistogramSize));
+    CFDictionaryApplyFunction(modeStats->callouts, __CFRunLoopStatisticsCopyCallout, callouts);
+    __CFRunLoopStatisticsSetAndRelease(result, kCFRunLoopStatisticsCalloutsKey, callouts);
+
+    CFDictionarySetValue((CFMutableDictionaryRef)context, key, result);
+    CFRelease(result);
+}
+
+///////////////////////////////////////////////////////////////////// internal
+
+/* Returns NULL if statistics can't be allocated. */
+CF_INTERNAL __CFRunLoopStatistics* __CFRunLoopStatisticsCreate(void) {
+    __CFRunLoopStatistics* stats = (__CFRunLoopStatistics*)CFAllocatorAllocate(
+        kCFAllocatorSystemDefault, sizeof(__CFRunLoopStatistics), 0);
+    if (!stats) {
+        return NULL;
+    }
+    stats->lock = CFLockInit;
+    stats->enabled = false;
+    stats->callback = NULL;
+    stats->info = NULL;
+    stats->modes = CFDictionaryCreateMutable(
+        kCFAllocatorSystemDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, NULL);
+    if (!stats->modes) {
+        CFAllocatorDeallocate(kCFAllocatorSystemDefault, stats);
+        return NULL;
+    }
+    stats->iteration = NULL;
+    return stats;
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsDestroy(__CFRunLoopStatistics* stats) {
+    CFDictionaryApplyFunction(stats->modes, __CFRunLoopStatisticsDestroyMode, NULL);
+    CFRelease(stats->modes);
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, stats);
+}
+
+CF_INTERNAL Boolean __CFRunLoopStatisticsIsEnabled(__CFRunLoopStatistics* stats) {
+    return stats->enabled;
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsSetEnabled(__CFRunLoopStatistics* stats, Boolean enabled) {
+    stats->enabled = enabled;
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsSetCallBack(__CFRunLoopStatistics* stats, CFRunLoopStatisticsCallBack callback, void* info) {
+    __CFRunLoopStatisticsLock(stats);
+    stats->callback = callback;
+    stats->info = info;
+    __CFRunLoopStatisticsUnlock(stats);
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsReset(__CFRunLoopStatistics* stats) {
+    __CFRunLoopStatisticsLock(stats);
+    CFDictionaryApplyFunction(stats->modes, __CFRunLoopStatisticsResetMode, NULL);
+    __CFRunLoopStatisticsUnlock(stats);
+}
+
+CF_INTERNAL CFDictionaryRef __CFRunLoopStatisticsCopy(__CFRunLoopStatistics* stats) {
+    CFMutableDictionaryRef result = CFDictionaryCreateMutable(
+        kCFAllocatorSystemDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    __CFRunLoopStatisticsLock(stats);
+    CFDictionaryApplyFunction(stats->modes, __CFRunLoopStatisticsCopyMode, result);
+    __CFRunLoopStatisticsUnlock(stats);
+    return result;
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsBeginIteration(__CFRunLoopStatistics* stats, __CFRunLoopIteration* iteration, CFStringRef modeName) {
+    memset(iteration, 0, sizeof(__CFRunLoopIteration));
+    iteration->startTSR = _CFReadTSR();
+    iteration->info.mode = modeName;
+    iteration->info.wakeUpCause = kCFRunLoopWakeUpNone;
+    __CFRunLoopStatisticsLock(stats);
+    iteration->modeStatistics = __CFRunLoopStatisticsGetMode(stats, modeName);
+    __CFRunLoopStatisticsUnlock(stats);
+    iteration->previous = stats->iteration;
+    stats->iteration = iteration;
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsEndIteration(__CFRunLoopStatistics* stats, CFRunLoopRef rl) {
+    __CFRunLoopIteration* iteration = stats->iteration;
+    __CFRunLoopModeStatistics* modeStats = (__CFRunLoopModeStatistics*)iteration->modeStatistics;
+    CFRunLoopStatisticsCallBack callback;
+    void* info;
+    int64_t busyTSR = _CFReadTSR() - iteration->startTSR - iteration->sleepTSR;
+    stats->iteration = iteration->previous;
+
+    __CFRunLoopStatisticsLock(stats);
+    if (modeStats) {
+        modeStats->iterationCount++;
+        modeStats->busyHistogram[__CFRunLoopStatisticsGetBucket(busyTSR)]++;
+        if (iteration->info.wakeUpCause != kCFRunLoopWakeUpNone) {
+            modeStats->sleepTSR += iteration->sleepTSR;
+            modeStats->sleepHistogram[__CFRunLoopStatisticsGetBucket(iteration->sleepTSR)]++;
+        }
+        modeStats->wakeUpCounts[iteration->info.wakeUpCause]++;
+    }
+    callback = stats->enabled ? stats->callback : NULL;
+    info = stats->info;
+    __CFRunLoopStatisticsUnlock(stats);
+
+    if (callback) {
+        iteration->info.busyTime = _CFTSRToTimeInterval(busyTSR);
+        iteration->info.sleepTime = _CFTSRToTimeInterval(iteration->sleepTSR);
+        iteration->info.longestCalloutTime = _CFTSRToTimeInterval(iteration->longestCalloutTSR);
+        callback(rl, &iteration->info, info); /* CALLOUT */
+    }
+    if (iteration->info.longestCalloutObject) {
+        CFRelease(iteration->info.longestCalloutObject);
+    }
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsBeginSleep(__CFRunLoopStatistics* stats) {
+    if (stats->iteration) {
+        stats->iteration->sleepStartTSR = _CFReadTSR();
+    }
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsEndSleep(__CFRunLoopStatistics* stats, CFRunLoopWakeUpCause cause) {
+    __CFRunLoopIteration* iteration = stats->iteration;
+    if (iteration) {
+        if (cause != kCFRunLoopWakeUpNone) {
+            iteration->sleepTSR += _CFReadTSR() - iteration->sleepStartTSR;
+        }
+        iteration->info.wakeUpCause = cause;
+    }
+}
+
+/* Drops callout statistics of 'object' removed from the mode. The object
+ *  is remembered, so that if it was removed while being called out, that
+ *  callout is not recorded (see __CFRunLoopStatisticsRecordCallout).
+ */
+CF_INTERNAL void __CFRunLoopStatisticsForgetObject(__CFRunLoopStatistics* stats, CFStringRef modeName, CFTypeRef object) {
+    __CFRunLoopModeStatistics* modeStats;
+    __CFRunLoopStatisticsLock(stats);
+    modeStats = (__CFRunLoopModeStatistics*)CFDictionaryGetValue(stats->modes, modeName);
+    if (modeStats) {
+        __CFRunLoopForgottenObject* forgotten = &modeStats->forgotten[modeStats->forgottenNext];
+        void* callout = (void*)CFDictionaryGetValue(modeStats->callouts, object);
+        if (callout) {
+            CFDictionaryRemoveValue(modeStats->callouts, object);
+            CFAllocatorDeallocate(kCFAllocatorSystemDefault, callout);
+        }
+        if (forgotten->object) {
+            modeStats->forgottenOverflowTSR = forgotten->forgetTSR;
+        }
+        forgotten->object = object;
+        forgotten->forgetTSR = _CFReadTSR();
+        modeStats->forgottenNext = (modeStats->forgottenNext + 1) % __kCFRunLoopStatisticsForgottenCount;
+    }
+    __CFRunLoopStatisticsUnlock(stats);
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsRecordCallout(__CFRunLoopStatistics* stats, CFTypeRef object, int64_t startTSR) {
+    __CFRunLoopIteration* iteration = stats->iteration;
+    __CFRunLoopModeStatistics* modeStats;
+    __CFRunLoopCalloutStatistics* callout;
+    int64_t durationTSR = _CFReadTSR() - startTSR;
+    if (!iteration) {
+        return;
+    }
+    if (!object) {
+        object = kCFNull;
+    }
+    iteration->info.calloutCount++;
+    if (!iteration->info.longestCalloutObject || durationTSR > iteration->longestCalloutTSR) {
+        CFRetain(object);
+        if (iteration->info.longestCalloutObject) {
+            CFRelease(iteration->info.longestCalloutObject);
+        }
+        iteration->info.longestCalloutObject = object;
+        iteration->longestCalloutTSR = durationTSR;
+    }
+
+    modeStats = (__CFRunLoopModeStatistics*)iteration->modeStatistics;
+    if (!modeStats) {
+        return;
+    }
+    __CFRunLoopStatisticsLock(stats);
+    callout = (__CFRunLoopCalloutStatistics*)CFDictionaryGetValue(modeStats->callouts, object);
+    if (!callout && object != kCFNull &&
+        (!__CFIsValid(object) || __CFRunLoopStatisticsWasForgotten(modeStats, object, startTSR)))
+    {
+        // Object was invalidated or removed during the callout, e.g.
+        //  a one-shot timer. Entry would keep it alive, so skip it.
+        __CFRunLoopStatisticsUnlock(stats);
+        return;
+    }
+    if (!callout) {
+        callout = (__CFRunLoopCalloutStatistics*)CFAllocatorAllocate(
+            kCFAllocatorSystemDefault, sizeof(__CFRunLoopCalloutStatistics), 0);
+        if (!callout) {
+            __CFRunLoopStatisticsUnlock(stats);
+            return;
+        }
+        memset(callout, 0, sizeof(__CFRunLoopCalloutStatistics));
+        CFDictionarySetValue(modeStats->callouts, object, callout);
+    }
+    callout->count++;
+    callout->totalTSR += durationTSR;
+    if (durationTSR > callout->maxTSR) {
+        callout->maxTSR = durationTSR;
+    }
+    __CFRunLoopStatisticsUnlock(stats);
+}
+
+CF_INTERNAL void __CFRunLoopStatisticsRecordTimerLateness(__CFRunLoopStatistics* stats, int64_t latenessTSR) {
+    __CFRunLoopIteration* iteration = stats->iteration;
+    if (!iteration || !iteration->modeStatistics) {
+        return;
+    }
+    __CFRunLoopStatisticsLock(stats);
+    ((__CFRunLoopModeStatistics*)iteration->modeStatistics)->
+        timerLatenessHistogram[__CFRunLoopStatisticsGetBucket(latenessTSR)]++;
+    __CFRunLoopStatisticsUnlock(stats);
+}
+
+///////////////////////////////////////////////////////////////////// public
+
+CONST_STRING_DECL(kCFRunLoopStatisticsIterationCountKey, "kCFRunLoopStatisticsIterationCountKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsBusyTimeHistogramKey, "kCFRunLoopStatisticsBusyTimeHistogramKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsSleepTimeKey, "kCFRunLoopStatisticsSleepTimeKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsSleepTimeHistogramKey, "kCFRunLoopStatisticsSleepTimeHistogramKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsWakeUpCountsKey, "kCFRunLoopStatisticsWakeUpCountsKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsTimerLatenessHistogramKey, "kCFRunLoopStatisticsTimerLatenessHistogramKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsCalloutsKey, "kCFRunLoopStatisticsCalloutsKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsCalloutObjectKey, "kCFRunLoopStatisticsCalloutObjectKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsCalloutCountKey, "kCFRunLoopStatisticsCalloutCountKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsCalloutTimeKey, "kCFRunLoopStatisticsCalloutTimeKey")
+CONST_STRING_DECL(kCFRunLoopStatisticsCalloutMaxTimeKey, "kCFRunLoopStatisticsCalloutMaxTimeKey")
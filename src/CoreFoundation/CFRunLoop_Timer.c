@@ -34,22 +34,35 @@
 #include <math.h>
 #include <stdio.h>
 #include <limits.h>
+#include <CoreFoundation/CFSortFunctions.h>
+
+typedef struct {
+    __CFRunLoopTimerHeap* heap;
+    CFIndex index;
+} __CFRunLoopTimerHeapSlot;
 
 struct __CFRunLoopTimer {
     CFRuntimeBase _base;
-    CFSpinLock_t _lock;
+    CFLock_t _lock;
     CFRunLoopRef _runLoop;
     CFIndex _rlCount;
     CFIndex _order; // immutable
     int64_t _fireTSR; // TSR units
     int64_t _intervalTSR; // immutable; 0 means non-repeating; TSR units
+    int64_t _toleranceTSR; // guarded by __CFRLTFireTSRLock; TSR units
+    int64_t _deadlineTSR; // heap key, see __CFRunLoopTimerGetDeadlineTSR()
     CFRunLoopTimerCallBack _callout; // immutable
     CFRunLoopTimerContext _context; // immutable, except invalidation
+    CFIndex _heapCount; // number of heaps the timer is in
+    CFIndex _heapCapacity;
+    __CFRunLoopTimerHeapSlot* _heapSlots; // position in each heap
+    __CFRunLoopTimerHeapSlot _inlineHeapSlot; // storage for the common single-heap case
 };
 
 static CFTypeID __kCFRunLoopTimerTypeID = _kCFRuntimeNotATypeID;
 
-static CFSpinLock_t __CFRLTFireTSRLock = CFSpinLockInit;
+/* Guards _fireTSR of all timers and all timer heaps. */
+static CFLock_t __CFRLTFireTSRLock = CFLockInit;
 
 ///////////////////////////////////////////////////////////////////// private
 
@@ -76,17 +89,198 @@ CF_INLINE void __CFRunLoopTimerUnsetDidFire(CFRunLoopTimerRef rlt) {
 }
 
 CF_INLINE void __CFRunLoopTimerLock(CFRunLoopTimerRef rlt) {
-    CFSpinLock(&rlt->_lock);
+    CFLock(&rlt->_lock);
 }
 CF_INLINE void __CFRunLoopTimerUnlock(CFRunLoopTimerRef rlt) {
-    CFSpinUnlock(&rlt->_lock);
+    CFUnlock(&rlt->_lock);
 }
 
 CF_INLINE void __CFRunLoopTimerFireTSRLock(void) {
-    CFSpinLock(&__CFRLTFireTSRLock);
+    CFLock(&__CFRLTFireTSRLock);
 }
 CF_INLINE void __CFRunLoopTimerFireTSRUnlock(void) {
-    CFSpinUnlock(&__CFRLTFireTSRLock);
+    CFUnlock(&__CFRLTFireTSRLock);
+}
+
+/* Timer heap, all functions expect __CFRLTFireTSRLock to be locked. */
+
+CF_INLINE __CFRunLoopTimerHeapSlot* __CFRunLoopTimerFindHeapSlot(CFRunLoopTimerRef rlt, __CFRunLoopTimerHeap* heap) {
+    CFIndex i;
+    for (i = 0; i != rlt->_heapCount; ++i) {
+        if (rlt->_heapSlots[i].heap == heap) {
+            return &rlt->_heapSlots[i];
+        }
+    }
+    return NULL;
+}
+
+// Returns false if slots can't be grown.
+static Boolean __CFRunLoopTimerAddHeapSlot(CFRunLoopTimerRef rlt, __CFRunLoopTimerHeap* heap) {
+    if (rlt->_heapCount == rlt->_heapCapacity) {
+        CFIndex capacity = 2 * rlt->_heapCapacity;
+        __CFRunLoopTimerHeapSlot* slots = (__CFRunLoopTimerHeapSlot*)CFAllocatorAllocate(
+            kCFAllocatorSystemDefault, capacity * sizeof(__CFRunLoopTimerHeapSlot), 0);
+        if (!slots) {
+            return false;
+        }
+        memcpy(slots, rlt->_heapSlots, rlt->_heapCount * sizeof(__CFRunLoopTimerHeapSlot));
+        if (rlt->_heapSlots != &rlt->_inlineHeapSlot) {
+            CFAllocatorDeallocate(kCFAllocatorSystemDefault, rlt->_heapSlots);
+        }
+        rlt->_heapSlots = slots;
+        rlt->_heapCapacity = capacity;
+    }
+    rlt->_heapSlots[rlt->_heapCount].heap = heap;
+    rlt->_heapSlots[rlt->_heapCount].index = heap->count;
+    rlt->_heapCount++;
+    return true;
+}
+
+static void __CFRunLoopTimerRemoveHeapSlot(CFRunLoopTimerRef rlt, __CFRunLoopTimerHeapSlot* slot) {
+    *slot = rlt->_heapSlots[--rlt->_heapCount];
+}
+
+CF_INLINE void __CFRunLoopTimerHeapSet(__CFRunLoopTimerHeap* heap, CFIndex index, CFRunLoopTimerRef rlt) {
+    heap->timers[index] = rlt;
+    __CFRunLoopTimerFindHeapSlot(rlt, heap)->index = index;
+}
+
+static void __CFRunLoopTimerHeapSiftUp(__CFRunLoopTimerHeap* heap, CFIndex index) {
+    CFRunLoopTimerRef rlt = heap->timers[index];
+    while (index) {
+        CFIndex parent = (index - 1) / 2;
+        if (heap->timers[parent]->_deadlineTSR <= rlt->_deadlineTSR) {
+            break;
+        }
+        __CFRunLoopTimerHeapSet(heap, index, heap->timers[parent]);
+        index = parent;
+    }
+    __CFRunLoopTimerHeapSet(heap, index, rlt);
+}
+
+static void __CFRunLoopTimerHeapSiftDown(__CFRunLoopTimerHeap* heap, CFIndex index) {
+    CFRunLoopTimerRef rlt = heap->timers[index];
+    for (;;) {
+        CFIndex child = 2 * index + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count &&
+            heap->timers[child + 1]->_deadlineTSR < heap->timers[child]->_deadlineTSR)
+        {
+            child++;
+        }
+        if (rlt->_deadlineTSR <= heap->timers[child]->_deadlineTSR) {
+            break;
+        }
+        __CFRunLoopTimerHeapSet(heap, index, heap->timers[child]);
+        index = child;
+    }
+    __CFRunLoopTimerHeapSet(heap, index, rlt);
+}
+
+/* Returns the latest TSR at which the timer can still fire. For timers
+ *  with tolerance that's the end of the tolerance window aligned down to
+ *  a power of two slot not larger than the tolerance. Since slots don't
+ *  depend on the timer, timers with overlapping windows end up with the
+ *  same deadline, and are fired by a single wakeup.
+ */
+CF_INLINE int64_t __CFRunLoopTimerGetDeadlineTSR(CFRunLoopTimerRef rlt) {
+    int64_t tolerance = rlt->_toleranceTSR;
+    int64_t deadline, slot;
+    if (!tolerance) {
+        return rlt->_fireTSR;
+    }
+    if (rlt->_fireTSR > LLONG_MAX - tolerance) {
+        return LLONG_MAX;
+    }
+    deadline = rlt->_fireTSR + tolerance;
+    for (slot = 1; slot <= tolerance / 2; slot *= 2) {
+    }
+    return deadline - deadline % slot;
+}
+
+/* Heaps which timer ports need to be armed are collected into 'armList'
+ *  while __CFRLTFireTSRLock is held, and armed after it is unlocked, see
+ *  __CFRunLoopTimerFireTSRUnlockAndArm(). Listed heap is locked with its
+ *  armLock, which is taken in the same order as the wakeups are computed,
+ *  so ports are armed in that order too.
+ */
+static void __CFRunLoopTimerHeapRearm(__CFRunLoopTimerHeap* heap, __CFRunLoopTimerHeap** armList) {
+    __CFRunLoopTimerHeap* listed;
+    int64_t wakeupTSR;
+    if (!heap->port) {
+        return;
+    }
+    wakeupTSR = heap->count ? heap->timers[0]->_deadlineTSR : 0;
+    if (heap->armedTSR == wakeupTSR) {
+        return;
+    }
+    for (listed = *armList; listed && listed != heap; listed = listed->armNext) {
+    }
+    if (!listed) {
+        CFLock(&heap->armLock);
+        heap->armNext = *armList;
+        *armList = heap;
+    }
+    heap->armedTSR = wakeupTSR;
+}
+
+static void __CFRunLoopTimerFireTSRUnlockAndArm(__CFRunLoopTimerHeap* armList) {
+    __CFRunLoopTimerFireTSRUnlock();
+    while (armList) {
+        __CFRunLoopTimerHeap* heap = armList;
+        armList = heap->armNext;
+        CFRunLoopPortArmTimer(heap->port, heap->armedTSR);
+        CFUnlock(&heap->armLock);
+    }
+}
+
+/* Called after _fireTSR or _toleranceTSR is changed. */
+static void __CFRunLoopTimerReposition(CFRunLoopTimerRef rlt, __CFRunLoopTimerHeap** armList) {
+    CFIndex i;
+    rlt->_deadlineTSR = __CFRunLoopTimerGetDeadlineTSR(rlt);
+    for (i = 0; i != rlt->_heapCount; ++i) {
+        __CFRunLoopTimerHeap* heap = rlt->_heapSlots[i].heap;
+        __CFRunLoopTimerHeapSiftUp(heap, rlt->_heapSlots[i].index);
+        __CFRunLoopTimerHeapSiftDown(heap, __CFRunLoopTimerFindHeapSlot(rlt, heap)->index);
+        __CFRunLoopTimerHeapRearm(heap, armList);
+    }
+}
+
+static void __CFRunLoopTimerHeapRemoveAt(__CFRunLoopTimerHeap* heap, CFIndex index) {
+    CFRunLoopTimerRef last = heap->timers[--heap->count];
+    if (index != heap->count) {
+        __CFRunLoopTimerHeapSet(heap, index, last);
+        __CFRunLoopTimerHeapSiftUp(heap, index);
+        __CFRunLoopTimerHeapSiftDown(heap, __CFRunLoopTimerFindHeapSlot(last, heap)->index);
+    }
+}
+
+static CFIndex __CFRunLoopTimerHeapCollectDue(__CFRunLoopTimerHeap* heap, CFIndex index, int64_t cutoffTSR, CFRunLoopTimerRef* timers, CFIndex capacity, CFIndex count) {
+    // Children of a timer which is not due are not due either.
+    if (index >= heap->count || heap->timers[index]->_deadlineTSR > cutoffTSR) {
+        return count;
+    }
+    if (count < capacity) {
+        timers[count] = (CFRunLoopTimerRef)CFRetain(heap->timers[index]);
+    }
+    count++;
+    count = __CFRunLoopTimerHeapCollectDue(heap, 2 * index + 1, cutoffTSR, timers, capacity, count);
+    count = __CFRunLoopTimerHeapCollectDue(heap, 2 * index + 2, cutoffTSR, timers, capacity, count);
+    return count;
+}
+
+static CFComparisonResult __CFRunLoopTimerFireTSRComparator(const void* val1, const void* val2, void* context) {
+    CFRunLoopTimerRef rlt1 = *(CFRunLoopTimerRef*)val1;
+    CFRunLoopTimerRef rlt2 = *(CFRunLoopTimerRef*)val2;
+    if (rlt1->_fireTSR < rlt2->_fireTSR) {
+        return kCFCompareLessThan;
+    }
+    if (rlt1->_fireTSR > rlt2->_fireTSR) {
+        return kCFCompareGreaterThan;
+    }
+    return kCFCompareEqualTo;
 }
 
 /*** CFRunLoopTimer class ***/
@@ -95,9 +289,10 @@ static CFStringRef __CFRunLoopTimerCopyDescription(CFTypeRef cf) { /* DOES CALLO
     CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)cf;
     CFStringRef result;
     CFStringRef contextDesc = NULL;
-    int64_t fireTime;
+    int64_t fireTime, tolerance;
     __CFRunLoopTimerFireTSRLock();
     fireTime = rlt->_fireTSR;
+    tolerance = rlt->_toleranceTSR;
     __CFRunLoopTimerFireTSRUnlock();
     if (rlt->_context.copyDescription) {
         contextDesc = rlt->_context.copyDescription(rlt->_context.info);
@@ -113,10 +308,11 @@ static CFStringRef __CFRunLoopTimerCopyDescription(CFTypeRef cf) { /* DOES CALLO
     void* addr = (void*)rlt->_callout;
     result = CFStringCreateWithFormat(
             CFGetAllocator(rlt),
-            NULL, CFSTR("<CFRunLoopTimer %p [%p]>{valid = %s, interval = %0.09g, next fire date = %0.09g, order = %d, callout = %p, context = %@}"),
+            NULL, CFSTR("<CFRunLoopTimer %p [%p]>{valid = %s, interval = %0.09g, tolerance = %0.09g, next fire date = %0.09g, order = %d, callout = %p, context = %@}"),
             cf, CFGetAllocator(rlt),
             __CFIsValid(rlt) ? "Yes" : "No",
             _CFTSRToTimeInterval(rlt->_intervalTSR),
+            _CFTSRToTimeInterval(tolerance),
             now1 + _CFTSRToTimeInterval(fireTime - now2),
             rlt->_order,
             addr,
@@ -128,6 +324,9 @@ static CFStringRef __CFRunLoopTimerCopyDescription(CFTypeRef cf) { /* DOES CALLO
 static void __CFRunLoopTimerDeallocate(CFTypeRef cf) { /* DOES CALLOUT */
     CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)cf;
     CFRunLoopTimerInvalidate(rlt); /* DOES CALLOUT */
+    if (rlt->_heapSlots != &rlt->_inlineHeapSlot) {
+        CFAllocatorDeallocate(kCFAllocatorSystemDefault, rlt->_heapSlots);
+    }
 }
 
 static const CFRuntimeClass __CFRunLoopTimerClass = {
@@ -190,6 +389,7 @@ CF_INTERNAL Boolean __CFRunLoopTimerFire(CFRunLoopRef rl, CFRunLoopTimerRef rlt)
              * honor that new time here if it is a later date, otherwise
              * it is completely ignored. */
             int64_t currentFireTSR;
+            __CFRunLoopTimerHeap* armList = NULL;
             __CFRunLoopTimerFireTSRLock();
             currentFireTSR = rlt->_fireTSR;
             if (oldFireTSR < currentFireTSR) {
@@ -209,8 +409,9 @@ CF_INTERNAL Boolean __CFRunLoopTimerFire(CFRunLoopRef rl, CFRunLoopTimerRef rlt)
                     }
                 }
                 rlt->_fireTSR = currentFireTSR;
+                __CFRunLoopTimerReposition(rlt, &armList);
             }
-            __CFRunLoopTimerFireTSRUnlock();
+            __CFRunLoopTimerFireTSRUnlockAndArm(armList);
         }
     }
     CFRelease(rlt);
@@ -227,6 +428,152 @@ CF_INTERNAL int64_t __CFRunLoopTimerGetFireTSR(CFRunLoopTimerRef rlt) {
     return fireTSR;
 }
 
+CF_INTERNAL void __CFRunLoopTimerHeapInit(__CFRunLoopTimerHeap* heap, CFRunLoopPortRef port) {
+    heap->timers = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+    heap->port = port;
+    heap->armedTSR = 0;
+    heap->armLock = CFLockInit;
+    heap->armNext = NULL;
+}
+
+CF_INTERNAL void __CFRunLoopTimerHeapDestroy(__CFRunLoopTimerHeap* heap) {
+    __CFRunLoopTimerHeapRemoveAll(heap);
+    // Wait for other threads still arming the port.
+    CFLock(&heap->armLock);
+    CFUnlock(&heap->armLock);
+    if (heap->port) {
+        CFRelease(heap->port);
+        heap->port = NULL;
+    }
+}
+
+CF_INTERNAL CFIndex __CFRunLoopTimerHeapGetCount(__CFRunLoopTimerHeap* heap) {
+    CFIndex count;
+    __CFRunLoopTimerFireTSRLock();
+    count = heap->count;
+    __CFRunLoopTimerFireTSRUnlock();
+    return count;
+}
+
+CF_INTERNAL Boolean __CFRunLoopTimerHeapContains(__CFRunLoopTimerHeap* heap, CFRunLoopTimerRef rlt) {
+    Boolean contains;
+    __CFRunLoopTimerFireTSRLock();
+    contains = (__CFRunLoopTimerFindHeapSlot(rlt, heap) != NULL);
+    __CFRunLoopTimerFireTSRUnlock();
+    return contains;
+}
+
+CF_INTERNAL Boolean __CFRunLoopTimerHeapAdd(__CFRunLoopTimerHeap* heap, CFRunLoopTimerRef rlt) {
+    __CFRunLoopTimerHeap* armList = NULL;
+    CFRetain(rlt);
+    __CFRunLoopTimerFireTSRLock();
+    if (!__CFIsValid(rlt) || __CFRunLoopTimerFindHeapSlot(rlt, heap)) {
+        __CFRunLoopTimerFireTSRUnlock();
+        CFRelease(rlt);
+        return false;
+    }
+    if (heap->count == heap->capacity) {
+        CFIndex capacity = heap->capacity ? 2 * heap->capacity : 16;
+        CFRunLoopTimerRef* timers = (CFRunLoopTimerRef*)CFAllocatorReallocate(
+            kCFAllocatorSystemDefault,
+            heap->timers, capacity * sizeof(CFRunLoopTimerRef), 0);
+        if (!timers) {
+            __CFRunLoopTimerFireTSRUnlock();
+            CFRelease(rlt);
+            return false;
+        }
+        heap->timers = timers;
+        heap->capacity = capacity;
+    }
+    if (!__CFRunLoopTimerAddHeapSlot(rlt, heap)) {
+        __CFRunLoopTimerFireTSRUnlock();
+        CFRelease(rlt);
+        return false;
+    }
+    heap->timers[heap->count++] = rlt;
+    __CFRunLoopTimerHeapSiftUp(heap, heap->count - 1);
+    __CFRunLoopTimerHeapRearm(heap, &armList);
+    __CFRunLoopTimerFireTSRUnlockAndArm(armList);
+    return true;
+}
+
+CF_INTERNAL Boolean __CFRunLoopTimerHeapRemove(__CFRunLoopTimerHeap* heap, CFRunLoopTimerRef rlt) {
+    __CFRunLoopTimerHeap* armList = NULL;
+    __CFRunLoopTimerFireTSRLock();
+    __CFRunLoopTimerHeapSlot* slot = __CFRunLoopTimerFindHeapSlot(rlt, heap);
+    if (!slot) {
+        __CFRunLoopTimerFireTSRUnlock();
+        return false;
+    }
+    CFIndex index = slot->index;
+    __CFRunLoopTimerRemoveHeapSlot(rlt, slot);
+    __CFRunLoopTimerHeapRemoveAt(heap, index);
+    __CFRunLoopTimerHeapRearm(heap, &armList);
+    __CFRunLoopTimerFireTSRUnlockAndArm(armList);
+    CFRelease(rlt);
+    return true;
+}
+
+CF_INTERNAL void __CFRunLoopTimerHeapRemoveAll(__CFRunLoopTimerHeap* heap) {
+    CFRunLoopTimerRef* timers;
+    CFIndex idx, count;
+    __CFRunLoopTimerHeap* armList = NULL;
+    __CFRunLoopTimerFireTSRLock();
+    timers = heap->timers;
+    count = heap->count;
+    for (idx = 0; idx != count; ++idx) {
+        __CFRunLoopTimerRemoveHeapSlot(timers[idx], __CFRunLoopTimerFindHeapSlot(timers[idx], heap));
+    }
+    heap->timers = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+    __CFRunLoopTimerHeapRearm(heap, &armList);
+    __CFRunLoopTimerFireTSRUnlockAndArm(armList);
+    for (idx = 0; idx != count; ++idx) {
+        CFRelease(timers[idx]);
+    }
+    if (timers) {
+        CFAllocatorDeallocate(kCFAllocatorSystemDefault, timers);
+    }
+}
+
+/* Returns fire TSR of the timer which fires next, 0 if heap is empty. */
+CF_INTERNAL int64_t __CFRunLoopTimerHeapGetNextFireTSR(__CFRunLoopTimerHeap* heap) {
+    int64_t fireTSR;
+    __CFRunLoopTimerFireTSRLock();
+    fireTSR = heap->count ? heap->timers[0]->_fireTSR : 0;
+    __CFRunLoopTimerFireTSRUnlock();
+    return fireTSR;
+}
+
+/* Returns TSR at which run loop should wake up to fire timers, so that
+ *  all timers are fired within their tolerance windows. Returns 0 if
+ *  heap is empty.
+ */
+CF_INTERNAL int64_t __CFRunLoopTimerHeapGetWakeupTSR(__CFRunLoopTimerHeap* heap) {
+    int64_t wakeupTSR;
+    __CFRunLoopTimerFireTSRLock();
+    wakeupTSR = heap->count ? heap->timers[0]->_deadlineTSR : 0;
+    __CFRunLoopTimerFireTSRUnlock();
+    return wakeupTSR;
+}
+
+/* Stores (retained) timers with deadline not later than 'cutoffTSR' to
+ *  'timers', sorted by fire TSR. Returns total number of such timers,
+ *  which can be larger than 'capacity', in which case only 'capacity'
+ *  timers are stored.
+ */
+CF_INTERNAL CFIndex __CFRunLoopTimerHeapCopyDueTimers(__CFRunLoopTimerHeap* heap, int64_t cutoffTSR, CFRunLoopTimerRef* timers, CFIndex capacity) {
+    CFIndex count;
+    __CFRunLoopTimerFireTSRLock();
+    count = __CFRunLoopTimerHeapCollectDue(heap, 0, cutoffTSR, timers, capacity, 0);
+    CFQSortArray(timers, _CFMin(count, capacity), sizeof(CFRunLoopTimerRef), __CFRunLoopTimerFireTSRComparator, NULL);
+    __CFRunLoopTimerFireTSRUnlock();
+    return count;
+}
+
 ///////////////////////////////////////////////////////////////////// public
 
 CFTypeID CFRunLoopTimerGetTypeID(void) {
@@ -252,7 +599,7 @@ CFRunLoopTimerRef CFRunLoopTimerCreate(CFAllocatorRef allocator,
     __CFSetValid(instance);
     __CFRunLoopTimerUnsetFiring(instance);
     __CFRunLoopTimerUnsetDidFire(instance);
-    instance->_lock = CFSpinLockInit;
+    instance->_lock = CFLockInit;
     instance->_runLoop = NULL;
     instance->_rlCount = 0;
     instance->_order = order;
@@ -279,6 +626,11 @@ CFRunLoopTimerRef CFRunLoopTimerCreate(CFAllocatorRef allocator,
         instance->_intervalTSR = _CFTimeIntervalToTSR(interval);
     }
     instance->_callout = callout;
+    instance->_toleranceTSR = 0;
+    instance->_deadlineTSR = instance->_fireTSR;
+    instance->_heapCount = 0;
+    instance->_heapCapacity = 1;
+    instance->_heapSlots = &instance->_inlineHeapSlot;
     if (context) {
         if (context->retain) {
             instance->_context.info = (void*)context->retain(context->info);
@@ -316,6 +668,7 @@ CFAbsoluteTime CFRunLoopTimerGetNextFireDate(CFRunLoopTimerRef rlt) {
 }
 
 void CFRunLoopTimerSetNextFireDate(CFRunLoopTimerRef rlt, CFAbsoluteTime fireDate) {
+    __CFRunLoopTimerHeap* armList = NULL;
     __CFRunLoopTimerFireTSRLock();
     int64_t now2 = _CFReadTSR();
     CFAbsoluteTime now1 = CFAbsoluteTimeGetCurrent();
@@ -329,7 +682,8 @@ void CFRunLoopTimerSetNextFireDate(CFRunLoopTimerRef rlt, CFAbsoluteTime fireDat
     } else {
         rlt->_fireTSR = now2 + _CFTimeIntervalToTSR(fireDate - now1);
     }
-    __CFRunLoopTimerFireTSRUnlock();
+    __CFRunLoopTimerReposition(rlt, &armList);
+    __CFRunLoopTimerFireTSRUnlockAndArm(armList);
 }
 
 CFTimeInterval CFRunLoopTimerGetInterval(CFRunLoopTimerRef rlt) {
@@ -344,6 +698,34 @@ Boolean CFRunLoopTimerDoesRepeat(CFRunLoopTimerRef rlt) {
     return (rlt->_intervalTSR != 0);
 }
 
+CFTimeInterval CFRunLoopTimerGetTolerance(CFRunLoopTimerRef rlt) {
+    int64_t tolerance;
+    CF_VALIDATE_RLTIMER_ARG(rlt);
+    __CFRunLoopTimerFireTSRLock();
+    tolerance = rlt->_toleranceTSR;
+    __CFRunLoopTimerFireTSRUnlock();
+    return _CFTSRToTimeInterval(tolerance);
+}
+
+void CFRunLoopTimerSetTolerance(CFRunLoopTimerRef rlt, CFTimeInterval tolerance) {
+    __CFRunLoopTimerHeap* armList = NULL;
+    CF_VALIDATE_RLTIMER_ARG(rlt);
+    if (!(tolerance > 0.0)) {
+        tolerance = 0.0;
+    }
+    // Repeating timer must not drift into its next period.
+    if (rlt->_intervalTSR && tolerance > _CFTSRToTimeInterval(rlt->_intervalTSR) / 2) {
+        tolerance = _CFTSRToTimeInterval(rlt->_intervalTSR) / 2;
+    }
+    if (tolerance > _CFTSRToTimeInterval(LLONG_MAX / 2)) {
+        tolerance = _CFTSRToTimeInterval(LLONG_MAX / 2);
+    }
+    __CFRunLoopTimerFireTSRLock();
+    rlt->_toleranceTSR = _CFTimeIntervalToTSR(tolerance);
+    __CFRunLoopTimerReposition(rlt, &armList);
+    __CFRunLoopTimerFireTSRUnlockAndArm(armList);
+}
+
 CFIndex CFRunLoopTimerGetOrder(CFRunLoopTimerRef rlt) {
     CF_OBJC_FUNCDISPATCH(CFIndex, rlt, "order");
     CF_VALIDATE_RLTIMER_ARG(rlt);
@@ -361,6 +743,25 @@ void CFRunLoopTimerInvalidate(CFRunLoopTimerRef rlt) {  /* DOES CALLOUT */
         __CFUnsetValid(rlt);
         rlt->_context.info = NULL;
         __CFRunLoopTimerUnlock(rlt);
+        {
+            // Timer is retained by each heap it is in.
+            CFIndex removed = 0;
+            __CFRunLoopTimerHeap* armList = NULL;
+            __CFRunLoopTimerFireTSRLock();
+            while (rlt->_heapCount) {
+                __CFRunLoopTimerHeapSlot* slot = &rlt->_heapSlots[rlt->_heapCount - 1];
+                __CFRunLoopTimerHeap* heap = slot->heap;
+                CFIndex index = slot->index;
+                __CFRunLoopTimerRemoveHeapSlot(rlt, slot);
+                __CFRunLoopTimerHeapRemoveAt(heap, index);
+                __CFRunLoopTimerHeapRearm(heap, &armList);
+                removed++;
+            }
+            __CFRunLoopTimerFireTSRUnlockAndArm(armList);
+            while (removed--) {
+                CFRelease(rlt);
+            }
+        }
         if (rl) {
             CFArrayRef array;
             CFIndex idx;
@@ -37,7 +37,7 @@ typedef struct {
     const void* mutableClass;
 } __CFObjcClass;
 
-static CFSpinLock_t __CFClassTableGuard = CFSpinLockInit;
+static CFLock_t __CFClassTableGuard = CFLockInit;
 static CFRuntimeClass const** __CFClassTable = NULL;
 static CFIndex __CFClassTableSize = 0;
 static CFIndex __CFClassTableCount = 0;
@@ -64,6 +64,8 @@ static uint32_t __CFZombieLevel = 0x0;
 
 static CFRuntimeErrorHandler __CFRuntimeErrorHandler = NULL;
 
+CF_INTERNAL CFTypeID _CFTaggedPointerTypeIDs[_kCFTaggedPointerTagCount] = {0};
+
 ///////////////////////////////////////////////////////////////////// private
 
 static void __CFSetClassInvalid(CFIndex index) {
@@ -84,6 +86,21 @@ static void __CFSetClassTableCount(CFIndex count) {
     }
 }
 
+/* Instances created with non-default allocators are prefixed with
+ *  the allocator ref. When statistics are enabled the allocation size
+ *  is stored before it, since there is no other way to get it back.
+ */
+static CFIndex __CFRuntimeGetHeadSize(void) {
+    return sizeof(CFAllocatorRef) + (_CFRuntimeStatisticsEnabled ? sizeof(CFIndex) : 0);
+}
+
+static CFIndex __CFRuntimeGetBlockSize(const void* block, Boolean usesSystemDefaultAllocator) {
+    if (!usesSystemDefaultAllocator) {
+        return *(const CFIndex*)block;
+    }
+    return _CFSlabContains(block) ? _CFSlabGetSize(block) : (CFIndex)malloc_size(block);
+}
+
 static void __CFDefaultRuntimeErrorHandler(CFStringRef errorType, CFStringRef message) {
     CFLog(kCFLogLevelError, CFSTR("%@: %@"), errorType, message);
 
@@ -102,10 +119,10 @@ CFTypeID _CFRuntimeRegisterClassBridge2(const CFRuntimeClass* const cls,
                                         const char* objcClassName,
                                         const char* mutableObjcClassName)
 {
-    CFSpinLock(&__CFClassTableGuard);
+    CFLock(&__CFClassTableGuard);
 
     if (__CFMaxRuntimeTypes <= __CFClassTableCount) {
-        CFSpinUnlock(&__CFClassTableGuard);
+        CFUnlock(&__CFClassTableGuard);
         
         CFReportRuntimeError(kCFRuntimeErrorFatal,
             CFSTR("class table full; registration failing for class '%s'"),
@@ -170,14 +187,14 @@ CFTypeID _CFRuntimeRegisterClassBridge2(const CFRuntimeClass* const cls,
         __CFObjCClassTable[typeID] = __CFObjCClassTable[0];
     }
 
-    CFSpinUnlock(&__CFClassTableGuard);
+    CFUnlock(&__CFClassTableGuard);
 
     return typeID;
 }
 
 CF_INTERNAL
 CFAllocatorRef _CFRuntimeGetInstanceAllocator(CFTypeRef cf) {
-    if (CF_INFO(cf) & 0x80) {
+    if (_CFIsTaggedPointer(cf) || (CF_INFO(cf) & 0x80)) {
         return kCFAllocatorSystemDefault;
     }
     CFAllocatorRef* head = CF_CONST_CAST(CFAllocatorRef*, cf) - 1;
@@ -203,11 +220,26 @@ CF_INTERNAL
 void _CFRuntimeDestroyInstance(CFTypeRef cf) {
     CFAllocatorRef allocator = CFGetAllocator(cf);
     Boolean usesSystemDefaultAllocator = (allocator == kCFAllocatorSystemDefault);
-    CFIndex headOffset = (usesSystemDefaultAllocator ? 0 : sizeof(CFAllocatorRef));
+    CFIndex headOffset = (usesSystemDefaultAllocator ? 0 : __CFRuntimeGetHeadSize());
+
+    if (_CFRuntimeStatisticsEnabled) {
+        const void* block = (const uint8_t*)cf - headOffset;
+        _CFRuntimeStatisticsRecordDestroy(CF_TYPEID(cf),
+            __CFRuntimeGetBlockSize(block, usesSystemDefaultAllocator));
+    }
+
+    // Covers slab and arena blocks, which don't go through CFAllocatorDeallocate().
+    _CFHeapProfileRecordDeallocation((const uint8_t*)cf - headOffset);
+
+    if (!usesSystemDefaultAllocator && _CFAllocatorIsArena(allocator)) {
+        // Memory is reclaimed by CFAllocatorArenaReset(), and arena
+        //  is not retained by its objects.
+        return;
+    }
     
     if (__CFZombieLevel & __kCFZombieLevelScribble) {
         uint8_t* ptr = (uint8_t*)cf - headOffset;
-        size_t size = malloc_size(ptr);
+        size_t size = _CFSlabContains(ptr) ? (size_t)_CFSlabGetSize(ptr) : malloc_size(ptr);
         uint8_t byte = 0xFC;
         if (__CFZombieLevel & __kCFZombieLevelDontScribbleHeader) {
             ptr = (uint8_t*)cf + sizeof(CFRuntimeBase);
@@ -219,7 +251,11 @@ void _CFRuntimeDestroyInstance(CFTypeRef cf) {
         memset(ptr, byte, size);
     }
     if (!(__CFZombieLevel & __kCFZombieLevelDontFree)) {
-        CFAllocatorDeallocate(allocator, (uint8_t*)cf - headOffset);
+        if (usesSystemDefaultAllocator && _CFSlabContains(cf)) {
+            _CFSlabDeallocate((void*)cf);
+        } else {
+            CFAllocatorDeallocate(allocator, (uint8_t*)cf - headOffset);
+        }
     }
     if (kCFAllocatorSystemDefault != allocator) {
         CFRelease(allocator);
@@ -228,11 +264,38 @@ void _CFRuntimeDestroyInstance(CFTypeRef cf) {
 
 CF_INTERNAL
 Boolean _CFRuntimeIsInstanceOf(CFTypeRef cf, CFTypeID typeID) {
+    if (_CFIsTaggedPointer(cf)) {
+        return typeID != _kCFRuntimeNotATypeID && typeID == _CFTaggedPointerGetTypeID(cf);
+    }
     return typeID >= 0 && typeID < (CFTypeID)__CFClassTableCount && (
             CF_BASE(cf)->_cfisa == __CFObjCClassTable[typeID].standardClass ||
             CF_BASE(cf)->_cfisa == __CFObjCClassTable[typeID].mutableClass);
 }
 
+CF_INTERNAL
+CFTypeID _CFRuntimeRegisterClassOnce(CFTypeID* typeID, const CFRuntimeClass* cls, void (*initialize)(void)) {
+    static CFLock_t lock = CFLockInit;
+    CFTypeID result;
+    CFLock(&lock);
+    result = *typeID;
+    if (result == _kCFRuntimeNotATypeID) {
+        result = _CFRuntimeRegisterClass(cls);
+        if (initialize) {
+            initialize();
+        }
+        // Class must be complete before others see the type ID,
+        //  pairs with _CFRuntimeLoadTypeID().
+        __atomic_store_n(typeID, result, __ATOMIC_RELEASE);
+    }
+    CFUnlock(&lock);
+    return result;
+}
+
+CF_INTERNAL
+void _CFRuntimeRegisterTaggedClass(uintptr_t tag, CFTypeID typeID) {
+    _CFTaggedPointerTypeIDs[tag] = typeID;
+}
+
 CF_INTERNAL
 void _CFRuntimeSetMutableObjcClass(CFTypeRef cf) {
 	CF_BASE(cf)->_cfisa = __CFObjCClassTable[CF_TYPEID(cf)].mutableClass;
@@ -249,11 +312,11 @@ CFTypeID _CFRuntimeRegisterClassBridge(const CFRuntimeClass * const cls, const c
 }
 
 void _CFRuntimeUnregisterClassWithTypeID(CFTypeID typeID) {
-    CFSpinLock(&__CFClassTableGuard);
+    CFLock(&__CFClassTableGuard);
     if (__CFIsValidTypeID(typeID)) {
         __CFSetClassInvalid(typeID);
     }
-    CFSpinUnlock(&__CFClassTableGuard);
+    CFUnlock(&__CFClassTableGuard);
 }
 
 const CFRuntimeClass* _CFRuntimeGetClassWithTypeID(CFTypeID typeID) {
@@ -276,25 +339,53 @@ CFTypeRef _CFRuntimeCreateInstance(CFAllocatorRef allocator,
     if (!usesSystemDefaultAllocator) {
         // Add space to hold allocator ref for non-standard allocators.
         // This screws up 8 byte alignment but seems to work.
-        size += sizeof(CFAllocatorRef);
+        size += __CFRuntimeGetHeadSize();
     }
     
     size = (size + 0xF) & ~0xF; // CF objects are multiples of 16 in size
-    CFRuntimeBase* object = (CFRuntimeBase*)CFAllocatorAllocate(allocator, size, 0);
+    CFRuntimeBase* object = NULL;
+    if (usesSystemDefaultAllocator) {
+        object = (CFRuntimeBase*)_CFSlabAllocate(size);
+    }
     if (!object) {
-        return NULL;
+        object = (CFRuntimeBase*)CFAllocatorAllocate(allocator, size, 0);
+        if (!object) {
+            return NULL;
+        }
+        if (_CFHeapProfileRate) {
+            _CFHeapProfileSetSampleTypeID(object, typeID);
+        }
+    } else if (_CFHeapProfileRate) {
+        _CFHeapProfileRecordAllocation(object, size, typeID);
     }
 
     memset(object, 0, size);
     
+    if (_CFRuntimeStatisticsEnabled) {
+        CFIndex blockSize = size;
+        if (usesSystemDefaultAllocator) {
+            blockSize = __CFRuntimeGetBlockSize(object, true);
+        } else {
+            *(CFIndex*)object = size;
+            object = (CFRuntimeBase*)((CFIndex*)object + 1);
+        }
+        _CFRuntimeStatisticsRecordCreate(typeID, blockSize);
+    }
+    
     if (!usesSystemDefaultAllocator) {
         // Remember allocator.
         CFAllocatorRef* head = (CFAllocatorRef*)object;
-        *head = (CFAllocatorRef)CFRetain(allocator);
+        if (_CFAllocatorIsArena(allocator)) {
+            // Arena objects don't outlive arena, see _CFRuntimeDestroyInstance().
+            *head = allocator;
+        } else {
+            *head = (CFAllocatorRef)CFRetain(allocator);
+        }
         object = (CFRuntimeBase*)(head + 1);
     }
 
     _CFRuntimeInitInstance(allocator, object, typeID);
+    _CFRCInitInstance(object);
 
     return object;
 }
@@ -304,7 +395,7 @@ void _CFRuntimeInitStaticInstance(void* object, CFTypeID typeID) {
 }
 
 void _CFRuntimeSetInstanceTypeID(CFTypeRef cf, CFTypeID typeID) {
-    CF_FULLINFO(cf) = CF_MAKE_FULLINFO(typeID, CF_INFO(cf));
+    CF_FULLINFO(cf) = CF_MAKE_FULLINFO(typeID, CF_INFO(cf)) | (CF_FULLINFO(cf) & 0xFF000000);
     CF_BASE(cf)->_cfisa = __CFObjCClassTable[typeID].standardClass;
 }
 
@@ -326,6 +417,9 @@ void _CFInitialize(void) {
         }
     }
     
+    _CFRuntimeStatisticsInitialize();
+    _CFHeapProfileInitialize();
+
     __CFClassTableSize = 1024;
     __CFClassTableCount = 0;
     __CFClassTable = (CFRuntimeClass const**)calloc(__CFClassTableSize, sizeof(CFRuntimeClass const*));
@@ -357,10 +451,7 @@ void _CFInitialize(void) {
     _CFNullInitialize();
     _CFBooleanInitialize();
     _CFNumberInitialize();
-	_CFNumberFormatterInitialize();
     _CFDateInitialize();
-	_CFDateFormatterInitialize();
-    __CFTimeZoneInitialize();
     //__CFBinaryHeapInitialize();
     //_CFBitVectorInitialize();
     _CFCharacterSetInitialize();
@@ -375,9 +466,11 @@ void _CFInitialize(void) {
     __CFRunLoopObserverInitialize();
     __CFRunLoopSourceInitialize();
     __CFRunLoopTimerInitialize();
+    __CFFileDescriptorInitialize();
+    __CFRunLoopGroupInitialize();
     //__CFSocketInitialize();
-	_CFLocaleInitialize();
-	_CFCalendarInitialize();
+    // CFCalendar, CFLocale, CFTimeZone and formatters are registered
+    //  on first use, see _CFRuntimeRegisterClassOnce().
     
     __CFSetClassTableCount(256);
 }
@@ -182,6 +182,79 @@ CFTypeID _CFRuntimeRegisterClassBridge2(const CFRuntimeClass* cls,
 CF_EXPORT
 void _CFRuntimeSetMutableObjcClass(CFTypeRef cf);
 
+/* Registers 'cls' on the first call and publishes its type ID in '*typeID',
+ *  calling 'initialize' (if not NULL) before that. Used by classes which
+ *  are registered on first use (from their GetTypeID()) rather than by
+ *  _CFInitialize(), see CFCalendarGetTypeID() for example.
+ */
+CF_EXPORT
+CFTypeID _CFRuntimeRegisterClassOnce(CFTypeID* typeID, const CFRuntimeClass* cls, void (*initialize)(void));
+
+/* Reads type ID published by _CFRuntimeRegisterClassOnce() without taking
+ *  the lock. Acquire load makes the registered class and everything done
+ *  by 'initialize' visible once the type ID is seen.
+ */
+CF_INLINE CFTypeID _CFRuntimeLoadTypeID(const CFTypeID* typeID) {
+    return __atomic_load_n(typeID, __ATOMIC_ACQUIRE);
+}
+
+/* Makes pointers with the 'tag' to be instances of 'typeID' class,
+ *  see CFBaseInternal.h.
+ */
+CF_EXPORT
+void _CFRuntimeRegisterTaggedClass(uintptr_t tag, CFTypeID typeID);
+
+/* Statistics, see CFRuntime_Statistics.c.
+ * _CFRuntimeStatisticsEnabled is set once by _CFRuntimeStatisticsInitialize()
+ *  and never changes afterwards, so instance layout is stable.
+ */
+CF_EXPORT Boolean _CFRuntimeStatisticsEnabled;
+
+CF_EXPORT void _CFRuntimeStatisticsInitialize(void);
+CF_EXPORT void _CFRuntimeStatisticsRecordCreate(CFTypeID typeID, CFIndex size);
+CF_EXPORT void _CFRuntimeStatisticsRecordDestroy(CFTypeID typeID, CFIndex size);
+
+/* Heap profiling, see CFRuntime_HeapProfile.c.
+ * Allocations are sampled only at the outermost level, i.e. allocations
+ *  made by allocator callbacks (and tracked by _heapProfileDepth) are
+ *  attributed to the outer allocation.
+ * Sampled blocks are marked in the filter, so that deallocation of most
+ *  blocks costs a single byte load.
+ */
+enum {
+    _kCFHeapProfileFilterSize = 1 << 16
+};
+
+CF_EXPORT CFIndex _CFHeapProfileRate;
+CF_EXPORT volatile int32_t _CFHeapProfileLiveSampleCount;
+CF_EXPORT uint8_t _CFHeapProfileFilter[_kCFHeapProfileFilterSize];
+
+CF_EXPORT void _CFHeapProfileInitialize(void);
+CF_EXPORT void _CFHeapProfileAddSample(const void* block, CFIndex size, CFTypeID typeID);
+CF_EXPORT void _CFHeapProfileRemoveSample(const void* block);
+CF_EXPORT void _CFHeapProfileSetSampleTypeID(const void* block, CFTypeID typeID);
+
+CF_INLINE CFIndex _CFHeapProfileGetFilterIndex(const void* block) {
+    return (CFIndex)(((uint32_t)((uintptr_t)block >> 4) * 2654435761U) >> 16);
+}
+
+CF_INLINE void _CFHeapProfileRecordAllocation(const void* block, CFIndex size, CFTypeID typeID) {
+    if (!_CFThreadData._heapProfileDepth) {
+        _CFThreadData._heapProfileCountdown -= size;
+        if (_CFThreadData._heapProfileCountdown < 0) {
+            _CFHeapProfileAddSample(block, size, typeID);
+        }
+    }
+}
+
+CF_INLINE void _CFHeapProfileRecordDeallocation(const void* block) {
+    if (_CFHeapProfileLiveSampleCount &&
+        _CFHeapProfileFilter[_CFHeapProfileGetFilterIndex(block)])
+    {
+        _CFHeapProfileRemoveSample(block);
+    }
+}
+
 CF_EXTERN_C_END
 
 #endif /* !__COREFOUNDATION_CFRUNTIMEINTERNAL__ */
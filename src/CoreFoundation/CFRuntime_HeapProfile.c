@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CFInternal.h"
+#include <CoreFoundation/CFData.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Heap profiler
+ *
+ * Each thread counts allocated bytes down from a random interval, which
+ *  is exponentially distributed with the mean equal to the rate. When
+ *  the countdown goes negative the allocation is sampled: its backtrace
+ *  is taken and the sample is put into the live sample table keyed by
+ *  block address. Samples are accounted in buckets keyed by type ID and
+ *  backtrace; buckets are never freed.
+ * Tables are allocated with malloc() and guarded by a single lock, which
+ *  is never held while calling CF, so that sampling doesn't recurse into
+ *  itself.
+ * The filter is a counting filter over block addresses: counters are
+ *  incremented for each live sample (and stick when they reach 255), so
+ *  a zero counter means that the block is definitely not sampled.
+ */
+
+enum {
+    __kCFHeapProfileMaxDepth = 32,
+    __kCFHeapProfileBucketTableSize = 4096,
+    __kCFHeapProfileSampleTableSize = 4096
+};
+
+typedef struct __CFHeapProfileBucket {
+    struct __CFHeapProfileBucket* next;
+    struct __CFHeapProfileBucket* nextInList;
+    CFHashCode hash;
+    CFTypeID typeID;
+    CFIndex depth;
+    int64_t liveCount;
+    int64_t liveBytes;
+    int64_t allocationCount;
+    int64_t allocatedBytes;
+    void* frames[__kCFHeapProfileMaxDepth];
+} __CFHeapProfileBucket;
+
+typedef struct __CFHeapProfileSample {
+    struct __CFHeapProfileSample* next;
+    const void* block;
+    CFIndex size;
+    __CFHeapProfileBucket* bucket;
+} __CFHeapProfileSample;
+
+CF_INTERNAL CFIndex _CFHeapProfileRate = 0;
+CF_INTERNAL volatile int32_t _CFHeapProfileLiveSampleCount = 0;
+CF_INTERNAL uint8_t _CFHeapProfileFilter[_kCFHeapProfileFilterSize];
+
+static Boolean __CFHeapProfileWasEnabled = false;
+
+static CFLock_t __CFHeapProfileLock = CFLockInit;
+static __CFHeapProfileBucket* __CFHeapProfileBuckets[__kCFHeapProfileBucketTableSize];
+static __CFHeapProfileBucket* __CFHeapProfileBucketList = NULL;
+static CFIndex __CFHeapProfileBucketCount = 0;
+static __CFHeapProfileSample* __CFHeapProfileSamples[__kCFHeapProfileSampleTableSize];
+
+///////////////////////////////////////////////////////////////////// private
+
+static void __CFHeapProfileSeedThread(void) {
+    uint64_t seed = (uint64_t)(uintptr_t)&_CFThreadData;
+    seed ^= (uint64_t)CFPlatformReadTSR() * 0x9E3779B97F4A7C15ULL;
+    _CFThreadData._heapProfileSeed = seed ? seed : 1;
+}
+
+static int64_t __CFHeapProfileNextInterval(void) {
+    CFIndex rate = _CFHeapProfileRate;
+    uint64_t x = _CFThreadData._heapProfileSeed;
+    double u;
+    if (!rate) {
+        return INT64_MAX;
+    }
+    // xorshift64
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    _CFThreadData._heapProfileSeed = x;
+
+    // Top 53 bits give uniform value in (0, 1].
+    u = (double)((x >> 11) + 1) * (1.0 / 9007199254740992.0);
+    return (int64_t)(-log(u) * (double)rate);
+}
+
+CF_INLINE CFIndex __CFHeapProfileGetSampleIndex(const void* block) {
+    return _CFHeapProfileGetFilterIndex(block) & (__kCFHeapProfileSampleTableSize - 1);
+}
+
+static CFHashCode __CFHeapProfileHashStack(CFTypeID typeID, void* const* frames, CFIndex depth) {
+    CFHashCode hash = (CFHashCode)typeID;
+    CFIndex i;
+    for (i = 0; i != depth; ++i) {
+        hash = hash * 257 + (CFHashCode)((uintptr_t)frames[i] >> 2);
+    }
+    return hash;
+}
+
+// Must be called under the lock. Returns NULL if out of memory.
+static __CFHeapProfileBucket* __CFHeapProfileGetBucket(CFTypeID typeID, void* const* frames, CFIndex depth) {
+    CFHashCode hash = __CFHeapProfileHashStack(typeID, frames, depth);
+    __CFHeapProfileBucket** head = &__CFHeapProfileBuckets[hash & (__kCFHeapProfileBucketTableSize - 1)];
+    __CFHeapProfileBucket* bucket;
+    for (bucket = *head; bucket; bucket = bucket->next) {
+        if (bucket->hash == hash &&
+            bucket->typeID == typeID &&
+            bucket->depth == depth &&
+            !memcmp(bucket->frames, frames, depth * sizeof(void*)))
+        {
+            return bucket;
+        }
+    }
+    bucket = (__CFHeapProfileBucket*)calloc(1, sizeof(__CFHeapProfileBucket));
+    if (!bucket) {
+        return NULL;
+    }
+    bucket->hash = hash;
+    bucket->typeID = typeID;
+    bucket->depth = depth;
+    memcpy(bucket->frames, frames, depth * sizeof(void*));
+    bucket->next = *head;
+    *head = bucket;
+    bucket->nextInList = __CFHeapProfileBucketList;
+    __CFHeapProfileBucketList = bucket;
+    __CFHeapProfileBucketCount++;
+    return bucket;
+}
+
+CF_INLINE void __CFHeapProfileAccount(__CFHeapProfileBucket* bucket, CFIndex size, int64_t delta) {
+    bucket->liveCount += delta;
+    bucket->liveBytes += delta * size;
+    bucket->allocationCount += delta;
+    bucket->allocatedBytes += delta * size;
+}
+
+// Must be called under the lock.
+static __CFHeapProfileSample* __CFHeapProfileFindSample(const void* block, Boolean detach) {
+    __CFHeapProfileSample** link = &__CFHeapProfileSamples[__CFHeapProfileGetSampleIndex(block)];
+    for (; *link; link = &(*link)->next) {
+        __CFHeapProfileSample* sample = *link;
+        if (sample->block == block) {
+            if (detach) {
+                *link = sample->next;
+            }
+            return sample;
+        }
+    }
+    return NULL;
+}
+
+static void __CFHeapProfileAppendFormat(CFMutableDataRef data, const char* format, ...) {
+    char buffer[128];
+    va_list arguments;
+    int length;
+    va_start(arguments, format);
+    length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+    if (length > 0) {
+        CFDataAppendBytes(data, (const UInt8*)buffer,
+            (length < (int)sizeof(buffer)) ? length : (int)sizeof(buffer) - 1);
+    }
+}
+
+///////////////////////////////////////////////////////////////////// internal
+
+CF_INTERNAL
+void _CFHeapProfileInitialize(void) {
+    const char* value = getenv("CFHeapProfileRate");
+    if (value) {
+        CFIndex rate = (CFIndex)strtol(value, NULL, 0);
+        if (rate > 0) {
+            CFRuntimeSetHeapProfileRate(rate);
+        }
+    }
+}
+
+CF_INTERNAL
+void _CFHeapProfileAddSample(const void* block, CFIndex size, CFTypeID typeID) {
+    void* frames[__kCFHeapProfileMaxDepth];
+    CFIndex depth;
+    __CFHeapProfileSample* sample;
+    __CFHeapProfileBucket* bucket;
+    CFIndex filterIndex;
+
+    if (!_CFThreadData._heapProfileSeed) {
+        // First allocation on this thread only starts the countdown.
+        __CFHeapProfileSeedThread();
+        _CFThreadData._heapProfileCountdown = __CFHeapProfileNextInterval();
+        return;
+    }
+    _CFThreadData._heapProfileCountdown = __CFHeapProfileNextInterval();
+    if (!_CFHeapProfileRate) {
+        return;
+    }
+
+    depth = CFPlatformGetBacktrace(frames, __kCFHeapProfileMaxDepth, 1);
+    sample = (__CFHeapProfileSample*)malloc(sizeof(__CFHeapProfileSample));
+    if (!sample) {
+        return;
+    }
+    sample->block = block;
+    sample->size = size;
+
+    CFLock(&__CFHeapProfileLock);
+    bucket = __CFHeapProfileGetBucket(typeID, frames, depth);
+    if (bucket) {
+        CFIndex index = __CFHeapProfileGetSampleIndex(block);
+        __CFHeapProfileAccount(bucket, size, 1);
+        sample->bucket = bucket;
+        sample->next = __CFHeapProfileSamples[index];
+        __CFHeapProfileSamples[index] = sample;
+        filterIndex = _CFHeapProfileGetFilterIndex(block);
+        if (_CFHeapProfileFilter[filterIndex] != UINT8_MAX) {
+            _CFHeapProfileFilter[filterIndex]++;
+        }
+        _CFHeapProfileLiveSampleCount++;
+        sample = NULL;
+    }
+    CFUnlock(&__CFHeapProfileLock);
+
+    free(sample);
+}
+
+CF_INTERNAL
+void _CFHeapProfileRemoveSample(const void* block) {
+    __CFHeapProfileSample* sample;
+    CFLock(&__CFHeapProfileLock);
+    sample = __CFHeapProfileFindSample(block, true);
+    if (sample) {
+        CFIndex filterIndex = _CFHeapProfileGetFilterIndex(block);
+        sample->bucket->liveCount--;
+        sample->bucket->liveBytes -= sample->size;
+        if (_CFHeapProfileFilter[filterIndex] != UINT8_MAX) {
+            _CFHeapProfileFilter[filterIndex]--;
+        }
+        _CFHeapProfileLiveSampleCount--;
+    }
+    CFUnlock(&__CFHeapProfileLock);
+    free(sample);
+}
+
+/* Moves sample of the just allocated instance block from the untyped
+ *  bucket (where CFAllocatorAllocate() put it) to the typed one.
+ */
+CF_INTERNAL
+void _CFHeapProfileSetSampleTypeID(const void* block, CFTypeID typeID) {
+    __CFHeapProfileSample* sample;
+    if (!_CFHeapProfileFilter[_CFHeapProfileGetFilterIndex(block)]) {
+        return;
+    }
+    CFLock(&__CFHeapProfileLock);
+    sample = __CFHeapProfileFindSample(block, false);
+    if (sample && sample->bucket->typeID != typeID) {
+        __CFHeapProfileBucket* bucket = __CFHeapProfileGetBucket(
+            typeID, sample->bucket->frames, sample->bucket->depth);
+        if (bucket) {
+            __CFHeapProfileAccount(sample->bucket, sample->size, -1);
+            __CFHeapProfileAccount(bucket, sample->size, 1);
+            sample->bucket = bucket;
+        }
+    }
+    CFUnlock(&__CFHeapProfileLock);
+}
+
+///////////////////////////////////////////////////////////////////// public
+
+void CFRuntimeSetHeapProfileRate(CFIndex rate) {
+    CF_VALIDATE_NONNEGATIVE_ARG(rate);
+    if (rate) {
+        __CFHeapProfileWasEnabled = true;
+    }
+    _CFHeapProfileRate = rate;
+}
+
+CFIndex CFRuntimeGetHeapProfileRate(void) {
+    return _CFHeapProfileRate;
+}
+
+CFDataRef CFRuntimeCopyHeapProfile(CFTypeID typeID) {
+    __CFHeapProfileBucket* buckets;
+    __CFHeapProfileBucket* bucket;
+    CFIndex count = 0;
+    CFIndex i;
+    int64_t liveCount = 0, liveBytes = 0, allocationCount = 0, allocatedBytes = 0;
+    CFMutableDataRef profile;
+    CFDataRef memoryMap;
+
+    if (!__CFHeapProfileWasEnabled) {
+        return NULL;
+    }
+
+    // Snapshot buckets, CF can't be called under the lock.
+    CFLock(&__CFHeapProfileLock);
+    buckets = (__CFHeapProfileBucket*)malloc(
+        (__CFHeapProfileBucketCount + 1) * sizeof(__CFHeapProfileBucket));
+    if (buckets) {
+        for (bucket = __CFHeapProfileBucketList; bucket; bucket = bucket->nextInList) {
+            if (typeID == _kCFRuntimeNotATypeID || bucket->typeID == typeID) {
+                buckets[count++] = *bucket;
+            }
+        }
+    }
+    CFUnlock(&__CFHeapProfileLock);
+    if (!buckets) {
+        return NULL;
+    }
+
+    for (i = 0; i != count; ++i) {
+        liveCount += buckets[i].liveCount;
+        liveBytes += buckets[i].liveBytes;
+        allocationCount += buckets[i].allocationCount;
+        allocatedBytes += buckets[i].allocatedBytes;
+    }
+
+    profile = CFDataCreateMutable(kCFAllocatorSystemDefault, 0);
+    __CFHeapProfileAppendFormat(profile,
+        "heap profile: %lld: %lld [%lld: %lld] @ heap_v2/%ld\n",
+        (long long)liveCount, (long long)liveBytes,
+        (long long)allocationCount, (long long)allocatedBytes,
+        (long)_CFHeapProfileRate);
+    for (i = 0; i != count; ++i) {
+        CFIndex frame;
+        if (!buckets[i].allocationCount) {
+            continue;
+        }
+        __CFHeapProfileAppendFormat(profile,
+            "%lld: %lld [%lld: %lld] @",
+            (long long)buckets[i].liveCount, (long long)buckets[i].liveBytes,
+            (long long)buckets[i].allocationCount, (long long)buckets[i].allocatedBytes);
+        for (frame = 0; frame != buckets[i].depth; ++frame) {
+            __CFHeapProfileAppendFormat(profile,
+                " 0x%llx", (unsigned long long)(uintptr_t)buckets[i].frames[frame]);
+        }
+        CFDataAppendBytes(profile, (const UInt8*)"\n", 1);
+    }
+    free(buckets);
+
+    memoryMap = CFPlatformCopyMemoryMap();
+    if (memoryMap) {
+        static const char header[] = "\nMAPPED_LIBRARIES:\n";
+        CFDataAppendBytes(profile, (const UInt8*)header, sizeof(header) - 1);
+        CFDataAppendBytes(profile, CFDataGetBytePtr(memoryMap), CFDataGetLength(memoryMap));
+        CFRelease(memoryMap);
+    }
+    return profile;
+}
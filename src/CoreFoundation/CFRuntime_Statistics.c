@@ -0,0 +1,390 @@
+/*
+ * Copyright (C) 2011 Dmitry Skiba
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CFInternal.h"
+#include <CoreFoundation/CFNumber.h>
+#include <CoreFoundation/CFRunLoop.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* Runtime statistics
+ *
+ * Each thread has its own array of counters indexed by type ID, which
+ *  only that thread writes to. Other threads read the counters while
+ *  they are being updated, so the counters are accessed with relaxed
+ *  atomics to avoid torn 64-bit values on 32-bit platforms (a plain
+ *  read-modify-write is still fine, since there is only one writer).
+ *  Arrays are linked into
+ *  a list, which is walked under the lock when statistics are copied.
+ *  Arrays grow (also under the lock) when the thread meets a type ID
+ *  beyond the capacity.
+ * Instances are often destroyed on a different thread than created,
+ *  so per-thread live counts are meaningless; only merged ones are.
+ * When thread exits its counters are added to the retired counters.
+ */
+
+typedef struct {
+    int64_t allocationCount;
+    int64_t destructionCount;
+    int64_t allocatedBytes;
+    int64_t destroyedBytes;
+} __CFTypeCounters;
+
+struct __CFRuntimeThreadStatistics {
+    struct __CFRuntimeThreadStatistics* next;
+    struct __CFRuntimeThreadStatistics* previous;
+    CFIndex capacity;
+    __CFTypeCounters* counters;
+};
+typedef struct __CFRuntimeThreadStatistics __CFRuntimeThreadStatistics;
+
+typedef struct {
+    CFRuntimeStatisticsCallBack callback;
+    void* info;
+} __CFRuntimeStatisticsCallBackInfo;
+
+enum {
+    __kCFRuntimeStatisticsCapacityGranularity = 64
+};
+
+CF_INTERNAL Boolean _CFRuntimeStatisticsEnabled = false;
+
+static CFLock_t __CFRuntimeStatisticsLock = CFLockInit;
+static __CFRuntimeThreadStatistics* __CFRuntimeStatisticsThreads = NULL;
+static __CFRuntimeThreadStatistics __CFRuntimeStatisticsRetired = {NULL, NULL, 0, NULL};
+
+static CFLock_t __CFRuntimeStatisticsTimerLock = CFLockInit;
+static CFRunLoopTimerRef __CFRuntimeStatisticsTimer = NULL;
+
+CONST_STRING_DECL(kCFRuntimeStatisticsTypeIDKey, "TypeID");
+CONST_STRING_DECL(kCFRuntimeStatisticsLiveInstancesKey, "LiveInstances");
+CONST_STRING_DECL(kCFRuntimeStatisticsLiveBytesKey, "LiveBytes");
+CONST_STRING_DECL(kCFRuntimeStatisticsAllocationCountKey, "AllocationCount");
+CONST_STRING_DECL(kCFRuntimeStatisticsAllocatedBytesKey, "AllocatedBytes");
+
+CONST_STRING_DECL(kCFRuntimeLockStatisticsAcquisitionCountKey, "AcquisitionCount");
+CONST_STRING_DECL(kCFRuntimeLockStatisticsContendedCountKey, "ContendedCount");
+CONST_STRING_DECL(kCFRuntimeLockStatisticsWaitTimeKey, "WaitTime");
+CONST_STRING_DECL(kCFRuntimeLockStatisticsMaxHoldTimeKey, "MaxHoldTime");
+
+///////////////////////////////////////////////////////////////////// private
+
+CF_INLINE int64_t __CFRuntimeStatisticsLoad(const int64_t* counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/* Must be called only by the thread that owns the counter. */
+CF_INLINE void __CFRuntimeStatisticsIncrement(int64_t* counter, int64_t delta) {
+    __atomic_store_n(counter, *counter + delta, __ATOMIC_RELAXED);
+}
+
+/* Expects lock to be held if 'stats' are linked.
+ * Returns false (leaving 'stats' intact) if allocation fails.
+ */
+static Boolean __CFRuntimeStatisticsGrow(__CFRuntimeThreadStatistics* stats, CFIndex capacity) {
+    __CFTypeCounters* counters;
+    capacity = (capacity + __kCFRuntimeStatisticsCapacityGranularity - 1) &
+        ~(__kCFRuntimeStatisticsCapacityGranularity - 1);
+    counters = (__CFTypeCounters*)CFAllocatorAllocate(
+        kCFAllocatorSystemDefault, capacity * sizeof(__CFTypeCounters), 0);
+    if (!counters) {
+        return false;
+    }
+    memset(counters, 0, capacity * sizeof(__CFTypeCounters));
+    if (stats->counters) {
+        memcpy(counters, stats->counters, stats->capacity * sizeof(__CFTypeCounters));
+        CFAllocatorDeallocate(kCFAllocatorSystemDefault, stats->counters);
+    }
+    stats->counters = counters;
+    stats->capacity = capacity;
+    return true;
+}
+
+/* Expects lock to be held. */
+static void __CFRuntimeStatisticsAdd(__CFRuntimeThreadStatistics* to, const __CFRuntimeThreadStatistics* from) {
+    CFIndex i;
+    CFIndex count = from->capacity;
+    if (to->capacity < count && !__CFRuntimeStatisticsGrow(to, count)) {
+        count = to->capacity;
+    }
+    for (i = 0; i != count; ++i) {
+        __CFTypeCounters* counters = to->counters + i;
+        const __CFTypeCounters* fromCounters = from->counters + i;
+        counters->allocationCount += __CFRuntimeStatisticsLoad(&fromCounters->allocationCount);
+        counters->destructionCount += __CFRuntimeStatisticsLoad(&fromCounters->destructionCount);
+        counters->allocatedBytes += __CFRuntimeStatisticsLoad(&fromCounters->allocatedBytes);
+        counters->destroyedBytes += __CFRuntimeStatisticsLoad(&fromCounters->destroyedBytes);
+    }
+}
+
+/* Returns NULL if counters can't be allocated. */
+static __CFTypeCounters* __CFRuntimeStatisticsGetCounters(CFTypeID typeID) {
+    _CFThreadSpecificData* tsd = _CFGetThreadSpecificData();
+    __CFRuntimeThreadStatistics* stats = tsd->_runtimeStatistics;
+    if (!stats) {
+        stats = (__CFRuntimeThreadStatistics*)CFAllocatorAllocate(
+            kCFAllocatorSystemDefault, sizeof(__CFRuntimeThreadStatistics), 0);
+        if (!stats) {
+            return NULL;
+        }
+        memset(stats, 0, sizeof(__CFRuntimeThreadStatistics));
+        if (!__CFRuntimeStatisticsGrow(stats, typeID + 1)) {
+            CFAllocatorDeallocate(kCFAllocatorSystemDefault, stats);
+            return NULL;
+        }
+        CFLock(&__CFRuntimeStatisticsLock);
+        stats->next = __CFRuntimeStatisticsThreads;
+        if (stats->next) {
+            stats->next->previous = stats;
+        }
+        __CFRuntimeStatisticsThreads = stats;
+        CFUnlock(&__CFRuntimeStatisticsLock);
+        tsd->_runtimeStatistics = stats;
+    } else if (typeID >= stats->capacity) {
+        Boolean grown;
+        CFLock(&__CFRuntimeStatisticsLock);
+        grown = __CFRuntimeStatisticsGrow(stats, typeID + 1);
+        CFUnlock(&__CFRuntimeStatisticsLock);
+        if (!grown) {
+            return NULL;
+        }
+    }
+    return stats->counters + typeID;
+}
+
+static CFNumberRef __CFRuntimeStatisticsCreateCount(int64_t value) {
+    return CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberSInt64Type, &value);
+}
+
+static void __CFRuntimeStatisticsSetAndRelease(CFMutableDictionaryRef dictionary, CFStringRef key, CFTypeRef value) {
+    CFDictionarySetValue(dictionary, key, value);
+    CFRelease(value);
+}
+
+#if defined(CF_ENABLE_LOCK_PROFILING)
+
+static void __CFRuntimeStatisticsAddTime(CFMutableDictionaryRef dictionary, CFStringRef key, int64_t tsr, Boolean max) {
+    CFNumberRef previous = (CFNumberRef)CFDictionaryGetValue(dictionary, key);
+    CFTimeInterval value = _CFTSRToTimeInterval(tsr);
+    if (previous) {
+        CFTimeInterval previousValue;
+        CFNumberGetValue(previous, kCFNumberDoubleType, &previousValue);
+        value = max ? (value > previousValue ? value : previousValue) : (value + previousValue);
+    }
+    __CFRuntimeStatisticsSetAndRelease(dictionary, key,
+        CFNumberCreate(kCFAllocatorSystemDefault, kCFNumberDoubleType, &value));
+}
+
+static void __CFRuntimeStatisticsAddCount(CFMutableDictionaryRef dictionary, CFStringRef key, int64_t value) {
+    CFNumberRef previous = (CFNumberRef)CFDictionaryGetValue(dictionary, key);
+    if (previous) {
+        int64_t previousValue;
+        CFNumberGetValue(previous, kCFNumberSInt64Type, &previousValue);
+        value += previousValue;
+    }
+    __CFRuntimeStatisticsSetAndRelease(dictionary, key, __CFRuntimeStatisticsCreateCount(value));
+}
+
+#endif // CF_ENABLE_LOCK_PROFILING
+
+static void __CFRuntimeStatisticsTimerFire(CFRunLoopTimerRef timer, void* info) {
+    const __CFRuntimeStatisticsCallBackInfo* callbackInfo = (const __CFRuntimeStatisticsCallBackInfo*)info;
+    CFDictionaryRef statistics = CFRuntimeCopyStatistics();
+    callbackInfo->callback(statistics, callbackInfo->info);
+    CFRelease(statistics);
+}
+
+static void __CFRuntimeStatisticsTimerRelease(const void* info) {
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, (void*)info);
+}
+
+///////////////////////////////////////////////////////////////////// internal
+
+CF_INTERNAL void _CFRuntimeStatisticsInitialize(void) {
+    const char* value = getenv("CFRuntimeStatistics");
+    _CFRuntimeStatisticsEnabled = (value && strtol(value, NULL, 0) != 0);
+}
+
+CF_INTERNAL void _CFRuntimeStatisticsRecordCreate(CFTypeID typeID, CFIndex size) {
+    __CFTypeCounters* counters = __CFRuntimeStatisticsGetCounters(typeID);
+    if (counters) {
+        __CFRuntimeStatisticsIncrement(&counters->allocationCount, 1);
+        __CFRuntimeStatisticsIncrement(&counters->allocatedBytes, size);
+    }
+}
+
+CF_INTERNAL void _CFRuntimeStatisticsRecordDestroy(CFTypeID typeID, CFIndex size) {
+    __CFTypeCounters* counters = __CFRuntimeStatisticsGetCounters(typeID);
+    if (counters) {
+        __CFRuntimeStatisticsIncrement(&counters->destructionCount, 1);
+        __CFRuntimeStatisticsIncrement(&counters->destroyedBytes, size);
+    }
+}
+
+CF_INTERNAL void _CFRuntimeStatisticsFinalizeThreadData(_CFThreadSpecificData* tsd) {
+    __CFRuntimeThreadStatistics* stats = tsd->_runtimeStatistics;
+    if (!stats) {
+        return;
+    }
+    CFLock(&__CFRuntimeStatisticsLock);
+    __CFRuntimeStatisticsAdd(&__CFRuntimeStatisticsRetired, stats);
+    if (stats->previous) {
+        stats->previous->next = stats->next;
+    } else {
+        __CFRuntimeStatisticsThreads = stats->next;
+    }
+    if (stats->next) {
+        stats->next->previous = stats->previous;
+    }
+    CFUnlock(&__CFRuntimeStatisticsLock);
+    tsd->_runtimeStatistics = NULL;
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, stats->counters);
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, stats);
+}
+
+///////////////////////////////////////////////////////////////////// public
+
+Boolean CFRuntimeIsStatisticsEnabled(void) {
+    return _CFRuntimeStatisticsEnabled;
+}
+
+CFDictionaryRef CFRuntimeCopyStatistics(void) {
+    __CFRuntimeThreadStatistics merged = {NULL, NULL, 0, NULL};
+    __CFRuntimeThreadStatistics* stats;
+    CFMutableDictionaryRef result;
+    CFIndex typeID;
+    if (!_CFRuntimeStatisticsEnabled) {
+        return NULL;
+    }
+
+    // Merge under the lock, create objects (which updates counters) after.
+    CFLock(&__CFRuntimeStatisticsLock);
+    __CFRuntimeStatisticsAdd(&merged, &__CFRuntimeStatisticsRetired);
+    for (stats = __CFRuntimeStatisticsThreads; stats; stats = stats->next) {
+        __CFRuntimeStatisticsAdd(&merged, stats);
+    }
+    CFUnlock(&__CFRuntimeStatisticsLock);
+
+    result = CFDictionaryCreateMutable(
+        kCFAllocatorSystemDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    for (typeID = 0; typeID != merged.capacity; ++typeID) {
+        const __CFTypeCounters* counters = merged.counters + typeID;
+        const CFRuntimeClass* cls = _CFRuntimeGetClassWithTypeID(typeID);
+        CFMutableDictionaryRef typeStats;
+        CFStringRef className;
+        if (!counters->allocationCount || !cls || !cls->className) {
+            continue;
+        }
+        typeStats = CFDictionaryCreateMutable(
+            kCFAllocatorSystemDefault, 0,
+            &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        __CFRuntimeStatisticsSetAndRelease(typeStats, kCFRuntimeStatisticsTypeIDKey,
+            __CFRuntimeStatisticsCreateCount(typeID));
+        __CFRuntimeStatisticsSetAndRelease(typeStats, kCFRuntimeStatisticsLiveInstancesKey,
+            __CFRuntimeStatisticsCreateCount(counters->allocationCount - counters->destructionCount));
+        __CFRuntimeStatisticsSetAndRelease(typeStats, kCFRuntimeStatisticsLiveBytesKey,
+            __CFRuntimeStatisticsCreateCount(counters->allocatedBytes - counters->destroyedBytes));
+        __CFRuntimeStatisticsSetAndRelease(typeStats, kCFRuntimeStatisticsAllocationCountKey,
+            __CFRuntimeStatisticsCreateCount(counters->allocationCount));
+        __CFRuntimeStatisticsSetAndRelease(typeStats, kCFRuntimeStatisticsAllocatedBytesKey,
+            __CFRuntimeStatisticsCreateCount(counters->allocatedBytes));
+        className = CFStringCreateWithCString(kCFAllocatorSystemDefault, cls->className, kCFStringEncodingASCII);
+        CFDictionarySetValue(result, className, typeStats);
+        CFRelease(className);
+        CFRelease(typeStats);
+    }
+    if (merged.counters) {
+        CFAllocatorDeallocate(kCFAllocatorSystemDefault, merged.counters);
+    }
+    return result;
+}
+
+void CFRuntimeSetStatisticsCallBack(CFRuntimeStatisticsCallBack callback, void* info, CFTimeInterval interval) {
+    CFRunLoopTimerRef timer = NULL;
+    if (!_CFRuntimeStatisticsEnabled) {
+        return;
+    }
+    if (callback) {
+        __CFRuntimeStatisticsCallBackInfo* callbackInfo;
+        CFRunLoopTimerContext context = {0};
+        CF_VALIDATE_ARG(interval > 0, "interval (%g) must be positive", interval);
+        callbackInfo = (__CFRuntimeStatisticsCallBackInfo*)CFAllocatorAllocate(
+            kCFAllocatorSystemDefault, sizeof(__CFRuntimeStatisticsCallBackInfo), 0);
+        if (!callbackInfo) {
+            return;
+        }
+        callbackInfo->callback = callback;
+        callbackInfo->info = info;
+        context.info = callbackInfo;
+        context.release = __CFRuntimeStatisticsTimerRelease;
+        timer = CFRunLoopTimerCreate(
+            kCFAllocatorSystemDefault,
+            CFAbsoluteTimeGetCurrent() + interval, interval,
+            0, 0, __CFRuntimeStatisticsTimerFire, &context);
+        if (!timer) {
+            CFAllocatorDeallocate(kCFAllocatorSystemDefault, callbackInfo);
+            return;
+        }
+        CFRunLoopAddTimer(CFRunLoopGetCurrent(), timer, kCFRunLoopCommonModes);
+    }
+    CFLock(&__CFRuntimeStatisticsTimerLock);
+    {
+        CFRunLoopTimerRef previousTimer = __CFRuntimeStatisticsTimer;
+        __CFRuntimeStatisticsTimer = timer;
+        timer = previousTimer;
+    }
+    CFUnlock(&__CFRuntimeStatisticsTimerLock);
+    if (timer) {
+        CFRunLoopTimerInvalidate(timer);
+        CFRelease(timer);
+    }
+}
+
+CFDictionaryRef CFRuntimeCopyLockStatistics(void) {
+#if defined(CF_ENABLE_LOCK_PROFILING)
+    CFMutableDictionaryRef result = CFDictionaryCreateMutable(
+        kCFAllocatorSystemDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    _CFLockSite* site;
+    for (site = _CFLockGetSites(); site; site = site->next) {
+        CFStringRef name = CFStringCreateWithCString(
+            kCFAllocatorSystemDefault,
+            (site->name[0] == '&') ? site->name + 1 : site->name,
+            kCFStringEncodingASCII);
+        CFMutableDictionaryRef lockStats = (CFMutableDictionaryRef)CFDictionaryGetValue(result, name);
+        if (!lockStats) {
+            lockStats = CFDictionaryCreateMutable(
+                kCFAllocatorSystemDefault, 0,
+                &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+            CFDictionarySetValue(result, name, lockStats);
+            CFRelease(lockStats);
+        }
+        CFRelease(name);
+        __CFRuntimeStatisticsAddCount(lockStats, kCFRuntimeLockStatisticsAcquisitionCountKey,
+            site->acquisitionCount);
+        __CFRuntimeStatisticsAddCount(lockStats, kCFRuntimeLockStatisticsContendedCountKey,
+            site->contendedCount);
+        __CFRuntimeStatisticsAddTime(lockStats, kCFRuntimeLockStatisticsWaitTimeKey,
+            site->waitTSR, false);
+        __CFRuntimeStatisticsAddTime(lockStats, kCFRuntimeLockStatisticsMaxHoldTimeKey,
+            site->maxHoldTSR, true);
+    }
+    return result;
+#else
+    return NULL;
+#endif
+}
@@ -98,9 +98,10 @@ typedef struct {
     CFULong cachedNodeLo;    // cachedNode
 } CFStorageAccessCacheParts;
 
-#define genCountMask    0x0000FFFFUL
-#define dataMask    0xFFFF0000UL
-#define shiftLowWordBy    16
+/* Half-word is 16 bits on 32-bit and 32 bits on 64-bit platforms. */
+#define shiftLowWordBy    ((CFULong)sizeof(CFULong) * 4)
+#define genCountMask    ((~(CFULong)0) >> shiftLowWordBy)
+#define dataMask    (~genCountMask)
 
 //TODO use the following instead of clumsy stuff above.
 //     Note that I sacrificed POSSIBLE_TO_HAVE_LENGTH_MORE_THAN_HALFWORD
@@ -114,15 +115,6 @@ typedef struct {
 //    CFULong lowPart;
 //} __CFCacheItem;
 //
-///* These macros are evaluated to (32/64 bit):
-// * __CFCacheValueShift = 16 / 32
-// * __CFCacheValueMask = 0xFFFF0000 / 0xFFFFFFFF00000000
-// * __CFCacheGenerationMask = 0x0000FFFF / 0x00000000FFFFFFFF
-// */
-//#define __CFCacheValueShift ((CFULong)sizeof(CFULong) * 4)
-//#define __CFCacheValueMask (~__CFCacheGenerationMask)
-//#define __CFCacheGenerationMask ((~(CFULong)0) >> __CFCacheValueShift)
-//
 //typedef struct {
 //    int32_t generationCounter;
 //    __CFCacheItem location;
@@ -137,7 +129,7 @@ struct __CFStorage {
     CFIndex valueSize;
     CFIndex maxLeafCapacity; // In terms of bytes
     CFStorageNode rootNode;
-    CFSpinLock_t leafNodeMemoryAllocationLock;
+    CFLock_t leafNodeMemoryAllocationLock;
     
     int32_t cacheGenerationCount;
     CFStorageAccessCacheParts cacheParts;
@@ -157,10 +149,10 @@ CF_INLINE CFIndex __CFRoundToPage(CFIndex num) {
  * thread-safe in general), but for lazy allocation of storage during reading.
  */
 static void __CFStorageAllocLeafNodeMemoryAux(CFAllocatorRef allocator, CFStorageRef storage, CFStorageNode* node, CFIndex cap) {
-    CFSpinLock(&storage->leafNodeMemoryAllocationLock);
+    CFLock(&storage->leafNodeMemoryAllocationLock);
     node->info.leaf.memory = (uint8_t*)CFAllocatorReallocate(allocator, node->info.leaf.memory, cap, 0);
     node->info.leaf.capacityInBytes = cap;
-    CFSpinUnlock(&storage->leafNodeMemoryAllocationLock);
+    CFUnlock(&storage->leafNodeMemoryAllocationLock);
 }
 
 CF_INLINE void __CFStorageAllocLeafNodeMemory(CFAllocatorRef allocator, CFStorageRef storage, CFStorageNode* node, CFIndex cap, bool compact) {
@@ -189,14 +181,14 @@ CF_INLINE void __CFStorageSetCache(CFStorageRef storage, CFStorageNode* node, CF
 //    __CFCacheItemSet(&cache.node, (CFULong)node, generation);
 //    storage->cache = cache;
     
-    unsigned int genCount = (OSAtomicIncrement32(&storage->cacheGenerationCount) & genCountMask);
+    CFULong genCount = ((CFULong)(uint32_t)OSAtomicIncrement32(&storage->cacheGenerationCount) & genCountMask);
     CFStorageAccessCacheParts cacheParts;
-    cacheParts.locationHi = (loc & dataMask) | genCount;
-    cacheParts.locationLo = (loc << shiftLowWordBy) | genCount;
+    cacheParts.locationHi = ((CFULong)loc & dataMask) | genCount;
+    cacheParts.locationLo = ((CFULong)loc << shiftLowWordBy) | genCount;
 #if POSSIBLE_TO_HAVE_LENGTH_MORE_THAN_HALFWORD
-    cacheParts.lengthHi = (len & dataMask) | genCount;
+    cacheParts.lengthHi = ((CFULong)len & dataMask) | genCount;
 #endif
-    cacheParts.lengthLo = (len << shiftLowWordBy) | genCount;
+    cacheParts.lengthLo = ((CFULong)len << shiftLowWordBy) | genCount;
     cacheParts.cachedNodeHi = ((CFULong)node & dataMask) | genCount;
     cacheParts.cachedNodeLo = ((CFULong)node << shiftLowWordBy) | genCount;
     storage->cacheParts = cacheParts;
@@ -219,7 +211,7 @@ CF_INLINE Boolean __CFStorageGetCache(CFStorageRef storage, CFRange* cachedRange
 //        return true;
 //    }
 
-    unsigned int genCount = cacheParts.locationHi & genCountMask;
+    CFULong genCount = cacheParts.locationHi & genCountMask;
 
     // Check to make sure the genCounts of all the items are the same;
     //  if not, the cache was inconsistent
@@ -752,7 +744,7 @@ CFStorageRef CFStorageCreate(CFAllocatorRef allocator, CFIndex valueSize) {
         return NULL;
     }
     storage->valueSize = valueSize;
-    storage->leafNodeMemoryAllocationLock = CFSpinLockInit;
+    storage->leafNodeMemoryAllocationLock = CFLockInit;
     storage->cacheGenerationCount = 0;
     storage->cacheParts.locationHi = 0;
     storage->cacheParts.locationLo = 0;
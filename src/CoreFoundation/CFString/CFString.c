@@ -376,14 +376,14 @@ CF_INTERNAL const char* _CFStrGetLanguageIdentifierForLocale(CFLocaleRef locale)
     const char* langID = NULL;
     static const void* lastLocale = NULL;
     static const char* lastLangID = NULL;
-    static CFSpinLock_t lock = CFSpinLockInit;
+    static CFLock_t lock = CFLockInit;
 
-    CFSpinLock(&lock);
+    CFLock(&lock);
     if ((lastLocale) && (lastLocale == locale)) {
-        CFSpinUnlock(&lock);
+        CFUnlock(&lock);
         return lastLangID;
     }
-    CFSpinUnlock(&lock);
+    CFUnlock(&lock);
 
     collatorID = (CFStringRef)CFLocaleGetValue(locale, _kCFLocaleCollatorID);
 
@@ -412,10 +412,10 @@ CF_INTERNAL const char* _CFStrGetLanguageIdentifierForLocale(CFLocaleRef locale)
         }
     }
 
-    CFSpinLock(&lock);
+    CFLock(&lock);
     lastLocale = locale;
     lastLangID = langID;
-    CFSpinUnlock(&lock);
+    CFUnlock(&lock);
 
     return langID;
 }
@@ -728,6 +728,20 @@ CF_INTERNAL const void* __CFStringCollectionCopy(CFAllocatorRef allocator, const
     return CFStringCreateCopy(allocator, string);
 }
 
+CF_INTERNAL CFStringRef _CFStringInitWithCStringNoCopy(_CFStackString* storage, const char* cStr, CFStringEncoding encoding) {
+    CFStringRef str = (CFStringRef)storage;
+    CFIndex length = (CFIndex)strlen(cStr);
+    if (!__CFCanUseEightBitCFStringForBytes((const uint8_t*)cStr, length, encoding)) {
+        return NULL;
+    }
+    // Same layout as constant strings: 8-bit, not freed, explicit length.
+    _CFRuntimeInitStaticInstance(storage, _kCFStringTypeID);
+    __CFStrSetInfoBits(str, __kCFNotInlineContentsNoFree | __kCFHasNullByte);
+    __CFStrSetContentPtr(str, cStr);
+    __CFStrSetExplicitLength(str, length);
+    return str;
+}
+
 ///////////////////////////////////////////////////////////////////// public
 
 
@@ -763,13 +763,13 @@ CF_INLINE __CFConverterEntry* __CFConverterGetEntry(uint32_t encoding) {
 
 CF_INLINE __CFConverter* __CFConverterFromDefinition(const _CFStringEncodingConverter* definition) {
 #define NUM_OF_ENTRIES_CYCLE (10)
-    static CFSpinLock_t _indexLock = CFSpinLockInit;
+    static CFLock_t _indexLock = CFLockInit;
     static uint32_t _currentIndex = 0;
     static uint32_t _allocatedSize = 0;
     static __CFConverter* _allocatedEntries = NULL;
     __CFConverter* converter;
 
-    CFSpinLock(&_indexLock);
+    CFLock(&_indexLock);
     if ((_currentIndex + 1) >= _allocatedSize) {
         _currentIndex = 0;
         _allocatedSize = 0;
@@ -784,7 +784,7 @@ CF_INLINE __CFConverter* __CFConverterFromDefinition(const _CFStringEncodingConv
     } else {
         converter = &(_allocatedEntries[++_currentIndex]);
     }
-    CFSpinUnlock(&_indexLock);
+    CFUnlock(&_indexLock);
 
     switch (definition->encodingClass) {
         case kCFStringEncodingConverterStandard:
@@ -47,7 +47,11 @@ struct __notInlineMutable {
     unsigned int isFixedCapacity : 1;
     unsigned int isExternalMutable : 1;
     unsigned int capacityProvidedExternally : 1;
+#if __LP64__
+    unsigned long desiredCapacity : 60;
+#else
     unsigned long desiredCapacity : 28;
+#endif
     CFAllocatorRef contentsAllocator; // Optional
 };
 
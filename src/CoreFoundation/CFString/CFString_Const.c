@@ -32,7 +32,7 @@
  *  are the CFStrings created for them.
  */
 static CFMutableDictionaryRef __CFCStrTable = NULL;
-static CFSpinLock_t __CFCStrTableLock = CFSpinLockInit;
+static CFLock_t __CFCStrTableLock = CFLockInit;
 
 ///////////////////////////////////////////////////////////////////// private
 
@@ -75,9 +75,9 @@ static CFHashCode __CFCStrHash(const void* ptr) {
 CF_INTERNAL Boolean _CFStringIsConstantString(CFStringRef str) {
     Boolean found = false;
     if (__CFCStrTable) {
-        CFSpinLock(&__CFCStrTableLock);
+        CFLock(&__CFCStrTableLock);
         found = CFDictionaryContainsValue(__CFCStrTable, str);
-        CFSpinUnlock(&__CFCStrTableLock);
+        CFUnlock(&__CFCStrTableLock);
     }
     return found;
 }
@@ -104,21 +104,21 @@ CFStringRef __CFStringMakeConstantString(const char* cStr) {
             0,
             &constantStringCallBacks, &constantStringValueCallBacks);
         _CFDictionarySetCapacity(table, 2500); // avoid lots of rehashing
-        CFSpinLock(&__CFCStrTableLock);
+        CFLock(&__CFCStrTableLock);
         if (__CFCStrTable == NULL) {
             __CFCStrTable = table;
         }
-        CFSpinUnlock(&__CFCStrTableLock);
+        CFUnlock(&__CFCStrTableLock);
         if (__CFCStrTable != table) {
             CFRelease(table);
         }
     }
 
-    CFSpinLock(&__CFCStrTableLock);
+    CFLock(&__CFCStrTableLock);
     if ((result = (CFStringRef)CFDictionaryGetValue(__CFCStrTable, cStr))) {
-        CFSpinUnlock(&__CFCStrTableLock);
+        CFUnlock(&__CFCStrTableLock);
     } else {
-        CFSpinUnlock(&__CFCStrTableLock);
+        CFUnlock(&__CFCStrTableLock);
         {
             char* key;
             Boolean isASCII = true;
@@ -167,17 +167,16 @@ CFStringRef __CFStringMakeConstantString(const char* cStr) {
             {
                 CFStringRef resultToBeReleased = result;
                 CFIndex count;
-                CFSpinLock(&__CFCStrTableLock);
+                CFLock(&__CFCStrTableLock);
                 count = CFDictionaryGetCount(__CFCStrTable);
                 CFDictionaryAddValue(__CFCStrTable, key, result);
                 if (CFDictionaryGetCount(__CFCStrTable) == count) {
                     // Add did nothing, someone already put it there.
                     result = (CFStringRef)CFDictionaryGetValue(__CFCStrTable, key);
                 } else {
-                    // TODO Generalize (_CFRuntimeMakeConst?).
-                    CF_BASE(result)->_rc = 0;
+                    _CFRCMakeStatic(result);
                 }
-                CFSpinUnlock(&__CFCStrTableLock);
+                CFUnlock(&__CFCStrTableLock);
 
                 // This either eliminates the extra retain on the freshly created string, 
                 //  or frees it, if it was actually not inserted into the table.
@@ -75,11 +75,9 @@ CF_INTERNAL UniChar __CFCharToUniCharTable[256] = {
  *  257^2 = 66049;
  *  257^3 = 16974593;
  *  257^4 = 4362470401;
- *  67503105 is 257^4 - 256^4
- * If hashcode is changed from UInt32 to something else, this last piece 
- *  needs to be readjusted.
- *
- * !!! We haven't updated for LP64 yet
+ * CFHashCode is 32 bits wide on 32-bit platforms and 64 bits wide on
+ *  LP64 ones; 257^4 is converted to CFHashCode, so on 32-bit platforms
+ *  it becomes 67503105 (257^4 - 256^4), which is the same modulo 2^32.
  *
  * NOTE: The hash algorithm used to be duplicated in CF and Foundation; 
  *  but now it should only be in the four functions below.
@@ -88,9 +86,11 @@ CF_INTERNAL UniChar __CFCharToUniCharTable[256] = {
  */
 #define HashEverythingLimit 96
 
+#define Hash257Pow4 ((CFHashCode)4362470401ULL)
+
 #define HashNextFourUniChars(accessStart, accessEnd, pointer) \
     { \
-        result = result * 67503105 + \
+        result = result * Hash257Pow4 + \
             (accessStart 0 accessEnd) * 16974593 + \
             (accessStart 1 accessEnd) * 66049  + \
             (accessStart 2 accessEnd) * 257 + \
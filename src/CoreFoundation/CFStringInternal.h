@@ -40,6 +40,26 @@ CF_EXPORT const void* __CFStringCollectionCopy(CFAllocatorRef allocator, const v
 
 CF_EXPORT CFStringEncoding CFStringFileSystemEncoding(void);
 
+/* Storage for a temporary string, see _CFStringInitWithCStringNoCopy().
+ * Layout matches not-inline immutable CFString.
+ */
+typedef struct {
+    CFRuntimeBase _base;
+    const void* _buffer;
+    CFIndex _length;
+    CFAllocatorRef _contentsDeallocator;
+} _CFStackString;
+
+/* Initializes 'storage' (usually on stack) as an immutable 8-bit string
+ *  which refers to 'cStr' in place, so that it hashes and compares equal
+ *  exactly as a string created with CFStringCreateWithCString() would.
+ *  Returns NULL if bytes can't be used as-is (i.e. they are not in the
+ *  eight-bit encoding and are not ASCII).
+ * The string is constant (retain / release do nothing) and must not be
+ *  used after 'cStr' or 'storage' go away, so never store it.
+ */
+CF_EXPORT CFStringRef _CFStringInitWithCStringNoCopy(_CFStackString* storage, const char* cStr, CFStringEncoding encoding);
+
 CF_EXPORT CFStringRef __CFStringCreateImmutableFunnel(CFAllocatorRef alloc, const void *bytes, CFIndex numBytes, CFStringEncoding encoding, Boolean possiblyExternalFormat, Boolean tryToReduceUnicode, Boolean hasLengthByte, Boolean hasNullByte, Boolean noCopy, CFAllocatorRef contentsDeallocator, UInt32 converterFlags);
 
 
@@ -28,7 +28,9 @@
 
 //TODO: merge CFThreadData to to CFRuntime.c
 
-static pthread_key_t __CFTSDKey = (pthread_key_t)NULL;
+static pthread_key_t __CFTSDKey = 0;
+
+CF_INTERNAL __thread _CFThreadSpecificData _CFThreadData;
 
 /* Called for each thread as it exits.
  */
@@ -39,20 +41,23 @@ static void __CFFinalizeThreadData(void* arg) {
     }
     if (tsd->_allocator) {
         CFRelease(tsd->_allocator);
+        tsd->_allocator = NULL;
     }
     _CFFinalizeCurrentRunLoop();
-    CFAllocatorDeallocate(kCFAllocatorSystemDefault, tsd);
+    _CFRCFinalizeThreadData(tsd);
+    _CFRuntimeStatisticsFinalizeThreadData(tsd);
+    if (tsd->_slabCache) {
+        // Last, since finalization above can free objects.
+        _CFSlabDestroyThreadCache(tsd->_slabCache);
+    }
+    // Block is reused (and registered again) if CF is called
+    //  by other key destructors.
+    memset(tsd, 0, sizeof(_CFThreadSpecificData));
 }
 
-CF_INTERNAL _CFThreadSpecificData* _CFGetThreadSpecificData(void) {
-    _CFThreadSpecificData* data = (_CFThreadSpecificData*)pthread_getspecific(__CFTSDKey);
-    if (data) {
-        return data;
-    }
-    data = (_CFThreadSpecificData*)CFAllocatorAllocate(kCFAllocatorSystemDefault, sizeof(_CFThreadSpecificData), 0);
-    memset(data, 0, sizeof(_CFThreadSpecificData));
-    pthread_setspecific(__CFTSDKey, data);
-    return data;
+CF_INTERNAL void _CFRegisterThreadSpecificData(void) {
+    _CFThreadData._registered = true;
+    pthread_setspecific(__CFTSDKey, &_CFThreadData);
 }
 
 CF_INTERNAL void _CFThreadDataInitialize(void) {
@@ -28,13 +28,40 @@
 #include "CFBaseInternal.h"
 #include <pthread.h>
 
+/* Per-thread runtime context.
+ *
+ * The block lives in TLS, so getting it is a single TLS access. It's
+ *  registered with a pthread key on the first _CFGetThreadSpecificData()
+ *  call, so that __CFFinalizeThreadData() cleans it up when the thread
+ *  exits. Fields which don't need cleanup (e.g. _allocator when it's
+ *  not set) can be read directly from _CFThreadData.
+ */
 typedef struct {
+    Boolean _registered;
     CFAllocatorRef _allocator;
+    struct __CFRunLoop* _runLoop; // not retained, see CFRunLoopGetCurrent()
+    struct __CFSlabThreadCache* _slabCache;
+    uint16_t _rcOwner; // 0x100 | owner index, see CFBase.c
+    struct __CFRuntimeThreadStatistics* _runtimeStatistics;
+    int64_t _heapProfileCountdown; // see CFRuntime_HeapProfile.c
+    uint64_t _heapProfileSeed;
+    int32_t _heapProfileDepth;
     // If you add things to this struct, 
     // add cleanup to __CFFinalizeThreadData()
 } _CFThreadSpecificData;
 
-CF_EXPORT void _CFThreadDataInitialize(void);
-CF_EXPORT _CFThreadSpecificData* _CFGetThreadSpecificData(void);
+CF_INTERNAL extern __thread _CFThreadSpecificData _CFThreadData;
+
+CF_INTERNAL void _CFThreadDataInitialize(void);
+CF_INTERNAL void _CFRegisterThreadSpecificData(void);
+
+CF_INLINE _CFThreadSpecificData* _CFGetThreadSpecificData(void) {
+    if (!_CFThreadData._registered) {
+        _CFRegisterThreadSpecificData();
+    }
+    return &_CFThreadData;
+}
+CF_INTERNAL void _CFRCFinalizeThreadData(_CFThreadSpecificData* tsd);
+CF_INTERNAL void _CFRuntimeStatisticsFinalizeThreadData(_CFThreadSpecificData* tsd);
 
 #endif /* ! __COREFOUNDATION_CFTHREADDATA__ */
@@ -55,11 +55,11 @@ enum {
     kCFTimeZoneNameStyleShortGeneric = 5
 };
 
-static CFSpinLock_t __CFTimeZoneGlobalLock = CFSpinLockInit;
+static CFLock_t __CFTimeZoneGlobalLock = CFLockInit;
 static CFTimeZoneRef __CFTimeZoneSystem = NULL;
 static CFTimeZoneRef __CFTimeZoneDefault = NULL;
 static CFDictionaryRef __CFTimeZoneAbbreviationDict = NULL;
-static CFSpinLock_t __CFTimeZoneAbbreviationLock = CFSpinLockInit;
+static CFLock_t __CFTimeZoneAbbreviationLock = CFLockInit;
 static CFArrayRef __CFKnownTimeZoneList = NULL;
 static CFMutableDictionaryRef __CFTimeZoneCache = NULL;
 
@@ -121,11 +121,11 @@ static const char* __CFTimeZoneAbbreviationDefaults[][2] = {
 ///////////////////////////////////////////////////////////////////// private
 
 CF_INLINE void __CFTimeZoneLockGlobal(void) {
-    CFSpinLock(&__CFTimeZoneGlobalLock);
+    CFLock(&__CFTimeZoneGlobalLock);
 }
 
 CF_INLINE void __CFTimeZoneUnlockGlobal(void) {
-    CFSpinUnlock(&__CFTimeZoneGlobalLock);
+    CFUnlock(&__CFTimeZoneGlobalLock);
 }
 
 static CFTimeZoneRef __CFTimeZoneCacheGetCopy(CFStringRef name) {
@@ -272,10 +272,6 @@ static const CFRuntimeClass __CFTimeZoneClass = {
 
 ///////////////////////////////////////////////////////////////////// internal
 
-CF_INTERNAL void __CFTimeZoneInitialize(void) {
-    __kCFTimeZoneTypeID = _CFRuntimeRegisterClass(&__CFTimeZoneClass);
-}
-
 ///////////////////////////////////////////////////////////////////// public
 
 CONST_STRING_DECL(
@@ -283,7 +279,11 @@ CONST_STRING_DECL(
     "kCFTimeZoneSystemTimeZoneDidChangeNotification")
 
 CFTypeID CFTimeZoneGetTypeID(void) {
-    return __kCFTimeZoneTypeID;
+    CFTypeID typeID = _CFRuntimeLoadTypeID(&__kCFTimeZoneTypeID);
+    if (typeID == _kCFRuntimeNotATypeID) {
+        typeID = _CFRuntimeRegisterClassOnce(&__kCFTimeZoneTypeID, &__CFTimeZoneClass, NULL);
+    }
+    return typeID;
 }
 
 CFTimeZoneRef CFTimeZoneCopySystem(void) {
@@ -380,7 +380,7 @@ CFArrayRef CFTimeZoneCopyKnownNames(void) {
 }
 
 CFDictionaryRef CFTimeZoneCopyAbbreviationDictionary(void) {
-    CFSpinLock(&__CFTimeZoneAbbreviationLock);
+    CFLock(&__CFTimeZoneAbbreviationLock);
     if (!__CFTimeZoneAbbreviationDict) {
         CFIndex abbrCount = CF_COUNTOF(__CFTimeZoneAbbreviationDefaults);
         CFMutableDictionaryRef abbrs = CFDictionaryCreateMutable(
@@ -404,7 +404,7 @@ CFDictionaryRef CFTimeZoneCopyAbbreviationDictionary(void) {
         }
         __CFTimeZoneAbbreviationDict = abbrs;
     }
-    CFSpinUnlock(&__CFTimeZoneAbbreviationLock);
+    CFUnlock(&__CFTimeZoneAbbreviationLock);
 
     if (__CFTimeZoneAbbreviationDict) {
         CFRetain(__CFTimeZoneAbbreviationDict);
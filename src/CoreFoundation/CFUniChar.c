@@ -76,17 +76,17 @@ typedef struct {
 static char __CFUniCharUnicodeVersionString[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 static uint32_t __CFUniCharNumberOfBitmaps = 0;
 static __CFUniCharBitmapData* __CFUniCharBitmapDataArray = NULL;
-static CFSpinLock_t __CFUniCharBitmapLock = CFSpinLockInit;
+static CFLock_t __CFUniCharBitmapLock = CFLockInit;
 
 static uint32_t* __CFUniCharCaseMappingTableCounts = NULL;
 static uint32_t** __CFUniCharCaseMappingTable = NULL;
 static const uint32_t** __CFUniCharCaseMappingExtraTable = NULL;
 static const void** __CFUniCharMappingTables = NULL;
-static CFSpinLock_t __CFUniCharMappingTableLock = CFSpinLockInit;
+static CFLock_t __CFUniCharMappingTableLock = CFLockInit;
 
 static __CFUniCharBitmapData* __CFUniCharUnicodePropertyTable = NULL;
 static int __CFUniCharUnicodePropertyTableCount = 0;
-static CFSpinLock_t __CFUniCharPropTableLock = CFSpinLockInit;
+static CFLock_t __CFUniCharPropTableLock = CFLockInit;
 
 ///////////////////////////////////////////////////////////////////// private
 
@@ -159,10 +159,10 @@ static bool __CFUniCharLoadBitmapData(void) {
     const uint8_t* bitmap;
     int idx, bitmapIndex;
 
-    CFSpinLock(&__CFUniCharBitmapLock);
+    CFLock(&__CFUniCharBitmapLock);
 
     if (__CFUniCharBitmapDataArray || !__CFUniCharLoadFile(CF_UNICHAR_BITMAP_FILE, &bytes)) {
-        CFSpinUnlock(&__CFUniCharBitmapLock);
+        CFUnlock(&__CFUniCharBitmapLock);
         return false;
     }
 
@@ -207,7 +207,7 @@ static bool __CFUniCharLoadBitmapData(void) {
 
     __CFUniCharBitmapDataArray = array;
 
-    CFSpinUnlock(&__CFUniCharBitmapLock);
+    CFUnlock(&__CFUniCharBitmapLock);
 
     return true;
 }
@@ -245,10 +245,10 @@ static bool __CFUniCharLoadCaseMappingTable(void) {
         return false;
     }
 
-    CFSpinLock(&__CFUniCharMappingTableLock);
+    CFLock(&__CFUniCharMappingTableLock);
 
     if (__CFUniCharCaseMappingTableCounts) {
-        CFSpinUnlock(&__CFUniCharMappingTableLock);
+        CFUnlock(&__CFUniCharMappingTableLock);
         return true;
     }
 
@@ -264,7 +264,7 @@ static bool __CFUniCharLoadCaseMappingTable(void) {
 
     __CFUniCharCaseMappingTableCounts = countArray;
 
-    CFSpinUnlock(&__CFUniCharMappingTableLock);
+    CFUnlock(&__CFUniCharMappingTableLock);
     return true;
 }
 
@@ -477,7 +477,7 @@ CF_INTERNAL uint32_t _CFUniCharGetNumberOfPlanes(uint32_t charset) {
 
 CF_INTERNAL const void* _CFUniCharGetMappingData(uint32_t type) {
 
-    CFSpinLock(&__CFUniCharMappingTableLock);
+    CFLock(&__CFUniCharMappingTableLock);
 
     if (!__CFUniCharMappingTables) {
         const uint8_t* bytes;
@@ -486,7 +486,7 @@ CF_INTERNAL const void* _CFUniCharGetMappingData(uint32_t type) {
         int idx, count;
 
         if (!__CFUniCharLoadFile(CF_UNICHAR_MAPPING_FILE, &bytes)) {
-            CFSpinUnlock(&__CFUniCharMappingTableLock);
+            CFUnlock(&__CFUniCharMappingTableLock);
             return NULL;
         }
 
@@ -506,7 +506,7 @@ CF_INTERNAL const void* _CFUniCharGetMappingData(uint32_t type) {
         }
     }
 
-    CFSpinUnlock(&__CFUniCharMappingTableLock);
+    CFUnlock(&__CFUniCharMappingTableLock);
 
     return __CFUniCharMappingTables[type];
 }
@@ -833,7 +833,7 @@ caseFoldRetry:
 
 CF_INTERNAL const void* _CFUniCharGetUnicodePropertyDataForPlane(uint32_t propertyType, uint32_t plane) {
 
-    CFSpinLock(&__CFUniCharPropTableLock);
+    CFLock(&__CFUniCharPropTableLock);
 
     if (!__CFUniCharUnicodePropertyTable) {
         __CFUniCharBitmapData* table;
@@ -846,7 +846,7 @@ CF_INTERNAL const void* _CFUniCharGetUnicodePropertyDataForPlane(uint32_t proper
         int planeSize;
 
         if (!__CFUniCharLoadFile(CF_UNICHAR_PROPERTY_FILE, &bytes)) {
-            CFSpinUnlock(&__CFUniCharPropTableLock);
+            CFUnlock(&__CFUniCharPropTableLock);
             return NULL;
         }
 
@@ -883,7 +883,7 @@ CF_INTERNAL const void* _CFUniCharGetUnicodePropertyDataForPlane(uint32_t proper
         __CFUniCharUnicodePropertyTable = table;
     }
 
-    CFSpinUnlock(&__CFUniCharPropTableLock);
+    CFUnlock(&__CFUniCharPropTableLock);
 
     return (plane < __CFUniCharUnicodePropertyTable[propertyType]._numPlanes ? __CFUniCharUnicodePropertyTable[propertyType]._planes[plane] : NULL);
 }
@@ -54,12 +54,12 @@ static const uint8_t* __CFUniCharDecomposableBitmapForBMP = NULL;
 static const uint8_t* __CFUniCharHFSPlusDecomposableBitmapForBMP = NULL;
 static const uint8_t** __CFUniCharCombiningPriorityTable = NULL;
 static uint8_t __CFUniCharCombiningPriorityTableNumPlane = 0;
-static CFSpinLock_t __CFUniCharDecompositionTableLock = CFSpinLockInit;
+static CFLock_t __CFUniCharDecompositionTableLock = CFLockInit;
 
 static UTF32Char* __CFUniCharCompatibilityDecompositionTable = NULL;
 static uint32_t __CFUniCharCompatibilityDecompositionTableLength = 0;
 static UTF32Char* __CFUniCharCompatibilityMultipleDecompositionTable = NULL;
-static CFSpinLock_t __CFUniCharCompatibilityDecompositionTableLock = CFSpinLockInit;
+static CFLock_t __CFUniCharCompatibilityDecompositionTableLock = CFLockInit;
 
 ///////////////////////////////////////////////////////////////////// private
 
@@ -97,13 +97,13 @@ CF_INLINE void __CFUniCharMoveBufferFromEnd1(UTF32Char* convertedChars, CFIndex
 
 static void __CFUniCharLoadDecompositionTable(void) {
 
-    CFSpinLock(&__CFUniCharDecompositionTableLock);
+    CFLock(&__CFUniCharDecompositionTableLock);
 
     if (!__CFUniCharDecompositionTable) {
         const uint32_t* bytes = (uint32_t*)_CFUniCharGetMappingData(kCFUniCharCanonicalDecompMapping);
 
         if (!bytes) {
-            CFSpinUnlock(&__CFUniCharDecompositionTableLock);
+            CFUnlock(&__CFUniCharDecompositionTableLock);
             return;
         }
 
@@ -124,18 +124,18 @@ static void __CFUniCharLoadDecompositionTable(void) {
         }
     }
 
-    CFSpinUnlock(&__CFUniCharDecompositionTableLock);
+    CFUnlock(&__CFUniCharDecompositionTableLock);
 }
 
 static void __CFUniCharLoadCompatibilityDecompositionTable(void) {
 
-    CFSpinLock(&__CFUniCharCompatibilityDecompositionTableLock);
+    CFLock(&__CFUniCharCompatibilityDecompositionTableLock);
 
     if (!__CFUniCharCompatibilityDecompositionTable) {
         const uint32_t* bytes = (uint32_t*)_CFUniCharGetMappingData(kCFUniCharCompatibilityDecompMapping);
 
         if (!bytes) {
-            CFSpinUnlock(&__CFUniCharCompatibilityDecompositionTableLock);
+            CFUnlock(&__CFUniCharCompatibilityDecompositionTableLock);
             return;
         }
 
@@ -146,7 +146,7 @@ static void __CFUniCharLoadCompatibilityDecompositionTable(void) {
         __CFUniCharCompatibilityDecompositionTableLength /= (sizeof(uint32_t) * 2);
     }
 
-    CFSpinUnlock(&__CFUniCharCompatibilityDecompositionTableLock);
+    CFUnlock(&__CFUniCharCompatibilityDecompositionTableLock);
 }
 
 static uint32_t __CFUniCharGetMappedValue(const __CFUniCharDecomposeMappings* theTable, uint32_t numElem, UTF32Char character) {
@@ -44,20 +44,20 @@ static uint32_t __CFUniCharPrecompositionTableLength = 0;
 static uint16_t* __CFUniCharBMPPrecompDestinationTable = NULL;
 static uint32_t* __CFUniCharNonBMPPrecompDestinationTable = NULL;
 
-static CFSpinLock_t __CFUniCharPrecompositionTableLock = CFSpinLockInit;
+static CFLock_t __CFUniCharPrecompositionTableLock = CFLockInit;
 
 ///////////////////////////////////////////////////////////////////// private
 
 static void __CFUniCharLoadPrecompositionTable(void) {
 
-    CFSpinLock(&__CFUniCharPrecompositionTableLock);
+    CFLock(&__CFUniCharPrecompositionTableLock);
 
     if (!__CFUniCharPrecompSourceTable) {
         const uint32_t* bytes = (const uint32_t*)_CFUniCharGetMappingData(kCFUniCharCanonicalPrecompMapping);
         uint32_t bmpMappingLength;
 
         if (!bytes) {
-            CFSpinUnlock(&__CFUniCharPrecompositionTableLock);
+            CFUnlock(&__CFUniCharPrecompositionTableLock);
             return;
         }
 
@@ -68,7 +68,7 @@ static void __CFUniCharLoadPrecompositionTable(void) {
         __CFUniCharNonBMPPrecompDestinationTable = (uint32_t*)(((intptr_t)__CFUniCharBMPPrecompDestinationTable) + bmpMappingLength);
     }
 
-    CFSpinUnlock(&__CFUniCharPrecompositionTableLock);
+    CFUnlock(&__CFUniCharPrecompositionTableLock);
 }
 
 static UTF16Char __CFUniCharGetMappedBMPValue(const __CFUniCharPrecomposeBMPMappings* theTable, uint32_t numElem, UTF16Char character) {
@@ -24,6 +24,136 @@
 
 #include "CFInternal.h"
 #include "CFUtilities.h"
+#include "CFPlatform.h"
+
+/* How many times CFLock() polls a locked lock before parking. */
+#define __kCFLockSpinCount 100
+
+static CFIndex __CFLockProcessorCount = 0;
+
+CF_INLINE void __CFLockRelax(void) {
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause");
+#elif defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Called when fast path of CFLock() failed. */
+CF_INTERNAL
+void _CFLockWait(CFLock_t* lock) {
+    CFIndex spin;
+    if (!__CFLockProcessorCount) {
+        __CFLockProcessorCount = CFPlatformGetProcessorCount();
+    }
+    // Spinning makes sense only if the owner can run meanwhile.
+    if (__CFLockProcessorCount > 1) {
+        for (spin = 0; spin != __kCFLockSpinCount; ++spin) {
+            __CFLockRelax();
+            if (!*lock && OSAtomicCompareAndSwap32Barrier(0, 1, (int32_t*)lock)) {
+                return;
+            }
+        }
+    }
+    // Mark the lock as having waiters and park. Once parked, lock is
+    //  acquired in state 2, since other waiters might still be there.
+    while (true) {
+        int32_t state = *lock;
+        if (!state) {
+            if (OSAtomicCompareAndSwap32Barrier(0, 2, (int32_t*)lock)) {
+                return;
+            }
+        } else if (state == 2 || OSAtomicCompareAndSwap32Barrier(1, 2, (int32_t*)lock)) {
+            CFPlatformWaitOnAddress(lock, 2);
+        }
+    }
+}
+
+/* Called by CFUnlock() when there might be waiters. */
+CF_INTERNAL
+void _CFLockWake(CFLock_t* lock) {
+    *lock = 0;
+    OSMemoryBarrier();
+    CFPlatformWakeAddress(lock);
+}
+
+#if defined(CF_ENABLE_LOCK_PROFILING)
+
+#define __kCFLockTimedHoldCapacity 16
+
+typedef struct {
+    CFLock_t* lock;
+    _CFLockSite* site;
+    int64_t startTSR;
+} __CFLockTimedHold;
+
+static _CFLockSite* volatile __CFLockSites = NULL;
+
+static __thread __CFLockTimedHold __CFLockTimedHolds[__kCFLockTimedHoldCapacity];
+CF_INTERNAL __thread CFIndex _CFLockTimedHoldCount = 0;
+
+CF_INTERNAL
+_CFLockSite* _CFLockGetSites(void) {
+    return __CFLockSites;
+}
+
+CF_INTERNAL
+void _CFLockRegisterSite(_CFLockSite* site) {
+    _CFLockSite* head;
+    if (!OSAtomicCompareAndSwap32Barrier(0, 1, &site->registered)) {
+        return;
+    }
+    do {
+        head = __CFLockSites;
+        site->next = head;
+    } while (!OSAtomicCompareAndSwapPtrBarrier(head, site, (void* volatile*)&__CFLockSites));
+}
+
+static void __CFLockBeginTimedHold(CFLock_t* lock, _CFLockSite* site, int64_t acquiredTSR) {
+    if (_CFLockTimedHoldCount != __kCFLockTimedHoldCapacity) {
+        __CFLockTimedHold* hold = __CFLockTimedHolds + _CFLockTimedHoldCount++;
+        hold->lock = lock;
+        hold->site = site;
+        hold->startTSR = acquiredTSR;
+    }
+}
+
+/* Called for sampled acquisitions on the fast path of profiled CFLock(). */
+CF_INTERNAL
+void _CFLockProfiledAcquired(CFLock_t* lock, _CFLockSite* site) {
+    __CFLockBeginTimedHold(lock, site, CFPlatformReadTSR());
+}
+
+CF_INTERNAL
+void _CFLockProfiledWait(CFLock_t* lock, _CFLockSite* site) {
+    int64_t startTSR = CFPlatformReadTSR();
+    int64_t acquiredTSR;
+    _CFLockWait(lock);
+    acquiredTSR = CFPlatformReadTSR();
+    site->acquisitionCount++;
+    site->contendedCount++;
+    site->waitTSR += acquiredTSR - startTSR;
+    __CFLockBeginTimedHold(lock, site, acquiredTSR);
+}
+
+CF_INTERNAL
+void _CFLockProfiledRelease(CFLock_t* lock) {
+    CFIndex i = _CFLockTimedHoldCount;
+    while (i--) {
+        if (__CFLockTimedHolds[i].lock == lock) {
+            _CFLockSite* site = __CFLockTimedHolds[i].site;
+            int64_t holdTSR = CFPlatformReadTSR() - __CFLockTimedHolds[i].startTSR;
+            if (holdTSR > site->maxHoldTSR) {
+                site->maxHoldTSR = holdTSR;
+            }
+            // Locks are not necessarily released in reverse order.
+            __CFLockTimedHolds[i] = __CFLockTimedHolds[--_CFLockTimedHoldCount];
+            break;
+        }
+    }
+}
+
+#endif // CF_ENABLE_LOCK_PROFILING
 
 CF_INTERNAL
 CFIndex _CFBSearch(const void* element, CFIndex elementSize,
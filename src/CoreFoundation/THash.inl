@@ -961,6 +961,47 @@ Boolean THashName(GetValueIfPresent)(CFHashRef hc, const_any_pointer_t key, cons
     return (kCFNotFound != match ? ((value ? (*value = (const_any_pointer_t)(CFDictionary ? hc->_values[match] : hc->_keys[match])) : 0), true): false);
 }
 
+#if CFDictionary || CFSet
+/* Doesn't allocate unless 'cStr' needs conversion to the eight-bit
+ *  encoding, see _CFStringInitWithCStringNoCopy().
+ */
+static Boolean __THashName(GetValueIfPresentForCString)(CFHashRef hc, const char* cStr, CFStringEncoding encoding, const_any_pointer_t *value) {
+    _CFStackString storage;
+    CFStringRef key;
+    Boolean found;
+    CF_VALIDATE_PTR_ARG(cStr);
+    key = _CFStringInitWithCStringNoCopy(&storage, cStr, encoding);
+    if (key) {
+        return THashName(GetValueIfPresent)(hc, key, value);
+    }
+    key = CFStringCreateWithCString(kCFAllocatorSystemDefault, cStr, encoding);
+    if (!key) {
+        return false;
+    }
+    found = THashName(GetValueIfPresent)(hc, key, value);
+    CFRelease(key);
+    return found;
+}
+#endif
+
+#if CFDictionary
+const_any_pointer_t THashName(GetValueForCString)(CFHashRef hc, const char* cStr, CFStringEncoding encoding) {
+    const_any_pointer_t value = 0;
+    __THashName(GetValueIfPresentForCString)(hc, cStr, encoding, &value);
+    return value;
+}
+
+Boolean THashName(GetValueIfPresentForCString)(CFHashRef hc, const char* cStr, CFStringEncoding encoding, const_any_pointer_t *value) {
+    return __THashName(GetValueIfPresentForCString)(hc, cStr, encoding, value);
+}
+#endif
+
+#if CFSet
+Boolean THashName(ContainsCString)(CFHashRef hc, const char* cStr, CFStringEncoding encoding) {
+    return __THashName(GetValueIfPresentForCString)(hc, cStr, encoding, NULL);
+}
+#endif
+
 #if CFDictionary
 Boolean THashName(GetKeyIfPresent)(CFHashRef hc, const_any_pointer_t key, const_any_pointer_t *actualkey) {
     CF_OBJC_FUNCDISPATCH(Boolean, hc, "getActualKey:forKey:", actualkey, key);
@@ -1030,6 +1071,30 @@ void THashName(ApplyFunction)(CFHashRef hc, THashName(ApplierFunction) applier,
     }
 }
 
+CF_INTERNAL void _THashName(ApplyToObjects)(CFHashRef hc, void (*applier)(CFTypeRef cf)) {
+    // Keys and values are CF objects if they are released as such.
+    Boolean keysAreObjects = (__THashName(GetKeyCallBacks)(hc)->release == _CFTypeCollectionRelease);
+#if CFDictionary
+    Boolean valuesAreObjects = (__THashName(GetValueCallBacks)(hc)->release == _CFTypeCollectionRelease);
+#else
+    Boolean valuesAreObjects = false;
+#endif
+    any_t *keys = hc->_keys;
+    if (!keysAreObjects && !valuesAreObjects) {
+        return;
+    }
+    for (CFIndex idx = 0, nbuckets = hc->_bucketsNum; idx < nbuckets; idx++) {
+        if (__CFHashKeyIsValue(hc, keys[idx])) {
+            if (keysAreObjects) {
+                applier((CFTypeRef)keys[idx]);
+            }
+            if (valuesAreObjects) {
+                applier((CFTypeRef)hc->_values[idx]);
+            }
+        }
+    }
+}
+
 static void __THashName(Grow)(CFMutableHashRef hc, CFIndex numNewValues) {
     any_t *oldkeys = hc->_keys;
     any_t *oldvalues = hc->_values;